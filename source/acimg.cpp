@@ -45,7 +45,7 @@ int ConvertToARGB(Image &dst, const Image &src)
 	if( src.format == PF_R8G8B8 )
 		return ConvertRGBToARGB(dst, src);
 
-	if( src.format == PF_A8R8G8B8 )
+	if( src.format == PF_A8R8G8B8 || src.format == PF_A8B8G8R8 )
 	{
 		dst.data       = 0;
 		dst.palette    = 0;
@@ -57,7 +57,16 @@ int ConvertToARGB(Image &dst, const Image &src)
 
 		dst.data = new BYTE[dst.pitch*dst.height];
 		
-		memcpy(dst.data, src.data, src.height*src.pitch);
+		for( UINT y = 0; y < dst.height; y++ )
+			memcpy(&dst.data[dst.pitch*y], &src.data[src.pitch*y], dst.pitch);
+
+		// Swap the red and blue channels
+		if( src.format == PF_A8B8G8R8 )
+		{
+			DWORD *pixels = (DWORD*)dst.data;
+			for( UINT n = 0; n < dst.width*dst.height; n++ )
+				pixels[n] = (pixels[n] & 0xFF00FF00) | ((pixels[n] >> 16) & 0xFF) | ((pixels[n] & 0xFF) << 16);
+		}
 	}
 
 	return E_SUCCESS;
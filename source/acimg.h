@@ -28,6 +28,8 @@
 #ifndef ACIMG_H
 #define ACIMG_H
 
+#include <functional>
+
 namespace acImage
 {
 typedef unsigned int   UINT;
@@ -48,6 +50,7 @@ enum PixelFormat
 	PF_A8,
 	PF_R8G8B8,
 	PF_A8R8G8B8,
+	PF_A8B8G8R8, // The bytes are in R, G, B, A order, which some encoders use directly
 };
 
 struct Image
@@ -75,17 +78,57 @@ int SaveBmp(const char *filename, Image &image);
 int LoadBmp(const char *filename, Image &image);
 
 // PNG
-int SavePng(const char *filename, Image &image);
+// The lowest bits of the flags hold the zlib level + 1, so 0 gives the default level
+const DWORD PNG_LEVEL_MASK        = 0x00F;
+inline DWORD PngLevel(int level) { return DWORD(level + 1) & PNG_LEVEL_MASK; }
+
+// The filter applied to the rows before compression. Adaptive picks the best filter for each row
+const DWORD PNG_ROWFILTER_ADAPTIVE = 0x000;
+const DWORD PNG_ROWFILTER_NONE     = 0x010;
+const DWORD PNG_ROWFILTER_SUB      = 0x020;
+const DWORD PNG_ROWFILTER_UP       = 0x030;
+const DWORD PNG_ROWFILTER_PAETH    = 0x040;
+const DWORD PNG_ROWFILTER_MASK     = 0x0F0;
+
+// Compress stripes of rows in parallel. The file is slightly larger.
+const DWORD PNG_PARALLEL           = 0x100;
+
+int SavePng(const char *filename, Image &image, DWORD flags = 0);
 int LoadPng(const char *filename, Image &image);
 
 // DDS
 const DWORD DDS_DXT1 = 1;
 const DWORD DDS_DXT3 = 2;
 const DWORD DDS_DXT5 = 3;
+const DWORD DDS_BC4  = 4; // The alpha channel, or the single channel for A8 images
+const DWORD DDS_BC5  = 5; // The red and green channels
+const DWORD DDS_COMPRESSION_MASK = 0xFF;
+
+// Combine with the compression to choose how squish fits the colours.
+// The default is the cluster fit.
+const DWORD DDS_FIT_RANGE     = 0x100;
+const DWORD DDS_FIT_ITERATIVE = 0x200;
 
 int SaveDds(const char *filename, Image &image, DWORD flags = 0);
 int LoadDds(const char *filename, Image &image);
 
+// Compresses the image to the blocks of the DDS compression in the flags, with 
+// the blocks for each row of 4 pixels after each other. The buffer must hold 
+// ((width+3)/4)*((height+3)/4) blocks of GetBlockSize(flags) bytes.
+UINT GetBlockSize(DWORD compression);
+int  CompressBlocks(const Image &image, DWORD flags, BYTE *blocks);
+
+// KTX2
+// The images are stored as the layers of a 2D array texture. The function
+// is called for each layer in turn, so only one image is needed at a time,
+// and all the images must have the same size and format. The DDS flags give
+// the compression, or 0 for uncompressed pixels. 8bit images are stored in 
+// the red channel, as Vulkan has no alpha only format.
+const DWORD KTX_ZLIB = 0x400; // Supercompress the level with zlib
+
+typedef std::function<int(UINT layer, Image &image)> KtxLayerFunc;
+int SaveKtx2(const char *filename, UINT numLayers, const KtxLayerFunc &getLayer, DWORD flags = 0);
+
 // JPG
 // Flags is the quality, from 0 to 100
 int SaveJpg(const char *filename, Image &image, DWORD flags = 50);
@@ -29,8 +29,10 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <vector>
 #include <squish.h>
 #include "acimg.h"
+#include "acutil_parallel.h"
 
 namespace acImage
 {
@@ -68,6 +70,25 @@ struct DdsHeader
 	DWORD dwReserved2;
 };
 
+// Follows the DdsHeader when the FourCC is "DX10"
+struct DdsHeaderDx10
+{
+	DWORD dxgiFormat;
+	DWORD resourceDimension;
+	DWORD miscFlag;
+	DWORD arraySize;
+	DWORD miscFlags2;
+};
+
+// DXGI formats
+const DWORD DXGI_FORMAT_BC1_UNORM = 71;
+const DWORD DXGI_FORMAT_BC2_UNORM = 74;
+const DWORD DXGI_FORMAT_BC3_UNORM = 77;
+const DWORD DXGI_FORMAT_BC4_UNORM = 80;
+const DWORD DXGI_FORMAT_BC5_UNORM = 83;
+
+const DWORD D3D10_RESOURCE_DIMENSION_TEXTURE2D = 3;
+
 // DDS flags
 const int DDSD_CAPS        = 0x00000001;
 const int DDSD_HEIGHT      = 0x00000002;
@@ -98,26 +119,367 @@ const int DDSCAPS2_CUBEMAP_POSITIVEZ = 0x00004000;
 const int DDSCAPS2_CUBEMAP_NEGATIVEZ = 0x00008000;
 const int DDSCAPS2_VOLUME            = 0x00200000;
 
+// The best pair of 5 or 6 bit end points for each 8 bit value, when 
+// the value is represented by the colour 2/3 of the way to the second 
+struct SingleColourTable
+{
+	SingleColourTable()
+	{
+		Build(5, c5);
+		Build(6, c6);
+	}
+
+	static void Build(int bits, BYTE table[256][2])
+	{
+		int count = 1<<bits;
+		for( int v = 0; v < 256; v++ )
+		{
+			int bestError = 256;
+			for( int a = 0; a < count && bestError; a++ )
+			{
+				int ea = (a << (8-bits)) | (a >> (2*bits-8));
+				for( int b = 0; b < count && bestError; b++ )
+				{
+					int eb = (b << (8-bits)) | (b >> (2*bits-8));
+					int error = (2*ea + eb)/3 - v;
+					if( error < 0 ) error = -error;
+					if( error < bestError )
+					{
+						bestError = error;
+						table[v][0] = BYTE(a);
+						table[v][1] = BYTE(b);
+					}
+				}
+			}
+		}
+	}
+
+	BYTE c5[256][2];
+	BYTE c6[256][2];
+};
+
+// Encodes a block where all 16 pixels have the same colour without 
+// searching for the end points. The pixel is in the RGBA byte order.
+static void CompressUniformBlock(DWORD pixel, BYTE *block, DWORD compression)
+{
+	static const SingleColourTable table;
+
+	BYTE r = BYTE(pixel), g = BYTE(pixel>>8), b = BYTE(pixel>>16), a = BYTE(pixel>>24);
+
+	BYTE *colour = block;
+	if( compression == DDS_DXT3 )
+	{
+		// Explicit 4 bit alpha for each pixel
+		BYTE a4 = BYTE((a + 8)/17);
+		memset(block, a4 | (a4<<4), 8);
+		colour = block + 8;
+	}
+	else if( compression == DDS_DXT5 )
+	{
+		// Both end points equal the alpha, and all indices refer to the first
+		memset(block, 0, 8);
+		block[0] = block[1] = a;
+		colour = block + 8;
+	}
+	else if( a < 128 )
+	{
+		// DXT1 uses the 3 colour mode with all pixels transparent
+		memset(colour, 0, 4);
+		memset(colour+4, 0xFF, 4);
+		return;
+	}
+
+	WORD c0 = WORD((table.c5[r][0] << 11) | (table.c6[g][0] << 5) | table.c5[b][0]);
+	WORD c1 = WORD((table.c5[r][1] << 11) | (table.c6[g][1] << 5) | table.c5[b][1]);
+
+	// The 4 colour mode requires the first end point to be the larger. Index 2
+	// is 2/3 of the first plus 1/3 of the second, so swapping uses index 3.
+	BYTE indices;
+	if( c0 > c1 )
+		indices = 0xAA;
+	else if( c0 < c1 )
+	{
+		WORD t = c0; c0 = c1; c1 = t;
+		indices = 0xFF;
+	}
+	else
+		indices = 0x00;
+
+	colour[0] = BYTE(c0); colour[1] = BYTE(c0>>8);
+	colour[2] = BYTE(c1); colour[3] = BYTE(c1>>8);
+	memset(colour+4, indices, 4);
+}
+
+
+
+// Returns the value at each of the 8 positions in a BC4 block
+static void GetBc4Palette(int r0, int r1, int palette[8])
+{
+	palette[0] = r0;
+	palette[1] = r1;
+	if( r0 > r1 )
+	{
+		for( int i = 2; i < 8; i++ )
+			palette[i] = ((8-i)*r0 + (i-1)*r1 + 3)/7;
+	}
+	else
+	{
+		for( int i = 2; i < 6; i++ )
+			palette[i] = ((6-i)*r0 + (i-1)*r1 + 2)/5;
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+}
+
+// Picks the closest position in the palette for each value and 
+// returns the sum of the squared errors
+static int FitBc4Indices(const BYTE values[16], int r0, int r1, BYTE indices[16])
+{
+	int palette[8];
+	GetBc4Palette(r0, r1, palette);
+
+	// The palette is evenly spaced between the end points so the closest
+	// interpolated value can be computed directly instead of searched for
+	int steps = r0 > r1 ? 7 : 5;
+	int lo    = r0 > r1 ? r1 : r0;
+	int range = r0 > r1 ? r0 - r1 : r1 - r0;
+
+	int error = 0;
+	for( int n = 0; n < 16; n++ )
+	{
+		int v = values[n];
+		int t = 0;
+		if( range )
+		{
+			t = ((v - lo)*steps*2 + range)/(range*2);
+			if( v < lo ) t = 0;
+			if( t > steps ) t = steps;
+		}
+
+		// Map the position between the end points to the index
+		int idx;
+		if( r0 > r1 )
+			idx = t == 7 ? 0 : (t == 0 ? 1 : 8 - t);
+		else
+			idx = t == 0 ? 0 : (t == 5 ? 1 : t + 1);
+
+		int best = (palette[idx] - v)*(palette[idx] - v);
+		if( r0 <= r1 )
+		{
+			// The explicit 0 and 255 may be closer
+			if( v*v < best )                 { best = v*v; idx = 6; }
+			if( (255-v)*(255-v) < best )     { best = (255-v)*(255-v); idx = 7; }
+		}
+
+		indices[n] = BYTE(idx);
+		error += best;
+	}
+
+	return error;
+}
+
+// Evaluates the end points within the radius of r0 and r1 that keep the 
+// mode, and updates the best pair if any of them gives less error
+static void SearchBc4EndPoints(const BYTE values[16], int r0, int r1, int radius, bool sixValues, int &bestR0, int &bestR1, int &bestError)
+{
+	BYTE indices[16];
+	for( int a = r0 - radius; a <= r0 + radius; a++ )
+	{
+		if( a < 0 || a > 255 ) continue;
+		for( int b = r1 - radius; b <= r1 + radius; b++ )
+		{
+			if( b < 0 || b > 255 ) continue;
+
+			// The order of the end points chooses the mode
+			if( sixValues ? a > b : a <= b ) continue;
+
+			int error = FitBc4Indices(values, a, b, indices);
+			if( error < bestError )
+			{
+				bestError = error;
+				bestR0 = a;
+				bestR1 = b;
+			}
+		}
+	}
+}
+
+// Starts with a search around the given end points, then alternates between
+// solving the least squares end points for the chosen indices and searching
+// around them until the error doesn't improve any more
+static int FitBc4EndPoints(const BYTE values[16], int r0, int r1, bool sixValues, int &bestR0, int &bestR1)
+{
+	int bestError = 0x7FFFFFFF;
+	bestR0 = r0;
+	bestR1 = r1;
+	SearchBc4EndPoints(values, r0, r1, 2, sixValues, bestR0, bestR1, bestError);
+
+	BYTE indices[16];
+	for( int iter = 0; iter < 4 && bestError > 0; iter++ )
+	{
+		FitBc4Indices(values, bestR0, bestR1, indices);
+
+		// Each interpolated value is w*r0 + (1-w)*r1
+		double aa = 0, ab = 0, bb = 0, av = 0, bv = 0;
+		for( int n = 0; n < 16; n++ )
+		{
+			int idx = indices[n];
+			double w;
+			if( idx == 0 )      w = 1;
+			else if( idx == 1 ) w = 0;
+			else if( !sixValues ) w = (8-idx)/7.0;
+			else if( idx < 6 )  w = (6-idx)/5.0;
+			else continue;
+
+			aa += w*w; ab += w*(1-w); bb += (1-w)*(1-w);
+			av += w*values[n]; bv += (1-w)*values[n];
+		}
+
+		double det = aa*bb - ab*ab;
+		if( det < 1e-6 && det > -1e-6 )
+			break;
+
+		int a = int((av*bb - bv*ab)/det + 0.5);
+		int b = int((bv*aa - av*ab)/det + 0.5);
 
+		int prevError = bestError;
+		SearchBc4EndPoints(values, a, b, 1, sixValues, bestR0, bestR1, bestError);
+		if( bestError >= prevError )
+			break;
+	}
+
+	return bestError;
+}
+
+// Compresses a single channel 4x4 block. Both modes are evaluated, the one 
+// with 8 interpolated values, and the one with 6 interpolated values plus 
+// explicit 0 and 255 that suits the anti-aliased edges of glyphs.
+static void CompressBc4Block(const BYTE values[16], BYTE *block)
+{
+	int lo = 255, hi = 0, innerLo = 255, innerHi = 0;
+	for( int n = 0; n < 16; n++ )
+	{
+		int v = values[n];
+		if( v < lo ) lo = v;
+		if( v > hi ) hi = v;
+		if( v > 0 && v < 255 )
+		{
+			if( v < innerLo ) innerLo = v;
+			if( v > innerHi ) innerHi = v;
+		}
+	}
+
+	int r0 = lo, r1 = lo;
+	if( lo != hi )
+	{
+		int error = FitBc4EndPoints(values, hi, lo, false, r0, r1);
+		if( error > 0 )
+		{
+			int r0b, r1b;
+			if( innerLo > innerHi ) { innerLo = 0; innerHi = 0; }
+			if( FitBc4EndPoints(values, innerLo, innerHi, true, r0b, r1b) < error )
+			{
+				r0 = r0b;
+				r1 = r1b;
+			}
+		}
+	}
+
+	BYTE indices[16];
+	FitBc4Indices(values, r0, r1, indices);
+
+	block[0] = BYTE(r0);
+	block[1] = BYTE(r1);
+
+	// Pack the 3 bit indices, the first pixel in the lowest bits
+	for( int g = 0; g < 2; g++ )
+	{
+		DWORD bits = 0;
+		for( int n = 0; n < 8; n++ )
+			bits |= DWORD(indices[g*8 + n]) << (n*3);
+		block[2 + g*3 + 0] = BYTE(bits);
+		block[2 + g*3 + 1] = BYTE(bits >> 8);
+		block[2 + g*3 + 2] = BYTE(bits >> 16);
+	}
+}
+
+static void DecompressBc4Block(const BYTE *block, BYTE values[16])
+{
+	int palette[8];
+	GetBc4Palette(block[0], block[1], palette);
+
+	for( int g = 0; g < 2; g++ )
+	{
+		DWORD bits = block[2 + g*3] | (block[2 + g*3 + 1] << 8) | (block[2 + g*3 + 2] << 16);
+		for( int n = 0; n < 8; n++ )
+			values[g*8 + n] = BYTE(palette[(bits >> (n*3)) & 7]);
+	}
+}
+
+// Gathers the 4x4 pixels at x,y as 32bit values in the image's channel order.
+// Pixels outside the image repeat the last pixel of the row or the last row. 
+// A8 is put in alpha.
+static void GetBlockPixels(const Image &image, UINT x, UINT y, DWORD pixels[16])
+{
+	for( UINT py = 0; py < 4; py++ )
+	{
+		if( y+py < image.height )
+		{
+			const BYTE *line = &image.data[(y+py)*image.pitch];
+			for( UINT px = 0; px < 4; px++ )
+			{
+				if( x+px < image.width )
+				{
+					if( image.format == PF_A8 )
+						pixels[py*4+px] = DWORD(line[x+px]) << 24;
+					else
+						pixels[py*4+px] = ((const DWORD*)line)[x+px];
+				}
+				else
+					pixels[py*4+px] = pixels[py*4+px-1];
+			}
+		}
+		else
+		{
+			for( UINT px = 0; px < 4; px++ )
+				pixels[py*4+px] = pixels[py*4+px-4];
+		}
+	}
+}
 
 int SaveDds(const char *filename, Image &image, DWORD flags)
 {
 	// Validate the image
 	if( image.format != PF_A8R8G8B8 &&
+		image.format != PF_A8B8G8R8 &&
 		image.format != PF_R8G8B8 &&
 		image.format != PF_A8 )
 	{
 		return E_FORMAT_NOT_SUPPORTED;
 	}
 
-	if( (flags == DDS_DXT1 ||
-		 flags == DDS_DXT3 ||
-		 flags == DDS_DXT5) &&
-		image.format != PF_A8R8G8B8 )
+	DWORD compression = flags & DDS_COMPRESSION_MASK;
+	if( (compression == DDS_DXT1 ||
+		 compression == DDS_DXT3 ||
+		 compression == DDS_DXT5 ||
+		 compression == DDS_BC5) &&
+		image.format != PF_A8R8G8B8 &&
+		image.format != PF_A8B8G8R8 )
 	{
 		return E_FORMAT_NOT_SUPPORTED;
 	}
 
+	if( compression == DDS_BC4 &&
+		image.format != PF_A8R8G8B8 &&
+		image.format != PF_A8B8G8R8 &&
+		image.format != PF_A8 )
+	{
+		return E_FORMAT_NOT_SUPPORTED;
+	}
+
+	if( compression > DDS_BC5 )
+		return E_INVALID_ARG;
+
 	FILE *f = 0;
 	fopen_s(&f, filename, "wb");
 	if( f == 0 )
@@ -136,16 +498,18 @@ int SaveDds(const char *filename, Image &image, DWORD flags)
 	dds.ddsCaps.dwCaps1 = DDSCAPS_TEXTURE;
 	dds.ddpfPixelFormat.dwSize = 32;
 
-	if( flags == 0 )
+	if( compression == 0 )
 	{
 		dds.dwFlags |= DDSD_PITCH;
 
 		// Fill in the pixel format
 		if( image.format == PF_R8G8B8 ||
-			image.format == PF_A8R8G8B8 )
+			image.format == PF_A8R8G8B8 ||
+			image.format == PF_A8B8G8R8 )
 			dds.ddpfPixelFormat.dwFlags += DDPF_RGB;
 		if( image.format == PF_A8 ||
-			image.format == PF_A8R8G8B8 )
+			image.format == PF_A8R8G8B8 ||
+			image.format == PF_A8B8G8R8 )
 			dds.ddpfPixelFormat.dwFlags += DDPF_ALPHAPIXELS;
 
 		if( image.format == PF_A8 )
@@ -178,6 +542,16 @@ int SaveDds(const char *filename, Image &image, DWORD flags)
 			dds.ddpfPixelFormat.dwBBitMask        = 0x000000FF;
 			dds.ddpfPixelFormat.dwRGBAlphaBitMask = 0xFF000000;
 		}
+		else if( image.format == PF_A8B8G8R8 )
+		{
+			dds.dwPitchOrLinearSize = image.width*4;
+
+			dds.ddpfPixelFormat.dwRGBBitCount     = 32;
+			dds.ddpfPixelFormat.dwRBitMask        = 0x000000FF;
+			dds.ddpfPixelFormat.dwGBitMask        = 0x0000FF00;
+			dds.ddpfPixelFormat.dwBBitMask        = 0x00FF0000;
+			dds.ddpfPixelFormat.dwRGBAlphaBitMask = 0xFF000000;
+		}
 
 		fwrite(&dds, sizeof(dds), 1, f);
 
@@ -186,6 +560,7 @@ int SaveDds(const char *filename, Image &image, DWORD flags)
 		if( image.format == PF_A8       ) pixelSize = 1;
 		if( image.format == PF_R8G8B8   ) pixelSize = 3;
 		if( image.format == PF_A8R8G8B8 ) pixelSize = 4;
+		if( image.format == PF_A8B8G8R8 ) pixelSize = 4;
 		for( UINT y = 0; y < image.height; y++ )
 			fwrite(&image.data[y*image.pitch], image.width*pixelSize, 1, f);
 	}
@@ -201,79 +576,142 @@ int SaveDds(const char *filename, Image &image, DWORD flags)
 		UINT height = image.height;
 		if( height % 4 ) height += 4 - (height % 4);
 
-		int method;
-		int blockSize;
-		if( flags == DDS_DXT1 )
-		{
+		DdsHeaderDx10 dx10;
+		memset(&dx10, 0, sizeof(dx10));
+		if( compression == DDS_DXT1 )
 			dds.ddpfPixelFormat.dwFourCC = *(DWORD*)"DXT1";
-			blockSize = 8;
-			method = squish::kDxt1;
+		else if( compression == DDS_DXT3 )
+			dds.ddpfPixelFormat.dwFourCC = *(DWORD*)"DXT3";
+		else if( compression == DDS_DXT5 )
+			dds.ddpfPixelFormat.dwFourCC = *(DWORD*)"DXT5";
+		else
+		{
+			// BC4 and BC5 don't have a FourCC of their own, so the format is
+			// given in the extended header that is understood by Direct3D 10+
+			dds.ddpfPixelFormat.dwFourCC = *(DWORD*)"DX10";
+
+			dx10.dxgiFormat        = compression == DDS_BC4 ? DXGI_FORMAT_BC4_UNORM : DXGI_FORMAT_BC5_UNORM;
+			dx10.resourceDimension = D3D10_RESOURCE_DIMENSION_TEXTURE2D;
+			dx10.arraySize         = 1;
 		}
-		else if( flags == DDS_DXT3 )
+
+		// Determine linear size
+		dds.dwPitchOrLinearSize = width/4 * height/4 * GetBlockSize(compression);
+
+		std::vector<BYTE> buffer;
+		try
 		{
-			dds.ddpfPixelFormat.dwFourCC = *(DWORD*)"DXT3";
-			blockSize = 16;
-			method = squish::kDxt3;
+			buffer.resize(dds.dwPitchOrLinearSize);
 		}
-		else if( flags == DDS_DXT5 )
+		catch( ... )
 		{
-			dds.ddpfPixelFormat.dwFourCC = *(DWORD*)"DXT5";
-			blockSize = 16;
-			method = squish::kDxt5;
+			fclose(f);
+			return E_OUT_OF_MEMORY;
 		}
 
-		// Determine linear size
-		dds.dwPitchOrLinearSize = width/4 * height/4 * blockSize;
+		CompressBlocks(image, flags, &buffer[0]);
 
 		fwrite(&dds, sizeof(dds), 1, f);
+		if( dx10.dxgiFormat )
+			fwrite(&dx10, sizeof(dx10), 1, f);
+		fwrite(&buffer[0], buffer.size(), 1, f);
+	}
 
-		// Save the image in blocks of 4x4 pixels
-		BYTE block[16];
+	fclose(f);
+
+	return E_SUCCESS;
+}
+
+UINT GetBlockSize(DWORD compression)
+{
+	compression &= DDS_COMPRESSION_MASK;
+	return compression == DDS_DXT1 || compression == DDS_BC4 ? 8 : 16;
+}
+
+int CompressBlocks(const Image &image, DWORD flags, BYTE *blocks)
+{
+	DWORD compression = flags & DDS_COMPRESSION_MASK;
+	if( compression < DDS_DXT1 || compression > DDS_BC5 )
+		return E_INVALID_ARG;
+	if( image.format != PF_A8R8G8B8 && image.format != PF_A8B8G8R8 && (image.format != PF_A8 || compression != DDS_BC4) )
+		return E_FORMAT_NOT_SUPPORTED;
+
+	// The compressors take the pixels in R, G, B, A order so 
+	// PF_A8B8G8R8 can be used as is, without swapping the channels
+	bool isRGBA = image.format == PF_A8B8G8R8;
+
+	int method = 0;
+	if( compression == DDS_DXT1 )      method = squish::kDxt1;
+	else if( compression == DDS_DXT3 ) method = squish::kDxt3;
+	else if( compression == DDS_DXT5 ) method = squish::kDxt5;
+
+	// Choose how squish fits the colour end points
+	if( flags & DDS_FIT_RANGE )
+		method |= squish::kColourRangeFit;
+	else if( flags & DDS_FIT_ITERATIVE )
+		method |= squish::kColourIterativeClusterFit;
+	else
+		method |= squish::kColourClusterFit;
+
+	UINT blockSize = GetBlockSize(compression);
+	UINT blocksPerRow = (image.width + 3)/4;
+
+	// Compress the image in blocks of 4x4 pixels. Each row of blocks 
+	// is compressed independently, directly into its place in the buffer
+	acUtility::ParallelFor((image.height + 3)/4, [&](unsigned int row)
+	{
+		UINT y = row*4;
+		BYTE *block = &blocks[row * blocksPerRow * blockSize];
 		DWORD source[16];
+		BYTE values[16];
 
-		for( UINT y = 0; y < image.height; y+= 4 )
+		for( UINT x = 0; x < image.width; x += 4, block += blockSize )
 		{
-			for( UINT x = 0; x < image.width; x+= 4 )
+			GetBlockPixels(image, x, y, source);
+
+			if( compression == DDS_BC4 )
 			{
-				DWORD *pixels = source;
+				// The single channel is the alpha, as for 8bit images
+				for( UINT n = 0; n < 16; n++ )
+					values[n] = BYTE(source[n] >> 24);
+				CompressBc4Block(values, block);
+				continue;
+			}
 
-				for( UINT py = 0; py < 4; py++ )
-				{
-					if( y+py < image.height )
-					{
-						for( UINT px = 0; px < 4; px++ )
-						{
-							if( x+px < image.width )
-							{
-								DWORD pixel = ((DWORD*)image.data)[(y+py)*image.width+x+px];
+			if( compression == DDS_BC5 )
+			{
+				// The red and green channels are compressed separately
+				for( UINT n = 0; n < 16; n++ )
+					values[n] = BYTE(isRGBA ? source[n] : source[n] >> 16);
+				CompressBc4Block(values, block);
+				for( UINT n = 0; n < 16; n++ )
+					values[n] = BYTE(source[n] >> 8);
+				CompressBc4Block(values, block + 8);
+				continue;
+			}
 
-								// Swap red and blue channels
-								pixel ^= ((pixel&0xFF)<<16);
-								pixel ^= ((pixel>>16)&0xFF);
-								pixel ^= ((pixel&0xFF)<<16);
+			// Swap red and blue channels
+			for( UINT n = 0; n < 16 && !isRGBA; n++ )
+			{
+				DWORD pixel = source[n];
+				pixel ^= ((pixel&0xFF)<<16);
+				pixel ^= ((pixel>>16)&0xFF);
+				pixel ^= ((pixel&0xFF)<<16);
+				source[n] = pixel;
+			}
 
-								*pixels++ = pixel;
-							}
-							else
-								*pixels++ = *(pixels-1);
-						}
-					}
-					else
-					{
-						*pixels++ = *(pixels-4);
-						*pixels++ = *(pixels-4);
-						*pixels++ = *(pixels-4);
-						*pixels++ = *(pixels-4);
-					}
-				}
+			// Empty areas of the texture and solid glyphs give blocks 
+			// with a single colour, which don't need the full search
+			bool isUniform = true;
+			for( UINT n = 1; n < 16 && isUniform; n++ )
+				isUniform = source[n] == source[0];
 
+			if( isUniform )
+				CompressUniformBlock(source[0], block, compression);
+			else
 				squish::Compress((BYTE*)source, block, method);
-				fwrite(block, blockSize, 1, f);
-			}
 		}
-	}
-
-	fclose(f);
+	});
 
 	return E_SUCCESS;
 }
@@ -340,46 +778,107 @@ int LoadDds(const char *filename, Image &image)
 	}
 	else if( dds.ddpfPixelFormat.dwFlags & DDPF_FOURCC )
 	{
+		// The extended header gives the format as a DXGI format instead
+		DWORD fourCC = dds.ddpfPixelFormat.dwFourCC;
+		if( fourCC == *(DWORD*)"DX10" )
+		{
+			DdsHeaderDx10 dx10;
+			fread(&dx10, sizeof(dx10), 1, f);
+			switch( dx10.dxgiFormat )
+			{
+			case DXGI_FORMAT_BC1_UNORM: fourCC = *(DWORD*)"DXT1"; break;
+			case DXGI_FORMAT_BC2_UNORM: fourCC = *(DWORD*)"DXT3"; break;
+			case DXGI_FORMAT_BC3_UNORM: fourCC = *(DWORD*)"DXT5"; break;
+			case DXGI_FORMAT_BC4_UNORM: fourCC = *(DWORD*)"ATI1"; break;
+			case DXGI_FORMAT_BC5_UNORM: fourCC = *(DWORD*)"ATI2"; break;
+			default: fourCC = 0;
+			}
+		}
+		else if( fourCC == *(DWORD*)"BC4U" )
+			fourCC = *(DWORD*)"ATI1";
+		else if( fourCC == *(DWORD*)"BC5U" )
+			fourCC = *(DWORD*)"ATI2";
+
 		// Verify compression format
 		UINT blockSize;
-		UINT method;
-		if( dds.ddpfPixelFormat.dwFourCC == *(DWORD*)"DXT1" )
+		UINT method = 0;
+		if( fourCC == *(DWORD*)"DXT1" )
 		{
 			blockSize = 8;
 			method = squish::kDxt1;
 		}
-		else if( dds.ddpfPixelFormat.dwFourCC == *(DWORD*)"DXT3" )
+		else if( fourCC == *(DWORD*)"DXT3" )
 		{
 			blockSize = 16;
 			method = squish::kDxt3;
 		}
-		else if( dds.ddpfPixelFormat.dwFourCC == *(DWORD*)"DXT5" )
+		else if( fourCC == *(DWORD*)"DXT5" )
 		{
 			blockSize = 16;
 			method = squish::kDxt5;
 		}
+		else if( fourCC == *(DWORD*)"ATI1" )
+			blockSize = 8;
+		else if( fourCC == *(DWORD*)"ATI2" )
+			blockSize = 16;
 		else
 		{
 			fclose(f);
 			return E_FORMAT_NOT_SUPPORTED;
 		}
 
-		image.format = PF_A8R8G8B8;
+		// BC4 is loaded as a single channel image
+		bool isBc4 = fourCC == *(DWORD*)"ATI1";
+		bool isBc5 = fourCC == *(DWORD*)"ATI2";
+
+		image.format = isBc4 ? PF_A8 : PF_A8R8G8B8;
 		image.width  = dds.dwWidth;
-		image.pitch  = dds.dwWidth*4;
+		image.pitch  = isBc4 ? dds.dwWidth : dds.dwWidth*4;
 		image.height = dds.dwHeight;
 		image.data   = new BYTE[image.height*image.pitch];
 
 		// Read the image in blocks of 4x4 pixels
 		BYTE block[16];
 		DWORD target[16];
+		BYTE values[16];
 
 		for( UINT y = 0; y < image.height; y += 4 )
 		{
 			for( UINT x = 0; x < image.width; x += 4 )
 			{
 				fread(block, blockSize, 1, f);
-				squish::Decompress((BYTE*)target, block, method);
+				if( isBc4 )
+				{
+					DecompressBc4Block(block, values);
+					for( UINT n = 0; n < 16; n++ )
+						target[n] = DWORD(values[n]) << 24;
+				}
+				else if( isBc5 )
+				{
+					// Red and green, with blue set to zero and alpha to one
+					for( UINT n = 0; n < 16; n++ )
+						target[n] = 0xFF000000;
+					DecompressBc4Block(block, values);
+					for( UINT n = 0; n < 16; n++ )
+						target[n] |= DWORD(values[n]) << 16;
+					DecompressBc4Block(block + 8, values);
+					for( UINT n = 0; n < 16; n++ )
+						target[n] |= DWORD(values[n]) << 8;
+				}
+				else
+				{
+					squish::Decompress((BYTE*)target, block, method);
+
+					// Swap red and blue channels
+					for( UINT n = 0; n < 16; n++ )
+					{
+						DWORD pixel = target[n];
+						pixel ^= ((pixel&0xFF)<<16);
+						pixel ^= ((pixel>>16)&0xFF);
+						pixel ^= ((pixel&0xFF)<<16);
+						target[n] = pixel;
+					}
+				}
 
 				DWORD *pixels = target;
 
@@ -392,13 +891,10 @@ int LoadDds(const char *filename, Image &image)
 							if( x+px < image.width )
 							{
 								DWORD pixel = *pixels++;
-
-								// Swap red and blue channels
-								pixel ^= ((pixel&0xFF)<<16);
-								pixel ^= ((pixel>>16)&0xFF);
-								pixel ^= ((pixel&0xFF)<<16);
-
-								((DWORD*)image.data)[(y+py)*image.width+x+px] = pixel;
+								if( isBc4 )
+									image.data[(y+py)*image.pitch+x+px] = BYTE(pixel >> 24);
+								else
+									((DWORD*)image.data)[(y+py)*image.width+x+px] = pixel;
 							}
 							else
 								pixels++;
@@ -0,0 +1,315 @@
+/*
+   AngelCode Tool Box Library
+   Copyright (c) 2007-2016 Andreas Jonsson
+  
+   This software is provided 'as-is', without any express or implied 
+   warranty. In no event will the authors be held liable for any 
+   damages arising from the use of this software.
+
+   Permission is granted to anyone to use this software for any 
+   purpose, including commercial applications, and to alter it and 
+   redistribute it freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you 
+      must not claim that you wrote the original software. If you use
+      this software in a product, an acknowledgment in the product 
+      documentation would be appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and 
+      must not be misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source 
+      distribution.
+  
+   Andreas Jonsson
+   andreas@angelcode.com
+*/
+
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <zlib.h>
+#include "acimg.h"
+
+namespace acImage
+{
+
+// Reference: https://registry.khronos.org/KTX/specs/2.0/ktxspec.v2.html
+
+struct Ktx2Header
+{
+	BYTE  identifier[12];
+	DWORD vkFormat;
+	DWORD typeSize;
+	DWORD pixelWidth;
+	DWORD pixelHeight;
+	DWORD pixelDepth;
+	DWORD layerCount;
+	DWORD faceCount;
+	DWORD levelCount;
+	DWORD supercompressionScheme;
+	DWORD dfdByteOffset;
+	DWORD dfdByteLength;
+	DWORD kvdByteOffset;
+	DWORD kvdByteLength;
+	DWORD sgdByteOffset[2]; // 64bit values, kept as pairs to avoid padding
+	DWORD sgdByteLength[2];
+};
+
+struct Ktx2LevelIndex
+{
+	DWORD byteOffset[2];
+	DWORD byteLength[2];
+	DWORD uncompressedByteLength[2];
+};
+
+// Vulkan formats
+const DWORD VK_FORMAT_R8_UNORM        = 9;
+const DWORD VK_FORMAT_R8G8B8A8_UNORM  = 37;
+const DWORD VK_FORMAT_B8G8R8A8_UNORM  = 44;
+const DWORD VK_FORMAT_BC1_RGBA_UNORM  = 133;
+const DWORD VK_FORMAT_BC2_UNORM       = 135;
+const DWORD VK_FORMAT_BC3_UNORM       = 137;
+const DWORD VK_FORMAT_BC4_UNORM       = 139;
+const DWORD VK_FORMAT_BC5_UNORM       = 141;
+
+const DWORD KTX_SUPERCOMPRESSION_ZLIB = 3;
+
+// Data format descriptor values
+const DWORD KHR_DF_MODEL_RGBSDA       = 1;
+const DWORD KHR_DF_MODEL_BC1A         = 128;
+const DWORD KHR_DF_MODEL_BC2          = 129;
+const DWORD KHR_DF_MODEL_BC3          = 130;
+const DWORD KHR_DF_MODEL_BC4          = 131;
+const DWORD KHR_DF_MODEL_BC5          = 132;
+const DWORD KHR_DF_PRIMARIES_BT709    = 1;
+const DWORD KHR_DF_TRANSFER_LINEAR    = 1;
+const DWORD KHR_DF_CHANNEL_RED        = 0;
+const DWORD KHR_DF_CHANNEL_GREEN      = 1;
+const DWORD KHR_DF_CHANNEL_BLUE       = 2;
+const DWORD KHR_DF_CHANNEL_ALPHA      = 15;
+const DWORD KHR_DF_CHANNEL_BC1A_ALPHAPRESENT = 1;
+
+static void PutQword(DWORD dst[2], size_t value)
+{
+	dst[0] = DWORD(value);
+	dst[1] = DWORD((unsigned long long)value >> 32);
+}
+
+// Builds the basic data format descriptor, with one sample for each 
+// channel. The channels are given in the order they are stored.
+static void BuildDfd(std::vector<DWORD> &dfd, DWORD model, UINT blockDim, UINT bytesPlane0, const DWORD *channels, UINT numChannels, UINT bitsPerChannel)
+{
+	UINT blockSize = 24 + 16*numChannels;
+	dfd.assign(1 + blockSize/4, 0);
+	dfd[0] = 4 + blockSize;                  // dfdTotalSize
+	dfd[1] = 0;                              // vendorId and descriptorType, both Khronos basic
+	dfd[2] = 2 | (blockSize << 16);          // versionNumber and descriptorBlockSize
+	dfd[3] = model | (KHR_DF_PRIMARIES_BT709 << 8) | (KHR_DF_TRANSFER_LINEAR << 16);
+	dfd[4] = (blockDim - 1) | ((blockDim - 1) << 8);
+	dfd[5] = bytesPlane0;
+
+	for( UINT n = 0; n < numChannels; n++ )
+	{
+		DWORD *sample = &dfd[7 + n*4];
+		sample[0] = (n*bitsPerChannel) | ((bitsPerChannel - 1) << 16) | (channels[n] << 24);
+		sample[1] = 0;
+		sample[2] = 0;
+		sample[3] = bitsPerChannel == 8 ? 0xFF : 0xFFFFFFFF;
+	}
+}
+
+int SaveKtx2(const char *filename, UINT numLayers, const KtxLayerFunc &getLayer, DWORD flags)
+{
+	DWORD compression = flags & DDS_COMPRESSION_MASK;
+	if( compression > DDS_BC5 || numLayers == 0 )
+		return E_INVALID_ARG;
+
+	// Gather the level with all the layers after each other
+	std::vector<BYTE> level;
+	UINT width = 0, height = 0;
+	PixelFormat format = PF_A8;
+	for( UINT layer = 0; layer < numLayers; layer++ )
+	{
+		Image image;
+		int r = getLayer(layer, image);
+		if( r < 0 )
+			return r;
+
+		if( layer == 0 )
+		{
+			width  = image.width;
+			height = image.height;
+			format = image.format;
+			if( format != PF_A8 && format != PF_A8R8G8B8 && format != PF_A8B8G8R8 )
+				return E_FORMAT_NOT_SUPPORTED;
+			if( compression && compression != DDS_BC4 && format == PF_A8 )
+				return E_FORMAT_NOT_SUPPORTED;
+		}
+		else if( image.width != width || image.height != height || image.format != format )
+			return E_INVALID_ARG;
+
+		size_t offset = level.size();
+		try
+		{
+			if( compression )
+				level.resize(offset + size_t((width+3)/4) * ((height+3)/4) * GetBlockSize(compression));
+			else
+				level.resize(offset + size_t(width) * height * (format == PF_A8 ? 1 : 4));
+		}
+		catch( ... )
+		{
+			return E_OUT_OF_MEMORY;
+		}
+
+		if( compression )
+		{
+			r = CompressBlocks(image, flags, &level[offset]);
+			if( r < 0 )
+				return r;
+		}
+		else
+		{
+			// The rows are stored without padding
+			size_t rowSize = size_t(width) * (format == PF_A8 ? 1 : 4);
+			for( UINT y = 0; y < height; y++ )
+				memcpy(&level[offset + y*rowSize], &image.data[y*image.pitch], rowSize);
+		}
+	}
+
+	// Describe the format
+	Ktx2Header header;
+	memset(&header, 0, sizeof(header));
+	static const BYTE identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+	memcpy(header.identifier, identifier, 12);
+	header.typeSize    = 1;
+	header.pixelWidth  = width;
+	header.pixelHeight = height;
+	header.layerCount  = numLayers;
+	header.faceCount   = 1;
+	header.levelCount  = 1;
+
+	std::vector<DWORD> dfd;
+	UINT alignment;
+	if( compression == 0 )
+	{
+		static const DWORD r[1]    = {KHR_DF_CHANNEL_RED};
+		static const DWORD rgba[4] = {KHR_DF_CHANNEL_RED, KHR_DF_CHANNEL_GREEN, KHR_DF_CHANNEL_BLUE, KHR_DF_CHANNEL_ALPHA};
+		static const DWORD bgra[4] = {KHR_DF_CHANNEL_BLUE, KHR_DF_CHANNEL_GREEN, KHR_DF_CHANNEL_RED, KHR_DF_CHANNEL_ALPHA};
+		if( format == PF_A8 )
+		{
+			header.vkFormat = VK_FORMAT_R8_UNORM;
+			BuildDfd(dfd, KHR_DF_MODEL_RGBSDA, 1, 1, r, 1, 8);
+		}
+		else if( format == PF_A8B8G8R8 )
+		{
+			header.vkFormat = VK_FORMAT_R8G8B8A8_UNORM;
+			BuildDfd(dfd, KHR_DF_MODEL_RGBSDA, 1, 4, rgba, 4, 8);
+		}
+		else
+		{
+			header.vkFormat = VK_FORMAT_B8G8R8A8_UNORM;
+			BuildDfd(dfd, KHR_DF_MODEL_RGBSDA, 1, 4, bgra, 4, 8);
+		}
+		alignment = 4;
+	}
+	else
+	{
+		// The compressed formats describe each 64bit half of the block
+		static const DWORD bc1[1] = {KHR_DF_CHANNEL_BC1A_ALPHAPRESENT};
+		static const DWORD bc3[2] = {KHR_DF_CHANNEL_ALPHA, KHR_DF_CHANNEL_RED};
+		static const DWORD bc4[1] = {KHR_DF_CHANNEL_RED};
+		static const DWORD bc5[2] = {KHR_DF_CHANNEL_RED, KHR_DF_CHANNEL_GREEN};
+		UINT blockSize = GetBlockSize(compression);
+		if( compression == DDS_DXT1 )
+		{
+			header.vkFormat = VK_FORMAT_BC1_RGBA_UNORM;
+			BuildDfd(dfd, KHR_DF_MODEL_BC1A, 4, blockSize, bc1, 1, 64);
+		}
+		else if( compression == DDS_DXT3 )
+		{
+			header.vkFormat = VK_FORMAT_BC2_UNORM;
+			BuildDfd(dfd, KHR_DF_MODEL_BC2, 4, blockSize, bc3, 2, 64);
+		}
+		else if( compression == DDS_DXT5 )
+		{
+			header.vkFormat = VK_FORMAT_BC3_UNORM;
+			BuildDfd(dfd, KHR_DF_MODEL_BC3, 4, blockSize, bc3, 2, 64);
+		}
+		else if( compression == DDS_BC4 )
+		{
+			header.vkFormat = VK_FORMAT_BC4_UNORM;
+			BuildDfd(dfd, KHR_DF_MODEL_BC4, 4, blockSize, bc4, 1, 64);
+		}
+		else
+		{
+			header.vkFormat = VK_FORMAT_BC5_UNORM;
+			BuildDfd(dfd, KHR_DF_MODEL_BC5, 4, blockSize, bc5, 2, 64);
+		}
+		alignment = blockSize;
+	}
+
+	// The level is compressed as a single zlib stream
+	std::vector<BYTE> packed;
+	if( flags & KTX_ZLIB )
+	{
+		uLongf size = compressBound(uLong(level.size()));
+		try
+		{
+			packed.resize(size);
+		}
+		catch( ... )
+		{
+			return E_OUT_OF_MEMORY;
+		}
+		if( compress2(&packed[0], &size, &level[0], uLong(level.size()), Z_DEFAULT_COMPRESSION) != Z_OK )
+			return E_ERROR;
+		packed.resize(size);
+
+		header.supercompressionScheme = KTX_SUPERCOMPRESSION_ZLIB;
+		alignment = 1;
+	}
+	const std::vector<BYTE> &data = (flags & KTX_ZLIB) ? packed : level;
+
+	// Tell which application wrote the file
+	static const char writer[] = "KTXwriter\0AngelCode Bitmap Font Generator";
+	DWORD kvdEntryLength = sizeof(writer);
+	DWORD kvdLength = (4 + kvdEntryLength + 3) & ~3u;
+
+	header.dfdByteOffset = sizeof(Ktx2Header) + sizeof(Ktx2LevelIndex);
+	header.dfdByteLength = DWORD(dfd.size()*4);
+	header.kvdByteOffset = header.dfdByteOffset + header.dfdByteLength;
+	header.kvdByteLength = kvdLength;
+
+	DWORD levelOffset = header.kvdByteOffset + kvdLength;
+	if( levelOffset % alignment )
+		levelOffset += alignment - levelOffset % alignment;
+
+	Ktx2LevelIndex index;
+	PutQword(index.byteOffset, levelOffset);
+	PutQword(index.byteLength, data.size());
+	PutQword(index.uncompressedByteLength, level.size());
+
+	FILE *f = 0;
+	fopen_s(&f, filename, "wb");
+	if( f == 0 )
+		return E_FILE_ERROR;
+
+	static const BYTE zeroes[16] = {0};
+	fwrite(&header, sizeof(header), 1, f);
+	fwrite(&index, sizeof(index), 1, f);
+	fwrite(&dfd[0], 4, dfd.size(), f);
+	fwrite(&kvdEntryLength, 4, 1, f);
+	fwrite(writer, kvdEntryLength, 1, f);
+	fwrite(zeroes, kvdLength - 4 - kvdEntryLength, 1, f);
+	fwrite(zeroes, levelOffset - header.kvdByteOffset - kvdLength, 1, f);
+	fwrite(&data[0], data.size(), 1, f);
+
+	bool failed = ferror(f) != 0;
+	fclose(f);
+
+	return failed ? E_FILE_ERROR : E_SUCCESS;
+}
+
+} // namespace acImage
@@ -28,24 +28,279 @@
 // 2016-02-21  Using fopen_s to please MSVC
 
 #include <png.h>
+#include <zlib.h>
 #include <vector>
+#include <atomic>
 #include <stdio.h>
+#include <string.h>
 
 #include "acimg.h"
+#include "acutil_parallel.h"
 
 namespace acImage
 {
 
-int SavePng(const char *filename, Image &image)
+static int PaethPredictor(int a, int b, int c)
+{
+	int p  = a + b - c;
+	int pa = p > a ? p - a : a - p;
+	int pb = p > b ? p - b : b - p;
+	int pc = p > c ? p - c : c - p;
+	if( pa <= pb && pa <= pc ) return a;
+	if( pb <= pc ) return b;
+	return c;
+}
+
+// Writes the filter type followed by the filtered row. prev is 0 for the first row.
+static void FilterRow(int type, const BYTE *row, const BYTE *prev, UINT rowBytes, UINT bpp, BYTE *out)
+{
+	*out++ = BYTE(type);
+	for( UINT i = 0; i < rowBytes; i++ )
+	{
+		int a = i >= bpp ? row[i-bpp] : 0;
+		int b = prev ? prev[i] : 0;
+		int c = prev && i >= bpp ? prev[i-bpp] : 0;
+
+		switch( type )
+		{
+		case 0: out[i] = row[i]; break;
+		case 1: out[i] = BYTE(row[i] - a); break;
+		case 2: out[i] = BYTE(row[i] - b); break;
+		case 3: out[i] = BYTE(row[i] - ((a + b) >> 1)); break;
+		case 4: out[i] = BYTE(row[i] - PaethPredictor(a, b, c)); break;
+		}
+	}
+}
+
+// The same heuristic as libpng; the filter with the smallest sum 
+// of the absolute values, when seen as signed bytes, is chosen
+static void FilterRowAdaptive(const BYTE *row, const BYTE *prev, UINT rowBytes, UINT bpp, BYTE *out, BYTE *temp)
+{
+	UINT bestSum = 0xFFFFFFFF;
+	for( int type = 0; type < 5; type++ )
+	{
+		BYTE *dst = bestSum == 0xFFFFFFFF ? out : temp;
+		FilterRow(type, row, prev, rowBytes, bpp, dst);
+
+		UINT sum = 0;
+		for( UINT i = 1; i <= rowBytes && sum < bestSum; i++ )
+			sum += dst[i] < 128 ? dst[i] : 256 - dst[i];
+
+		if( sum < bestSum )
+		{
+			if( dst != out )
+				memcpy(out, dst, rowBytes+1);
+			bestSum = sum;
+		}
+	}
+}
+
+// Copies a row to the byte order used by PNG, i.e. RGB(A) instead of BGR(A)
+static void ConvertRow(const Image &image, UINT y, UINT bpp, BYTE *out)
+{
+	const BYTE *src = image.data + y*image.pitch;
+	if( bpp == 1 || image.format == PF_A8B8G8R8 )
+	{
+		memcpy(out, src, image.width*bpp);
+		return;
+	}
+
+	for( UINT x = 0; x < image.width; x++, src += bpp, out += bpp )
+	{
+		out[0] = src[2];
+		out[1] = src[1];
+		out[2] = src[0];
+		if( bpp == 4 )
+			out[3] = src[3];
+	}
+}
+
+static void WritePngChunk(FILE *f, const char *type, const BYTE *data, UINT length)
+{
+	BYTE header[8] = {BYTE(length>>24), BYTE(length>>16), BYTE(length>>8), BYTE(length), 
+	                  BYTE(type[0]), BYTE(type[1]), BYTE(type[2]), BYTE(type[3])};
+	fwrite(header, 8, 1, f);
+	if( length )
+		fwrite(data, length, 1, f);
+
+	uLong crc = crc32(0, header+4, 4);
+	if( length )
+		crc = crc32(crc, data, length);
+	BYTE footer[4] = {BYTE(crc>>24), BYTE(crc>>16), BYTE(crc>>8), BYTE(crc)};
+	fwrite(footer, 4, 1, f);
+}
+
+// Filters and compresses stripes of rows on multiple threads. Each stripe is 
+// compressed as a separate raw deflate stream that ends on a byte boundary, 
+// with the end of the previous stripe as the dictionary, so that the stripes 
+// can be concatenated into a single zlib stream just like pigz does.
+static int SavePngParallel(const char *filename, Image &image, int level, DWORD filter)
+{
+	UINT bpp      = image.format == PF_A8R8G8B8 || image.format == PF_A8B8G8R8 ? 4 : (image.format == PF_R8G8B8 ? 3 : 1);
+	UINT rowBytes = image.width*bpp;
+	UINT lineSize = rowBytes + 1;
+
+	const UINT windowSize    = 32768;
+	const UINT rowsPerStripe = lineSize >= 256*1024 ? 1 : (256*1024)/lineSize;
+	const UINT numStripes    = (image.height + rowsPerStripe - 1)/rowsPerStripe;
+
+	std::vector<BYTE> filtered;
+	std::vector<std::vector<BYTE> > compressed(numStripes);
+	std::vector<uLong> adlers(numStripes);
+	try
+	{
+		filtered.resize(size_t(lineSize)*image.height);
+	}
+	catch( ... )
+	{
+		return E_OUT_OF_MEMORY;
+	}
+
+	// Filter the rows in stripes
+	acUtility::ParallelFor(numStripes, [&](unsigned int stripe)
+	{
+		std::vector<BYTE> rows(rowBytes*2), temp(lineSize);
+		BYTE *curr = &rows[0], *prev = &rows[rowBytes];
+
+		UINT first = stripe*rowsPerStripe;
+		UINT last  = first + rowsPerStripe < image.height ? first + rowsPerStripe : image.height;
+		if( first > 0 )
+			ConvertRow(image, first-1, bpp, prev);
+
+		for( UINT y = first; y < last; y++ )
+		{
+			ConvertRow(image, y, bpp, curr);
+
+			BYTE *out = &filtered[size_t(y)*lineSize];
+			const BYTE *above = y > 0 ? prev : 0;
+			if( filter == PNG_ROWFILTER_ADAPTIVE && level != 0 )
+				FilterRowAdaptive(curr, above, rowBytes, bpp, out, &temp[0]);
+			else
+			{
+				int type = 0;
+				if( filter == PNG_ROWFILTER_SUB )   type = 1;
+				if( filter == PNG_ROWFILTER_UP )    type = 2;
+				if( filter == PNG_ROWFILTER_PAETH ) type = 4;
+				FilterRow(type, curr, above, rowBytes, bpp, out);
+			}
+
+			BYTE *t = curr; curr = prev; prev = t;
+		}
+	});
+
+	// Compress the stripes. Any of the workers may flag the failure
+	std::atomic<bool> failed(false);
+	acUtility::ParallelFor(numStripes, [&](unsigned int stripe)
+	{
+		size_t start = size_t(stripe)*rowsPerStripe*lineSize;
+		size_t end   = start + size_t(rowsPerStripe)*lineSize;
+		if( end > filtered.size() ) end = filtered.size();
+		bool isLast  = stripe == numStripes - 1;
+
+		z_stream z;
+		memset(&z, 0, sizeof(z));
+		if( deflateInit2(&z, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK )
+		{
+			failed = true;
+			return;
+		}
+
+		if( start > 0 )
+		{
+			size_t dictSize = start < windowSize ? start : windowSize;
+			deflateSetDictionary(&z, &filtered[start - dictSize], uInt(dictSize));
+		}
+
+		std::vector<BYTE> &out = compressed[stripe];
+		out.resize(deflateBound(&z, uLong(end - start)) + 16);
+
+		z.next_in   = &filtered[start];
+		z.avail_in  = uInt(end - start);
+		z.next_out  = &out[0];
+		z.avail_out = uInt(out.size());
+
+		// The sync flush ends the stream on a byte boundary without marking the last block
+		int r;
+		while( (r = deflate(&z, isLast ? Z_FINISH : Z_SYNC_FLUSH)) == Z_OK && z.avail_out == 0 )
+		{
+			size_t used = out.size();
+			out.resize(used*2);
+			z.next_out  = &out[used];
+			z.avail_out = uInt(out.size() - used);
+		}
+		if( r != Z_OK && r != Z_STREAM_END )
+			failed = true;
+
+		out.resize(z.total_out);
+		deflateEnd(&z);
+
+		adlers[stripe] = adler32(adler32(0, 0, 0), &filtered[start], uInt(end - start));
+	});
+
+	if( failed )
+		return E_ERROR;
+
+	FILE *f = 0;
+	fopen_s(&f, filename, "wb");
+	if( f == 0 )
+		return E_FILE_ERROR;
+
+	static const BYTE signature[8] = {137, 'P', 'N', 'G', 13, 10, 26, 10};
+	fwrite(signature, 8, 1, f);
+
+	BYTE ihdr[13] = {BYTE(image.width>>24), BYTE(image.width>>16), BYTE(image.width>>8), BYTE(image.width),
+	                 BYTE(image.height>>24), BYTE(image.height>>16), BYTE(image.height>>8), BYTE(image.height),
+	                 8, BYTE(bpp == 4 ? 6 : (bpp == 3 ? 2 : 0)), 0, 0, 0};
+	WritePngChunk(f, "IHDR", ihdr, 13);
+
+	// The zlib header tells the level in the flags, and must be a multiple of 31
+	BYTE zheader[2] = {0x78, 0};
+	zheader[1] = BYTE((level < 0 || level == 6 ? 2 : (level < 2 ? 0 : (level < 6 ? 1 : 3))) << 6);
+	zheader[1] += BYTE(31 - (zheader[0]*256 + zheader[1]) % 31);
+	WritePngChunk(f, "IDAT", zheader, 2);
+
+	// Each stripe is written as its own IDAT chunk, while the checksum is 
+	// combined for the whole uncompressed stream
+	uLong adler = adler32(0, 0, 0);
+	for( UINT n = 0; n < numStripes; n++ )
+	{
+		if( compressed[n].size() )
+			WritePngChunk(f, "IDAT", &compressed[n][0], UINT(compressed[n].size()));
+
+		size_t length = n == numStripes - 1 ? filtered.size() - size_t(n)*rowsPerStripe*lineSize : size_t(rowsPerStripe)*lineSize;
+		adler = adler32_combine(adler, adlers[n], z_off_t(length));
+	}
+
+	BYTE trailer[4] = {BYTE(adler>>24), BYTE(adler>>16), BYTE(adler>>8), BYTE(adler)};
+	WritePngChunk(f, "IDAT", trailer, 4);
+	WritePngChunk(f, "IEND", 0, 0);
+
+	fclose(f);
+
+	return E_SUCCESS;
+}
+
+int SavePng(const char *filename, Image &image, DWORD flags)
 {
 	// Validate the image
 	if( image.format != PF_A8R8G8B8 &&
+		image.format != PF_A8B8G8R8 &&
 		image.format != PF_R8G8B8 &&
 		image.format != PF_A8 )
 	{
 		return E_FORMAT_NOT_SUPPORTED;
 	}
 
+	int level = int(flags & PNG_LEVEL_MASK) - 1;
+	if( level > 9 ) 
+		return E_INVALID_ARG;
+	if( level < 0 )
+		level = Z_DEFAULT_COMPRESSION;
+
+	DWORD filter = flags & PNG_ROWFILTER_MASK;
+
+	if( flags & PNG_PARALLEL )
+		return SavePngParallel(filename, image, level, filter);
 
 	png_structp png = 0;
 	png_infop   info = 0;
@@ -87,6 +342,7 @@ int SavePng(const char *filename, Image &image)
 	// Set the image information
 	int color_type;
 	if(      image.format == PF_A8R8G8B8 ) color_type = PNG_COLOR_TYPE_RGB_ALPHA;
+	else if( image.format == PF_A8B8G8R8 ) color_type = PNG_COLOR_TYPE_RGB_ALPHA;
 	else if( image.format == PF_R8G8B8   ) color_type = PNG_COLOR_TYPE_RGB;
 	else if( image.format == PF_A8       ) color_type = PNG_COLOR_TYPE_GRAY;
 
@@ -97,11 +353,21 @@ int SavePng(const char *filename, Image &image)
 	png_set_IHDR(png, info, image.width, image.height, 8, color_type, 
 		interlace_type, PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
 
+	png_set_compression_level(png, level);
+
+	// Without compression the filters would only waste time
+	int filters = PNG_ALL_FILTERS;
+	if( filter == PNG_ROWFILTER_NONE || level == 0 ) filters = PNG_FILTER_NONE;
+	else if( filter == PNG_ROWFILTER_SUB )           filters = PNG_FILTER_SUB;
+	else if( filter == PNG_ROWFILTER_UP )            filters = PNG_FILTER_UP;
+	else if( filter == PNG_ROWFILTER_PAETH )         filters = PNG_FILTER_PAETH;
+	png_set_filter(png, PNG_FILTER_TYPE_BASE, filters);
+
 	// Write the file header information
 	png_write_info(png, info);
 
 	// We need to swap the order of the color channels (not alpha)
-	if( color_type != PNG_COLOR_TYPE_GRAY )
+	if( color_type != PNG_COLOR_TYPE_GRAY && image.format != PF_A8B8G8R8 )
 		png_set_bgr(png);
 
 /* TODO: We can allow the application to pass in a 32bit image and only save the rgb channels
@@ -0,0 +1,254 @@
+/*
+   AngelCode Tool Box Library
+   Copyright (c) 2016 Andreas Jonsson
+  
+   This software is provided 'as-is', without any express or implied 
+   warranty. In no event will the authors be held liable for any 
+   damages arising from the use of this software.
+
+   Permission is granted to anyone to use this software for any 
+   purpose, including commercial applications, and to alter it and 
+   redistribute it freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you 
+      must not claim that you wrote the original software. If you use
+      this software in a product, an acknowledgment in the product 
+      documentation would be appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and 
+      must not be misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source 
+      distribution.
+  
+   Andreas Jonsson
+   andreas@angelcode.com
+*/
+
+#include "acutil_file.h"
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <windows.h>
+
+using namespace std;
+
+namespace acUtility
+{
+
+string GetTempOutputName(const string &filename)
+{
+	return filename + ".tmp";
+}
+
+bool AreFilesEqual(const string &file1, const string &file2)
+{
+	// Files with different sizes can't be equal, so there is no need to read them.
+	// The sizes are 64bit so files larger than 2GB are compared correctly too
+	long long size1 = GetFileLength(file1);
+	if( size1 < 0 || size1 != GetFileLength(file2) )
+		return false;
+
+	FILE *f1 = 0, *f2 = 0;
+	if( fopen_s(&f1, file1.c_str(), "rb") != 0 || f1 == 0 )
+		return false;
+	if( fopen_s(&f2, file2.c_str(), "rb") != 0 || f2 == 0 )
+	{
+		fclose(f1);
+		return false;
+	}
+
+	bool equal = true;
+	const size_t chunkSize = 65536;
+	vector<char> buf1(chunkSize), buf2(chunkSize);
+	while( equal )
+	{
+		size_t r1 = fread(&buf1[0], 1, chunkSize, f1);
+		size_t r2 = fread(&buf2[0], 1, chunkSize, f2);
+		if( r1 != r2 || memcmp(&buf1[0], &buf2[0], r1) != 0 )
+			equal = false;
+		if( r1 < chunkSize )
+			break;
+	}
+
+	fclose(f1);
+	fclose(f2);
+
+	return equal;
+}
+
+long long GetFileLength(const string &filename)
+{
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if( !GetFileAttributesExA(filename.c_str(), GetFileExInfoStandard, &data) )
+		return -1;
+
+	return ((long long)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+}
+
+int CommitFile(const string &tempFile, const string &filename)
+{
+	if( AreFilesEqual(tempFile, filename) )
+	{
+		remove(tempFile.c_str());
+		return 0;
+	}
+
+	if( !MoveFileExA(tempFile.c_str(), filename.c_str(), MOVEFILE_REPLACE_EXISTING) )
+	{
+		remove(tempFile.c_str());
+		return -1;
+	}
+
+	return 1;
+}
+
+int LinkOrCopyFile(const string &existingFile, const string &newFile)
+{
+	if( CreateHardLinkA(newFile.c_str(), existingFile.c_str(), 0) )
+		return 0;
+
+	if( CopyFileA(existingFile.c_str(), newFile.c_str(), TRUE) )
+		return 0;
+
+	return -1;
+}
+
+unsigned long long HashData(const void *data, size_t size, unsigned long long hash)
+{
+	const unsigned char *p = (const unsigned char *)data;
+	for( size_t n = 0; n < size; n++ )
+	{
+		hash ^= p[n];
+		hash *= 1099511628211ull;
+	}
+
+	return hash;
+}
+
+int FindFiles(const string &path, vector<string> &files)
+{
+	DWORD attr = GetFileAttributesA(path.c_str());
+	if( attr == INVALID_FILE_ATTRIBUTES )
+		return -1;
+
+	if( !(attr & FILE_ATTRIBUTE_DIRECTORY) )
+	{
+		files.push_back(path);
+		return 0;
+	}
+
+	string dir = path;
+	if( dir != "" && dir[dir.length()-1] != '\\' && dir[dir.length()-1] != '/' )
+		dir += "\\";
+
+	WIN32_FIND_DATAA fd;
+	HANDLE h = FindFirstFileA((dir + "*").c_str(), &fd);
+	if( h == INVALID_HANDLE_VALUE )
+		return 0;
+
+	do
+	{
+		if( strcmp(fd.cFileName, ".") == 0 || strcmp(fd.cFileName, "..") == 0 )
+			continue;
+
+		if( fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY )
+			FindFiles(dir + fd.cFileName, files);
+		else
+			files.push_back(dir + fd.cFileName);
+	} while( FindNextFileA(h, &fd) );
+
+	FindClose(h);
+
+	return 0;
+}
+
+CMappedFile::CMappedFile()
+{
+	fileHandle = INVALID_HANDLE_VALUE;
+	mapping    = 0;
+	data       = 0;
+	size       = 0;
+}
+
+CMappedFile::~CMappedFile()
+{
+	Close();
+}
+
+int CMappedFile::Open(const string &filename)
+{
+	Close();
+
+	HANDLE f = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+	if( f == INVALID_HANDLE_VALUE )
+		return -1;
+	fileHandle = f;
+
+	LARGE_INTEGER fileSize;
+	if( !GetFileSizeEx(f, &fileSize) || (unsigned long long)fileSize.QuadPart > (size_t)-1 )
+	{
+		Close();
+		return -1;
+	}
+
+	// Empty files can't be mapped
+	if( fileSize.QuadPart == 0 )
+		return 0;
+
+	mapping = CreateFileMapping(f, 0, PAGE_READONLY, 0, 0, 0);
+	if( mapping == 0 )
+	{
+		Close();
+		return -1;
+	}
+
+	data = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if( data == 0 )
+	{
+		Close();
+		return -1;
+	}
+
+	size = (size_t)fileSize.QuadPart;
+
+	return 0;
+}
+
+void CMappedFile::Close()
+{
+	if( data )
+		UnmapViewOfFile(data);
+	if( mapping )
+		CloseHandle(mapping);
+	if( fileHandle != INVALID_HANDLE_VALUE )
+		CloseHandle(fileHandle);
+
+	fileHandle = INVALID_HANDLE_VALUE;
+	mapping    = 0;
+	data       = 0;
+	size       = 0;
+}
+
+int HashFile(const string &filename, unsigned long long &hash)
+{
+	FILE *f = 0;
+	if( fopen_s(&f, filename.c_str(), "rb") != 0 || f == 0 )
+		return -1;
+
+	const size_t chunkSize = 65536;
+	vector<char> buf(chunkSize);
+	for( ;; )
+	{
+		size_t r = fread(&buf[0], 1, chunkSize, f);
+		hash = HashData(&buf[0], r, hash);
+		if( r < chunkSize )
+			break;
+	}
+
+	fclose(f);
+
+	return 0;
+}
+
+}
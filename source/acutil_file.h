@@ -0,0 +1,94 @@
+/*
+   AngelCode Tool Box Library
+   Copyright (c) 2016 Andreas Jonsson
+  
+   This software is provided 'as-is', without any express or implied 
+   warranty. In no event will the authors be held liable for any 
+   damages arising from the use of this software.
+
+   Permission is granted to anyone to use this software for any 
+   purpose, including commercial applications, and to alter it and 
+   redistribute it freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you 
+      must not claim that you wrote the original software. If you use
+      this software in a product, an acknowledgment in the product 
+      documentation would be appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and 
+      must not be misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source 
+      distribution.
+  
+   Andreas Jonsson
+   andreas@angelcode.com
+*/
+
+#ifndef ACUTIL_FILE_H
+#define ACUTIL_FILE_H
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+namespace acUtility
+{
+
+// Returns the name of the temporary file that an output is written to 
+// before it is committed over the target file with CommitFile
+std::string GetTempOutputName(const std::string &filename);
+
+// Returns true if both files exist and have exactly the same content
+bool AreFilesEqual(const std::string &file1, const std::string &file2);
+
+// Returns the size of the file in bytes, or -1 if it doesn't exist
+long long GetFileLength(const std::string &filename);
+
+// Replaces the file with the temporary file, unless the content is the same
+// in which case the file is left untouched and the temporary file is removed.
+// The replace is done with a rename so the file is never partially written.
+// Returns 1 if the file was replaced, 0 if it was unchanged, and -1 on error.
+int CommitFile(const std::string &tempFile, const std::string &filename);
+
+// Creates a new name for the existing file, or a copy if the file system 
+// doesn't support hard links. The destination must not exist.
+int LinkOrCopyFile(const std::string &existingFile, const std::string &newFile);
+
+// 64bit FNV-1a hash. The hash of multiple pieces of data is computed by 
+// passing the previous hash as the initial value for the next piece
+const unsigned long long HASH_INIT = 14695981039346656037ull;
+unsigned long long HashData(const void *data, size_t size, unsigned long long hash = HASH_INIT);
+
+// Hashes the content of the file. Returns -1 if the file can't be read
+int HashFile(const std::string &filename, unsigned long long &hash);
+
+// Adds the file to the list, or if the path is a directory all the files in
+// it and in its subdirectories. Returns -1 if the path doesn't exist
+int FindFiles(const std::string &path, std::vector<std::string> &files);
+
+// A read only view of a complete file mapped into memory, so the
+// content can be accessed directly without reading it first
+class CMappedFile
+{
+public:
+	CMappedFile();
+	~CMappedFile();
+
+	// An empty file is opened successfully, but has no data
+	int  Open(const std::string &filename);
+	void Close();
+
+	const unsigned char *GetData() const { return data; }
+	size_t               GetSize() const { return size; }
+
+protected:
+	void                *fileHandle;
+	void                *mapping;
+	const unsigned char *data;
+	size_t               size;
+};
+
+}
+
+#endif
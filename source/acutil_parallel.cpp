@@ -0,0 +1,133 @@
+/*
+   AngelCode Tool Box Library
+   Copyright (c) 2016 Andreas Jonsson
+  
+   This software is provided 'as-is', without any express or implied 
+   warranty. In no event will the authors be held liable for any 
+   damages arising from the use of this software.
+
+   Permission is granted to anyone to use this software for any 
+   purpose, including commercial applications, and to alter it and 
+   redistribute it freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you 
+      must not claim that you wrote the original software. If you use
+      this software in a product, an acknowledgment in the product 
+      documentation would be appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and 
+      must not be misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source 
+      distribution.
+  
+   Andreas Jonsson
+   andreas@angelcode.com
+*/
+
+#include "acutil_parallel.h"
+#include <thread>
+#include <atomic>
+#include <vector>
+
+using namespace std;
+
+namespace acUtility
+{
+
+static atomic<unsigned int> maxThreads(0);
+
+// Set for the threads that are executing a ParallelFor
+static thread_local bool isInParallelFor = false;
+
+// The number of threads that are executing calls for any ParallelFor. Nested
+// loops may only start new threads while this is below the maximum
+static atomic<unsigned int> busyThreads(0);
+
+void SetMaxThreads(unsigned int numThreads)
+{
+	maxThreads = numThreads;
+}
+
+unsigned int GetMaxThreads()
+{
+	unsigned int numThreads = maxThreads;
+	if( numThreads == 0 )
+		numThreads = thread::hardware_concurrency();
+	if( numThreads == 0 )
+		numThreads = 1;
+
+	return numThreads;
+}
+
+void ParallelFor(unsigned int count, const function<void(unsigned int)> &func, unsigned int maxConcurrent)
+{
+	unsigned int totalThreads = GetMaxThreads();
+	unsigned int numThreads = totalThreads;
+	if( maxConcurrent && numThreads > maxConcurrent )
+		numThreads = maxConcurrent;
+	if( numThreads > count )
+		numThreads = count;
+
+	// The calling thread is counted as busy unless it already runs a call
+	// for an outer loop. Nested loops get the threads that the outer loops 
+	// leave idle, e.g. when they limit how many calls may run at a time
+	bool isOuter = !isInParallelFor;
+	if( isOuter )
+		busyThreads++;
+
+	unsigned int extraThreads = 0;
+	if( numThreads > 1 )
+	{
+		unsigned int busy = busyThreads;
+		do
+		{
+			extraThreads = busy < totalThreads ? totalThreads - busy : 0;
+			if( extraThreads > numThreads - 1 )
+				extraThreads = numThreads - 1;
+		} while( extraThreads && !busyThreads.compare_exchange_weak(busy, busy + extraThreads) );
+	}
+
+	// Run the calls in this thread if there is no need for more, or no
+	// more threads are available
+	if( extraThreads == 0 )
+	{
+		isInParallelFor = true;
+		for( unsigned int n = 0; n < count; n++ )
+			func(n);
+		isInParallelFor = !isOuter;
+		if( isOuter )
+			busyThreads--;
+		return;
+	}
+
+	atomic<unsigned int> next(0);
+	auto worker = [&]()
+	{
+		isInParallelFor = true;
+		for( ;; )
+		{
+			unsigned int n = next++;
+			if( n >= count )
+				break;
+			func(n);
+		}
+	};
+
+	// The calling thread does its share of the work too
+	vector<thread> threads;
+	threads.reserve(extraThreads);
+	for( unsigned int t = 0; t < extraThreads; t++ )
+		threads.push_back(thread(worker));
+	worker();
+	isInParallelFor = !isOuter;
+
+	for( size_t t = 0; t < threads.size(); t++ )
+		threads[t].join();
+
+	busyThreads -= extraThreads;
+	if( isOuter )
+		busyThreads--;
+}
+
+}
@@ -0,0 +1,52 @@
+/*
+   AngelCode Tool Box Library
+   Copyright (c) 2016 Andreas Jonsson
+  
+   This software is provided 'as-is', without any express or implied 
+   warranty. In no event will the authors be held liable for any 
+   damages arising from the use of this software.
+
+   Permission is granted to anyone to use this software for any 
+   purpose, including commercial applications, and to alter it and 
+   redistribute it freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you 
+      must not claim that you wrote the original software. If you use
+      this software in a product, an acknowledgment in the product 
+      documentation would be appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and 
+      must not be misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source 
+      distribution.
+  
+   Andreas Jonsson
+   andreas@angelcode.com
+*/
+
+#ifndef ACUTIL_PARALLEL_H
+#define ACUTIL_PARALLEL_H
+
+#include <functional>
+
+namespace acUtility
+{
+
+// Sets the maximum number of threads used by ParallelFor. 0 means
+// that one thread is used for each logical processor in the system
+void SetMaxThreads(unsigned int numThreads);
+unsigned int GetMaxThreads();
+
+// Calls func once for each index from 0 to count-1, spread over multiple
+// threads. The function returns when all the calls have completed. The
+// indices are handed out in increasing order, but may complete in any order.
+// ParallelFor called from within one of the calls only uses the threads that
+// the outer loops leave idle, and runs in the calling thread if there are none.
+// maxConcurrent limits how many calls may run at the same time, 0 means no
+// other limit than the maximum number of threads.
+void ParallelFor(unsigned int count, const std::function<void(unsigned int)> &func, unsigned int maxConcurrent = 0);
+
+}
+
+#endif
@@ -0,0 +1,217 @@
+/*
+   AngelCode Tool Box Library
+   Copyright (c) 2024 Andreas Jonsson
+  
+   This software is provided 'as-is', without any express or implied 
+   warranty. In no event will the authors be held liable for any 
+   damages arising from the use of this software.
+
+   Permission is granted to anyone to use this software for any 
+   purpose, including commercial applications, and to alter it and 
+   redistribute it freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you 
+      must not claim that you wrote the original software. If you use
+      this software in a product, an acknowledgment in the product 
+      documentation would be appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and 
+      must not be misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source 
+      distribution.
+  
+   Andreas Jonsson
+   andreas@angelcode.com
+*/
+#include "acutil_profiler.h"
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+
+using namespace std;
+
+namespace acUtility
+{
+
+// The profilers are rarely used from more than a few threads at a 
+// time, so they can share the lock without much contention
+static mutex lock;
+
+static long long GetClock()
+{
+	return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Numbers the threads in the order they first record something, 
+// which is easier to follow in the trace than the system's ids
+static int GetThreadIndex()
+{
+	static atomic<int> numThreads(0);
+	static thread_local int index = -1;
+	if( index < 0 )
+		index = numThreads++;
+
+	return index;
+}
+
+CProfiler::CProfiler()
+{
+	enabled = false;
+	origin  = GetClock();
+}
+
+void CProfiler::Enable(bool enable)
+{
+	enabled = enable;
+}
+
+void CProfiler::Clear()
+{
+	lock_guard<mutex> guard(lock);
+	events.clear();
+	counters.clear();
+}
+
+long long CProfiler::GetTime() const
+{
+	return GetClock() - origin;
+}
+
+void CProfiler::AddPhase(const char *name, long long start, const char *arg1, int value1, const char *arg2, int value2)
+{
+	if( !enabled ) return;
+
+	SEvent e;
+	e.name     = name;
+	e.start    = start;
+	e.duration = GetTime() - start;
+	e.thread   = GetThreadIndex();
+	e.arg[0]   = arg1;
+	e.arg[1]   = arg2;
+	e.value[0] = value1;
+	e.value[1] = value2;
+
+	lock_guard<mutex> guard(lock);
+	events.push_back(e);
+}
+
+void CProfiler::AddCount(const char *name, long long value)
+{
+	if( !enabled ) return;
+
+	lock_guard<mutex> guard(lock);
+	for( size_t n = 0; n < counters.size(); n++ )
+	{
+		if( strcmp(counters[n].name, name) == 0 )
+		{
+			counters[n].value += value;
+			return;
+		}
+	}
+
+	SCounter c = {name, value};
+	counters.push_back(c);
+}
+
+void CProfiler::GetPhaseTotals(vector<SPhaseTotal> &totals) const
+{
+	lock_guard<mutex> guard(lock);
+	totals.clear();
+	for( size_t n = 0; n < events.size(); n++ )
+	{
+		size_t t = 0;
+		while( t < totals.size() && strcmp(totals[t].name, events[n].name) != 0 )
+			t++;
+		if( t == totals.size() )
+		{
+			SPhaseTotal total = {events[n].name, 0, 0};
+			totals.push_back(total);
+		}
+
+		totals[t].count++;
+		totals[t].duration += events[n].duration;
+	}
+}
+
+void CProfiler::GetCounters(vector<SCounter> &counters) const
+{
+	lock_guard<mutex> guard(lock);
+	counters = this->counters;
+}
+
+int CProfiler::WriteChromeTrace(const string &filename) const
+{
+	FILE *f = 0;
+	if( fopen_s(&f, filename.c_str(), "wb") != 0 || f == 0 )
+		return -1;
+
+	lock_guard<mutex> guard(lock);
+
+	fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+	// Complete events with the start and duration of each phase
+	long long end = 0;
+	int numThreads = 0;
+	for( size_t n = 0; n < events.size(); n++ )
+	{
+		const SEvent &e = events[n];
+		fprintf(f, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%lld,\"dur\":%lld", e.name, e.thread, e.start, e.duration);
+		if( e.arg[0] )
+		{
+			fprintf(f, ",\"args\":{\"%s\":%d", e.arg[0], e.value[0]);
+			if( e.arg[1] )
+				fprintf(f, ",\"%s\":%d", e.arg[1], e.value[1]);
+			fprintf(f, "}");
+		}
+		fprintf(f, "},\n");
+
+		if( e.start + e.duration > end ) end = e.start + e.duration;
+		if( e.thread >= numThreads ) numThreads = e.thread + 1;
+	}
+
+	// The counters are only known as totals, so they are shown at the end
+	for( size_t n = 0; n < counters.size(); n++ )
+		fprintf(f, "{\"name\":\"%s\",\"ph\":\"C\",\"pid\":1,\"tid\":0,\"ts\":%lld,\"args\":{\"value\":%lld}},\n", counters[n].name, end, counters[n].value);
+
+	for( int n = 0; n < numThreads; n++ )
+		fprintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"Thread %d\"}},\n", n, n);
+	fprintf(f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"bmfont\"}}\n");
+
+	fprintf(f, "]}\n");
+
+	bool ok = ferror(f) == 0;
+	fclose(f);
+
+	return ok ? 0 : -1;
+}
+
+CProfilePhase::CProfilePhase(CProfiler &profiler, const char *name, const char *arg1, int value1, const char *arg2, int value2) : profiler(profiler)
+{
+	this->name = name;
+	arg[0]     = arg1;
+	arg[1]     = arg2;
+	value[0]   = value1;
+	value[1]   = value2;
+
+	// Avoid reading the clock when the profiler is disabled
+	isRunning  = profiler.IsEnabled();
+	start      = isRunning ? profiler.GetTime() : 0;
+}
+
+CProfilePhase::~CProfilePhase()
+{
+	End();
+}
+
+void CProfilePhase::End()
+{
+	if( !isRunning ) return;
+	isRunning = false;
+
+	profiler.AddPhase(name, start, arg[0], value[0], arg[1], value[1]);
+}
+
+}
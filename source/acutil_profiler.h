@@ -0,0 +1,119 @@
+/*
+   AngelCode Tool Box Library
+   Copyright (c) 2024 Andreas Jonsson
+  
+   This software is provided 'as-is', without any express or implied 
+   warranty. In no event will the authors be held liable for any 
+   damages arising from the use of this software.
+
+   Permission is granted to anyone to use this software for any 
+   purpose, including commercial applications, and to alter it and 
+   redistribute it freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you 
+      must not claim that you wrote the original software. If you use
+      this software in a product, an acknowledgment in the product 
+      documentation would be appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and 
+      must not be misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source 
+      distribution.
+  
+   Andreas Jonsson
+   andreas@angelcode.com
+*/
+#ifndef ACUTIL_PROFILER_H
+#define ACUTIL_PROFILER_H
+
+#include <string>
+#include <vector>
+
+namespace acUtility
+{
+
+// Collects the time spent in named phases and the totals of named counters.
+// While it is disabled the calls return right away, so they can be left in 
+// the code. Only the pointers of the names are kept, so they must be string
+// literals. The profiler can be used from multiple threads at the same time.
+class CProfiler
+{
+public:
+	CProfiler();
+
+	void Enable(bool enable);
+	bool IsEnabled() const { return enabled; }
+	void Clear();
+
+	// Returns the time in microseconds since the profiler was created
+	long long GetTime() const;
+
+	// Records a phase that started at the time given by GetTime and ends now. 
+	// The phase can have up to two named values, e.g. the page and channel.
+	void AddPhase(const char *name, long long start, const char *arg1 = 0, int value1 = 0, const char *arg2 = 0, int value2 = 0);
+
+	// Adds the value to the counter
+	void AddCount(const char *name, long long value);
+
+	struct SPhaseTotal
+	{
+		const char *name;
+		int         count;
+		long long   duration;
+	};
+
+	struct SCounter
+	{
+		const char *name;
+		long long   value;
+	};
+
+	// Returns the total time of each phase and the counters, in the 
+	// order they were first recorded
+	void GetPhaseTotals(std::vector<SPhaseTotal> &totals) const;
+	void GetCounters(std::vector<SCounter> &counters) const;
+
+	// Writes the phases and counters in the Chrome trace event format, 
+	// which can be opened in chrome://tracing. Returns -1 on error
+	int  WriteChromeTrace(const std::string &filename) const;
+
+protected:
+	struct SEvent
+	{
+		const char *name;
+		long long   start;
+		long long   duration;
+		int         thread;
+		const char *arg[2];
+		int         value[2];
+	};
+
+	bool                  enabled;
+	long long             origin;
+	std::vector<SEvent>   events;
+	std::vector<SCounter> counters;
+};
+
+// Records a phase from construction until End is called, or the 
+// object goes out of scope
+class CProfilePhase
+{
+public:
+	CProfilePhase(CProfiler &profiler, const char *name, const char *arg1 = 0, int value1 = 0, const char *arg2 = 0, int value2 = 0);
+	~CProfilePhase();
+
+	void End();
+
+protected:
+	CProfiler  &profiler;
+	const char *name;
+	long long   start;
+	const char *arg[2];
+	int         value[2];
+	bool        isRunning;
+};
+
+}
+
+#endif
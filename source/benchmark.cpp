@@ -0,0 +1,581 @@
+/*
+   AngelCode Bitmap Font Generator
+   Copyright (c) 2004-2016 Andreas Jonsson
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any
+   damages arising from the use of this software.
+
+   Permission is granted to anyone to use this software for any
+   purpose, including commercial applications, and to alter it and
+   redistribute it freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you
+      must not claim that you wrote the original software. If you use
+      this software in a product, an acknowledgment in the product
+      documentation would be appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and
+      must not be misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+      distribution.
+
+   Andreas Jonsson
+   andreas@angelcode.com
+*/
+#include <windows.h>
+#include <stdio.h>
+#include <string.h>
+#include <iostream>
+#include "benchmark.h"
+#include "fontgen.h"
+#include "fontpage.h"
+#include "fontchar.h"
+#include "acimg.h"
+#include "acutil_file.h"
+#include "acutil_parallel.h"
+#include "ac_string_util.h"
+
+using namespace std;
+
+// The synthetic pages are the size of a large texture, so the 60k glyph 
+// workload is spread over a realistic number of pages
+static const int packPageSize = 2048;
+
+// A small deterministic random number generator, so the synthetic 
+// workloads are the same on every run and with every C runtime
+class CRandom
+{
+public:
+	CRandom(unsigned int seed) { state = seed ? seed : 1; }
+
+	unsigned int Next() { state ^= state << 13; state ^= state >> 17; state ^= state << 5; return state; }
+	int Range(int lo, int hi) { return lo + int(Next() % unsigned(hi - lo + 1)); }
+
+protected:
+	unsigned int state;
+};
+
+// The sizes of the glyphs in CJK fonts rendered at 32 pixels. Most of the
+// glyphs are ideographs that nearly fill the em square, while the kana, 
+// hangul, latin letters and punctuation make up the rest.
+struct SGlyphClass
+{
+	int percent;
+	int minW, maxW;
+	int minH, maxH;
+};
+
+static const SGlyphClass cjkGlyphClasses[] =
+{
+	{80, 26, 31, 25, 31}, // Ideographs
+	{12, 18, 28, 18, 28}, // Kana and hangul
+	{ 5,  6, 16, 12, 24}, // Latin letters and digits
+	{ 3,  3, 10,  3, 10}, // Punctuation
+};
+
+// Returns the time in seconds
+static double GetTime()
+{
+	LARGE_INTEGER freq, count;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&count);
+	return double(count.QuadPart)/double(freq.QuadPart);
+}
+
+static string JsonString(const string &str)
+{
+	string out = "\"";
+	for( size_t n = 0; n < str.length(); n++ )
+	{
+		if( str[n] == '"' || str[n] == '\\' )
+			out += '\\';
+		else if( (unsigned char)str[n] < 0x20 )
+		{
+			out += acStringFormat("\\u%04x", str[n]);
+			continue;
+		}
+		out += str[n];
+	}
+	out += "\"";
+	return out;
+}
+
+// Draws a few horizontal and vertical strokes with anti-aliased edges, so
+// the pages compress roughly like pages with real glyphs
+static void DrawStrokes(cImage *img, CRandom &rnd)
+{
+	img->Clear(0);
+
+	int w = img->width, h = img->height;
+	int t = max(1, min(w, h)/10);
+	int count = rnd.Range(2, 6);
+	for( int n = 0; n < count; n++ )
+	{
+		int x0, y0, x1, y1;
+		if( rnd.Next() & 1 )
+		{
+			x0 = rnd.Range(0, w/2); x1 = rnd.Range(w/2, w);
+			y0 = rnd.Range(0, h-t); y1 = y0 + t;
+		}
+		else
+		{
+			y0 = rnd.Range(0, h/2); y1 = rnd.Range(h/2, h);
+			x0 = rnd.Range(0, w-t); x1 = x0 + t;
+		}
+
+		for( int y = max(y0-1, 0); y < min(y1+1, h); y++ )
+		{
+			for( int x = max(x0-1, 0); x < min(x1+1, w); x++ )
+			{
+				PIXEL v = (x >= x0 && x < x1 && y >= y0 && y < y1) ? 255 : 96;
+				PIXEL &p = img->pixels[y*w+x];
+				if( (p & 0xFF) < v )
+					p = v * 0x01010101;
+			}
+		}
+	}
+}
+
+// Returns 0 if out of memory
+static CFontChar *CreateSyntheticGlyph(int id, CRandom &rnd)
+{
+	int p = rnd.Range(0, 99);
+	const SGlyphClass *c = cjkGlyphClasses;
+	while( p >= c->percent )
+		p -= (c++)->percent;
+
+	int w = rnd.Range(c->minW, c->maxW);
+	int h = rnd.Range(c->minH, c->maxH);
+
+	CFontChar *ch = new (std::nothrow) CFontChar();
+	if( ch == 0 )
+		return 0;
+	ch->m_charImg = new (std::nothrow) cImage(w, h);
+	if( ch->m_charImg == 0 || ch->m_charImg->pixels == 0 )
+	{
+		delete ch;
+		return 0;
+	}
+
+	ch->m_id      = id;
+	ch->m_x       = 0;
+	ch->m_y       = 0;
+	ch->m_width   = w;
+	ch->m_height  = h;
+	ch->m_xoffset = 0;
+	ch->m_yoffset = 32 - h;
+	ch->m_advance = w + 2;
+	ch->m_page    = 0;
+	ch->m_chnl    = 0xF;
+	ch->m_colored = false;
+	ch->m_isChar  = true;
+
+	DrawStrokes(ch->m_charImg, rnd);
+
+	return ch;
+}
+
+// Returns 0 if out of memory
+static CFontChar *CreateSyntheticIcon(int id, CRandom &rnd)
+{
+	int w = rnd.Range(32, 96);
+	int h = rnd.Range(32, 96);
+
+	cImage img(w, h);
+	if( img.pixels == 0 )
+		return 0;
+
+	// A gradient with a random base color
+	PIXEL base = rnd.Next() & 0xFF;
+	for( int y = 0; y < h; y++ )
+		for( int x = 0; x < w; x++ )
+			img.pixels[y*w+x] = 0xFF000000 | ((x*255/w) << 16) | ((y*255/h) << 8) | base;
+
+	CFontChar *ch = new (std::nothrow) CFontChar();
+	if( ch == 0 )
+		return 0;
+	ch->CreateFromImage(id, &img, 0, 0, 0);
+	if( ch->m_charImg == 0 || ch->m_charImg->pixels == 0 )
+	{
+		delete ch;
+		return 0;
+	}
+
+	ch->m_x    = 0;
+	ch->m_y    = 0;
+	ch->m_page = 0;
+	ch->m_chnl = 0xF;
+
+	return ch;
+}
+
+CBenchmark::CBenchmark(CFontGen *gen)
+{
+	this->gen = gen;
+
+	// The synthetic workloads use the default settings, so they 
+	// don't change with the configuration
+	synthGen = new CFontGen();
+}
+
+CBenchmark::~CBenchmark()
+{
+	delete synthGen;
+}
+
+int CBenchmark::Run(const string &outputFile)
+{
+	results.clear();
+	tempFile = acUtility::GetTempOutputName(outputFile);
+
+	// The characters of the configuration are used for the real workloads
+	selectedChars.clear();
+	int maxChars = gen->IsUsingUnicode() ? maxUnicodeChar+1 : 256;
+	for( int n = 0; n < maxChars; n++ )
+		if( !gen->IsDisabled(n) && gen->IsSelected(n) )
+			selectedChars.push_back(n);
+
+	static const int glyphCounts[] = {1000, 10000, 60000};
+	for( int n = 0; n < 3; n++ )
+	{
+		cout << "Packing " << glyphCounts[n] << " glyphs." << endl;
+		BenchPacking(glyphCounts[n], false, false);
+		BenchPacking(glyphCounts[n], true, false);
+		BenchPacking(glyphCounts[n], false, true);
+		BenchPacking(glyphCounts[n], true, true);
+	}
+
+	if( selectedChars.size() )
+	{
+		cout << "Rasterizing " << selectedChars.size() << " characters." << endl;
+		BenchRasterization(true);
+		BenchRasterization(false);
+
+		static const int thicknesses[] = {1, 2, 4, 8};
+		for( int n = 0; n < 4; n++ )
+		{
+			cout << "Adding outlines of thickness " << thicknesses[n] << "." << endl;
+			BenchOutline(thicknesses[n]);
+		}
+	}
+
+	cout << "Encoding 2048x2048 pages." << endl;
+	BenchEncoders(2048);
+	cout << "Encoding 4096x4096 pages." << endl;
+	BenchEncoders(4096);
+
+	return WriteResults(outputFile);
+}
+
+CBenchmark::SResult &CBenchmark::AddResult(const string &name, const string &params, const string &unit, double items)
+{
+	SResult r;
+	r.name        = name;
+	r.params      = params;
+	r.unit        = unit;
+	r.items       = items;
+	r.iterations  = 0;
+	r.seconds     = 0;
+	r.bestSeconds = 0;
+	r.occupancy   = -1;
+	r.pages       = -1;
+	r.bytes       = -1;
+	r.failed      = false;
+	results.push_back(r);
+
+	return results.back();
+}
+
+void CBenchmark::AddIteration(SResult &result, double seconds)
+{
+	if( result.iterations == 0 || seconds < result.bestSeconds )
+		result.bestSeconds = seconds;
+	result.seconds += seconds;
+	result.iterations++;
+}
+
+// Repeats the short workloads to get stable numbers, 
+// but runs the long ones only once
+bool CBenchmark::NeedsIteration(const SResult &result)
+{
+	if( result.failed ) return false;
+	return result.iterations < 1 || (result.seconds < 1.0 && result.iterations < 10);
+}
+
+void CBenchmark::DeleteChars(vector<CFontChar*> &chars)
+{
+	for( size_t n = 0; n < chars.size(); n++ )
+		if( chars[n] )
+			delete chars[n];
+	chars.clear();
+}
+
+// Packs the characters on as many pages as needed the same way 
+// CFontGen does it. Returns the number of pages or -1 on error.
+int CBenchmark::PackPages(vector<CFontChar*> &list, int size, bool fourChnl)
+{
+	int count = (int)list.size();
+	int pages = 0;
+	while( count > 0 )
+	{
+		CFontPage *page = new CFontPage(synthGen, pages, size, size, 1, 1);
+		if( page == 0 || !page->IsOK() )
+		{
+			if( page )
+				delete page;
+			return -1;
+		}
+
+		page->SetPadding(0, 0, 0, 0);
+		page->SetIntendedFormat(fourChnl ? 32 : 8, fourChnl, e_glyph, e_glyph, e_glyph, e_glyph);
+		page->AddChars(&list[0], count);
+		delete page;
+		pages++;
+
+		// Remove the characters that were placed on the page
+		int remaining = 0;
+		for( int n = 0; n < count; n++ )
+			if( list[n] )
+				list[remaining++] = list[n];
+
+		// Nothing fit on an empty page
+		if( remaining == count )
+			return -1;
+		count = remaining;
+	}
+
+	return pages;
+}
+
+void CBenchmark::BenchPacking(int count, bool icons, bool fourChnl)
+{
+	CRandom rnd(count);
+	int numIcons = icons ? count/100 + 1 : 0;
+
+	vector<CFontChar*> chars;
+	bool failed = false;
+	for( int n = 0; n < count && !failed; n++ )
+	{
+		chars.push_back(CreateSyntheticGlyph(0x4E00 + n, rnd));
+		failed = chars.back() == 0;
+	}
+	for( int n = 0; n < numIcons && !failed; n++ )
+	{
+		chars.push_back(CreateSyntheticIcon(0xF0000 + n, rnd));
+		failed = chars.back() == 0;
+	}
+
+	SResult &r = AddResult("packing", acStringFormat("\"glyphs\":%d,\"icons\":%d,\"fourChannel\":%s,\"pageSize\":%d", count, numIcons, fourChnl ? "true" : "false", packPageSize), "glyphs/s", double(chars.size()));
+	r.failed = failed;
+
+	while( NeedsIteration(r) )
+	{
+		vector<CFontChar*> list(chars);
+		double start = GetTime();
+		r.pages = PackPages(list, packPageSize, fourChnl);
+		AddIteration(r, GetTime() - start);
+		r.failed = r.pages < 0;
+	}
+
+	// The part of the pages covered by the characters. Colored 
+	// images take all four channels of a packed page.
+	if( !r.failed )
+	{
+		double area = 0;
+		for( size_t n = 0; n < chars.size(); n++ )
+			area += double(chars[n]->m_width) * chars[n]->m_height * (fourChnl && !chars[n]->m_isChar ? 4 : 1);
+		r.occupancy = area / (double(r.pages) * packPageSize * packPageSize * (fourChnl ? 4 : 1));
+	}
+
+	DeleteChars(chars);
+}
+
+// Returns -1 if any of the characters couldn't be drawn
+int CBenchmark::DrawSelectedChars(vector<CFontChar*> &chars)
+{
+	int r = 0;
+	HFONT font = gen->CreateFont(0);
+	chars.resize(selectedChars.size(), 0);
+	for( size_t n = 0; n < selectedChars.size() && r >= 0; n++ )
+	{
+		chars[n] = new CFontChar();
+		r = chars[n]->DrawChar(font, selectedChars[n], gen);
+	}
+	DeleteObject(font);
+
+	return r < 0 ? -1 : 0;
+}
+
+void CBenchmark::BenchRasterization(bool fromOutline)
+{
+	bool oldFromOutline = gen->GetRenderFromOutline();
+	gen->SetRenderFromOutline(fromOutline);
+
+	SResult &r = AddResult("rasterization", acStringFormat("\"method\":\"%s\",\"chars\":%d", fromOutline ? "outline" : "bitmap", (int)selectedChars.size()), "glyphs/s", double(selectedChars.size()));
+	while( NeedsIteration(r) )
+	{
+		vector<CFontChar*> chars;
+		double start = GetTime();
+		r.failed = DrawSelectedChars(chars) < 0;
+		AddIteration(r, GetTime() - start);
+		DeleteChars(chars);
+	}
+
+	gen->SetRenderFromOutline(oldFromOutline);
+}
+
+void CBenchmark::BenchOutline(int thickness)
+{
+	SResult &r = AddResult("outline", acStringFormat("\"thickness\":%d,\"chars\":%d", thickness, (int)selectedChars.size()), "glyphs/s", double(selectedChars.size()));
+	while( NeedsIteration(r) )
+	{
+		// The outline is added in place, so the characters are drawn again for each iteration
+		vector<CFontChar*> chars;
+		r.failed = DrawSelectedChars(chars) < 0;
+		if( !r.failed )
+		{
+			double start = GetTime();
+			for( size_t n = 0; n < chars.size(); n++ )
+				chars[n]->AddOutline(thickness);
+			AddIteration(r, GetTime() - start);
+		}
+		DeleteChars(chars);
+	}
+}
+
+void CBenchmark::BenchEncoders(int size)
+{
+	struct SEncoder
+	{
+		const char *name;
+		const char *ext;
+		DWORD       flags;
+		bool        abgr;  // The encoder takes the bytes in R, G, B, A order
+	};
+
+	static const SEncoder encoders[] =
+	{
+		{"tga",            "tga", 0,                                             false},
+		{"tga_rle",        "tga", acImage::TGA_RLE,                              false},
+		{"png",            "png", 0,                                             true},
+		{"png_parallel",   "png", acImage::PNG_PARALLEL,                         true},
+		{"dds",            "dds", 0,                                             false},
+		{"dds_dxt5",       "dds", acImage::DDS_DXT5,                             true},
+		{"dds_dxt5_range", "dds", acImage::DDS_DXT5 | acImage::DDS_FIT_RANGE,    true},
+		{"ktx2_dxt5",      "ktx2", acImage::DDS_DXT5,                            true},
+		{"ktx2_zlib",      "ktx2", acImage::KTX_ZLIB,                            true},
+	};
+	const int numEncoders = sizeof(encoders)/sizeof(encoders[0]);
+
+	// Fill a page with synthetic glyphs in the default 32bit layout. There
+	// are a few more glyphs than will fit, so the page is completely used.
+	CRandom rnd(size);
+	vector<CFontChar*> chars;
+	bool failed = false;
+	for( int n = 0; n < size*size/700 && !failed; n++ )
+	{
+		chars.push_back(CreateSyntheticGlyph(n, rnd));
+		failed = chars.back() == 0;
+	}
+
+	acImage::Image images[2];
+	CFontPage *page = failed ? 0 : new CFontPage(synthGen, 0, size, size, 1, 1);
+	if( page && page->IsOK() )
+	{
+		page->SetPadding(0, 0, 0, 0);
+		page->SetIntendedFormat(32, false, synthGen->GetAlphaChnl(), synthGen->GetRedChnl(), synthGen->GetGreenChnl(), synthGen->GetBlueChnl());
+		vector<CFontChar*> list(chars);
+		page->AddChars(&list[0], (int)list.size());
+
+		for( int n = 0; n < 2 && !failed; n++ )
+		{
+			images[n].width  = size;
+			images[n].height = size;
+			images[n].pitch  = size*4;
+			images[n].format = n ? acImage::PF_A8B8G8R8 : acImage::PF_A8R8G8B8;
+			images[n].data   = new (std::nothrow) BYTE[images[n].pitch * size];
+			if( images[n].data == 0 || page->GenerateOutputTexture(images[n]) < 0 )
+				failed = true;
+		}
+	}
+	else
+		failed = true;
+
+	if( page )
+		delete page;
+	DeleteChars(chars);
+
+	for( int n = 0; n < numEncoders; n++ )
+	{
+		const SEncoder &e = encoders[n];
+		string file = tempFile + "." + e.ext;
+		acImage::Image &image = images[e.abgr ? 1 : 0];
+
+		SResult &r = AddResult("encoder", acStringFormat("\"format\":\"%s\",\"size\":%d", e.name, size), "Mpixels/s", double(size)*size/1000000.0);
+		r.failed = failed;
+		while( NeedsIteration(r) )
+		{
+			double start = GetTime();
+			int res;
+			if( strcmp(e.ext, "tga") == 0 )
+				res = acImage::SaveTga(file.c_str(), image, e.flags);
+			else if( strcmp(e.ext, "png") == 0 )
+				res = acImage::SavePng(file.c_str(), image, e.flags);
+			else if( strcmp(e.ext, "ktx2") == 0 )
+			{
+				// The encoder takes ownership of the layer, so it gets a copy
+				res = acImage::SaveKtx2(file.c_str(), 1, [&](unsigned int, acImage::Image &layer)
+				{
+					layer = image;
+					layer.data = new (std::nothrow) BYTE[image.pitch * image.height];
+					if( layer.data == 0 )
+						return acImage::E_OUT_OF_MEMORY;
+					memcpy(layer.data, image.data, image.pitch * image.height);
+					return 0;
+				}, e.flags);
+			}
+			else
+				res = acImage::SaveDds(file.c_str(), image, e.flags);
+			AddIteration(r, GetTime() - start);
+			r.failed = res < 0;
+		}
+
+		if( !r.failed )
+			r.bytes = acUtility::GetFileLength(file);
+		remove(file.c_str());
+	}
+}
+
+int CBenchmark::WriteResults(const string &outputFile)
+{
+	FILE *f = 0;
+	if( fopen_s(&f, outputFile.c_str(), "wb") != 0 || f == 0 )
+		return -1;
+
+	fprintf(f, "{\n");
+	fprintf(f, "  \"version\": %s,\n", JsonString(BMFONT_VERSION).c_str());
+	fprintf(f, "  \"threads\": %u,\n", acUtility::GetMaxThreads());
+	fprintf(f, "  \"font\": %s,\n", JsonString(gen->GetFontName()).c_str());
+	fprintf(f, "  \"fontSize\": %d,\n", gen->GetFontSize());
+	fprintf(f, "  \"results\": [\n");
+	for( size_t n = 0; n < results.size(); n++ )
+	{
+		const SResult &r = results[n];
+		fprintf(f, "    {\"name\": %s, %s, \"iterations\": %d, \"seconds\": %.6f, \"bestSeconds\": %.6f, ", JsonString(r.name).c_str(), r.params.c_str(), r.iterations, r.seconds, r.bestSeconds);
+		fprintf(f, "\"throughput\": %.3f, \"unit\": %s", r.seconds > 0 ? r.items * r.iterations / r.seconds : 0.0, JsonString(r.unit).c_str());
+		if( r.occupancy >= 0 ) fprintf(f, ", \"occupancy\": %.4f", r.occupancy);
+		if( r.pages >= 0 )     fprintf(f, ", \"pages\": %d", r.pages);
+		if( r.bytes >= 0 )     fprintf(f, ", \"bytes\": %lld", r.bytes);
+		if( r.failed )         fprintf(f, ", \"failed\": true");
+		fprintf(f, "}%s\n", n+1 < results.size() ? "," : "");
+	}
+	fprintf(f, "  ]\n");
+	fprintf(f, "}\n");
+
+	bool ok = ferror(f) == 0;
+	fclose(f);
+
+	return ok ? 0 : -1;
+}
@@ -0,0 +1,90 @@
+/*
+   AngelCode Bitmap Font Generator
+   Copyright (c) 2004-2016 Andreas Jonsson
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any
+   damages arising from the use of this software.
+
+   Permission is granted to anyone to use this software for any
+   purpose, including commercial applications, and to alter it and
+   redistribute it freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you
+      must not claim that you wrote the original software. If you use
+      this software in a product, an acknowledgment in the product
+      documentation would be appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and
+      must not be misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+      distribution.
+
+   Andreas Jonsson
+   andreas@angelcode.com
+*/
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <windows.h>
+#include <string>
+#include <vector>
+
+class CFontGen;
+class CFontChar;
+class CFontPage;
+
+// Measures the performance of packing, rasterization, outlines and the 
+// texture encoders. The packing and encoder workloads are synthetic and 
+// the same on every run, while the rasterization and outline workloads use
+// the font and characters of the configuration. The results are written as 
+// JSON so they can be compared between versions.
+class CBenchmark
+{
+public:
+	CBenchmark(CFontGen *gen);
+	~CBenchmark();
+
+	// Runs all the benchmarks and writes the results to the file. The 
+	// encoders write their files next to it. Returns 0 on success and -1 on error
+	int Run(const std::string &outputFile);
+
+protected:
+	struct SResult
+	{
+		std::string name;
+		std::string params;      // JSON members describing the workload
+		std::string unit;
+		double      items;       // The work done in one iteration, in the unit
+		int         iterations;
+		double      seconds;     // The total for all the iterations
+		double      bestSeconds;
+		double      occupancy;   // Negative when not applicable
+		int         pages;       // Negative when not applicable
+		long long   bytes;       // Negative when not applicable
+		bool        failed;
+	};
+
+	void BenchPacking(int count, bool icons, bool fourChnl);
+	void BenchRasterization(bool fromOutline);
+	void BenchOutline(int thickness);
+	void BenchEncoders(int size);
+
+	int  PackPages(std::vector<CFontChar*> &list, int size, bool fourChnl);
+	int  DrawSelectedChars(std::vector<CFontChar*> &chars);
+	void DeleteChars(std::vector<CFontChar*> &chars);
+	int  WriteResults(const std::string &outputFile);
+
+	SResult &AddResult(const std::string &name, const std::string &params, const std::string &unit, double items);
+	static void AddIteration(SResult &result, double seconds);
+	static bool NeedsIteration(const SResult &result);
+
+	CFontGen                *gen;
+	CFontGen                *synthGen;
+	std::string              tempFile;
+	std::vector<int>         selectedChars;
+	std::vector<SResult>     results;
+};
+
+#endif
@@ -0,0 +1,159 @@
+/*
+   AngelCode Bitmap Font Generator
+   Copyright (c) 2004-2016 Andreas Jonsson
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any
+   damages arising from the use of this software.
+
+   Permission is granted to anyone to use this software for any
+   purpose, including commercial applications, and to alter it and
+   redistribute it freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you
+      must not claim that you wrote the original software. If you use
+      this software in a product, an acknowledgment in the product
+      documentation would be appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and
+      must not be misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+      distribution.
+
+   Andreas Jonsson
+   andreas@angelcode.com
+*/
+
+#include <windows.h>
+#include <stdio.h>
+#include <string.h>
+#include "buildcache.h"
+#include "acutil_file.h"
+#include "ac_string_util.h"
+
+using namespace std;
+
+// The list of files in a cache entry. It is written last, so 
+// an entry without it is incomplete and must not be used
+static const char *manifestName = "files.txt";
+
+// Returns the part of the path after the last slash
+static string GetFileNameOnly(const string &path)
+{
+	size_t r = path.find_last_of("\\/");
+	return r != string::npos ? path.substr(r+1) : path;
+}
+
+// Returns the path up to and including the last slash
+static string GetDirectory(const string &path)
+{
+	size_t r = path.find_last_of("\\/");
+	return r != string::npos ? path.substr(0, r+1) : "";
+}
+
+CBuildCache::CBuildCache(const string &directory)
+{
+	this->directory = directory;
+	if( directory != "" && directory[directory.length()-1] != '\\' && directory[directory.length()-1] != '/' )
+		this->directory += "\\";
+}
+
+string CBuildCache::GetEntryPath(const string &key) const
+{
+	return directory + key + "\\";
+}
+
+int CBuildCache::Restore(const string &key, const string &outputFile, vector<string> &changed, vector<string> &unchanged)
+{
+	string entry = GetEntryPath(key);
+
+	FILE *f = 0;
+	if( fopen_s(&f, (entry + manifestName).c_str(), "rb") != 0 || f == 0 )
+		return 0;
+
+	vector<string> files;
+	char line[MAX_PATH];
+	while( fgets(line, sizeof(line), f) )
+	{
+		line[strcspn(line, "\r\n")] = 0;
+		if( line[0] )
+			files.push_back(line);
+	}
+	fclose(f);
+
+	// The files are linked, or copied, to temporary files and then committed 
+	// like when saving the font, so files that are already up to date are
+	// left untouched
+	string outputDir = GetDirectory(outputFile);
+	for( size_t n = 0; n < files.size(); n++ )
+	{
+		string target = outputDir + files[n];
+		string temp = acUtility::GetTempOutputName(target);
+		remove(temp.c_str());
+		if( acUtility::LinkOrCopyFile(entry + files[n], temp) < 0 )
+			return -1;
+
+		int r = acUtility::CommitFile(temp, target);
+		if( r < 0 )
+			return -1;
+		if( r > 0 )
+			changed.push_back(target);
+		else
+			unchanged.push_back(target);
+	}
+
+	return 1;
+}
+
+int CBuildCache::Store(const string &key, const vector<string> &files)
+{
+	string entry = GetEntryPath(key);
+
+	// Another run may already have stored the same build
+	if( GetFileAttributesA((entry + manifestName).c_str()) != INVALID_FILE_ATTRIBUTES )
+		return 0;
+
+	CreateDirectoryA(directory.c_str(), 0);
+
+	// The entry is prepared in a directory of its own and then renamed, so 
+	// runs in parallel never see a partial entry. The process id keeps the 
+	// directories of the different runs apart.
+	string temp = directory + acStringFormat("%s.%u.tmp\\", key.c_str(), (unsigned int)GetCurrentProcessId());
+	if( !CreateDirectoryA(temp.c_str(), 0) && GetLastError() != ERROR_ALREADY_EXISTS )
+		return -1;
+
+	int result = 0;
+	vector<string> names;
+	for( size_t n = 0; n < files.size() && result == 0; n++ )
+	{
+		names.push_back(GetFileNameOnly(files[n]));
+		remove((temp + names[n]).c_str());
+		result = acUtility::LinkOrCopyFile(files[n], temp + names[n]);
+	}
+
+	if( result == 0 )
+	{
+		FILE *f = 0;
+		if( fopen_s(&f, (temp + manifestName).c_str(), "wb") != 0 || f == 0 )
+			result = -1;
+		else
+		{
+			for( size_t n = 0; n < names.size(); n++ )
+				fprintf(f, "%s\n", names[n].c_str());
+			fclose(f);
+			names.push_back(manifestName);
+		}
+	}
+
+	// Move the entry in place. If it fails, either another run has stored the
+	// entry first or the cache can't be written, and the files are cleaned up
+	if( result != 0 || !MoveFileA(temp.substr(0, temp.length()-1).c_str(), entry.substr(0, entry.length()-1).c_str()) )
+	{
+		for( size_t n = 0; n < names.size(); n++ )
+			remove((temp + names[n]).c_str());
+		RemoveDirectoryA(temp.c_str());
+	}
+
+	return result;
+}
@@ -0,0 +1,58 @@
+/*
+   AngelCode Bitmap Font Generator
+   Copyright (c) 2004-2016 Andreas Jonsson
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any
+   damages arising from the use of this software.
+
+   Permission is granted to anyone to use this software for any
+   purpose, including commercial applications, and to alter it and
+   redistribute it freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you
+      must not claim that you wrote the original software. If you use
+      this software in a product, an acknowledgment in the product
+      documentation would be appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and
+      must not be misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+      distribution.
+
+   Andreas Jonsson
+   andreas@angelcode.com
+*/
+
+#ifndef BUILDCACHE_H
+#define BUILDCACHE_H
+
+#include <string>
+#include <vector>
+
+// A cache of complete font builds, shared by runs of the command line. Each 
+// entry is a directory, named by the build key from CFontGen::GetBuildKey, 
+// that holds the output files and a list of them. When a font has been built
+// before with the same key, the files are restored from the cache instead 
+// of generating the font again.
+class CBuildCache
+{
+public:
+	CBuildCache(const std::string &directory);
+
+	// Restores the files for the key to the directory of the output file. 
+	// Returns 1 if they were restored, 0 if the key isn't in the cache, and -1 on error
+	int Restore(const std::string &key, const std::string &outputFile, std::vector<std::string> &changed, std::vector<std::string> &unchanged);
+
+	// Adds the output files to the cache. Returns 0 if the files were 
+	// added or already in the cache, and -1 on error
+	int Store(const std::string &key, const std::vector<std::string> &files);
+
+protected:
+	std::string GetEntryPath(const std::string &key) const;
+
+	std::string directory;
+};
+
+#endif
@@ -0,0 +1,202 @@
+/*
+   AngelCode Bitmap Font Generator
+   Copyright (c) 2004-2016 Andreas Jonsson
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any
+   damages arising from the use of this software.
+
+   Permission is granted to anyone to use this software for any
+   purpose, including commercial applications, and to alter it and
+   redistribute it freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you
+      must not claim that you wrote the original software. If you use
+      this software in a product, an acknowledgment in the product
+      documentation would be appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and
+      must not be misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+      distribution.
+
+   Andreas Jonsson
+   andreas@angelcode.com
+*/
+
+#include <assert.h>
+#include <stddef.h>
+#include "charbitset.h"
+
+CCharBitset::CCharBitset(unsigned int size)
+{
+	this->size = 0;
+	Resize(size);
+}
+
+void CCharBitset::Resize(unsigned int size)
+{
+	this->size = size;
+	words.assign((size+31)/32, 0);
+}
+
+unsigned int CCharBitset::GetSize() const
+{
+	return size;
+}
+
+void CCharBitset::Set(unsigned int idx, bool set)
+{
+	assert( idx < size );
+
+	if( set )
+		words[idx>>5] |= 1u << (idx&31);
+	else
+		words[idx>>5] &= ~(1u << (idx&31));
+}
+
+void CCharBitset::SetRange(unsigned int begin, unsigned int end, bool set)
+{
+	assert( begin <= end && end < size );
+
+	unsigned int first = begin>>5;
+	unsigned int last  = end>>5;
+	for( unsigned int w = first; w <= last; w++ )
+	{
+		// Build the mask for the part of the word that is within the range
+		unsigned int mask = 0xFFFFFFFF;
+		if( w == first ) mask &= 0xFFFFFFFF << (begin&31);
+		if( w == last )  mask &= 0xFFFFFFFF >> (31 - (end&31));
+
+		if( set )
+			words[w] |= mask;
+		else
+			words[w] &= ~mask;
+	}
+}
+
+void CCharBitset::ClearAll()
+{
+	for( size_t w = 0; w < words.size(); w++ )
+		words[w] = 0;
+}
+
+void CCharBitset::SetAll()
+{
+	if( size )
+		SetRange(0, size-1, true);
+}
+
+void CCharBitset::Invert()
+{
+	for( size_t w = 0; w < words.size(); w++ )
+		words[w] = ~words[w];
+
+	// Keep the bits beyond the size cleared so the counts are not affected
+	if( size & 31 )
+		words[words.size()-1] &= 0xFFFFFFFF >> (32 - (size&31));
+}
+
+void CCharBitset::Or(const CCharBitset &other)
+{
+	assert( other.size == size );
+	for( size_t w = 0; w < words.size(); w++ )
+		words[w] |= other.words[w];
+}
+
+void CCharBitset::And(const CCharBitset &other)
+{
+	assert( other.size == size );
+	for( size_t w = 0; w < words.size(); w++ )
+		words[w] &= other.words[w];
+}
+
+void CCharBitset::AndNot(const CCharBitset &other)
+{
+	assert( other.size == size );
+	for( size_t w = 0; w < words.size(); w++ )
+		words[w] &= ~other.words[w];
+}
+
+unsigned int CCharBitset::PopCount(unsigned int v)
+{
+	// Count the bits in parallel, without relying on the popcnt instruction
+	v = v - ((v >> 1) & 0x55555555);
+	v = (v & 0x33333333) + ((v >> 2) & 0x33333333);
+	return (((v + (v >> 4)) & 0x0F0F0F0F) * 0x01010101) >> 24;
+}
+
+struct SOpSelf   { unsigned int operator()(unsigned int a, unsigned int)   const { return a; } };
+struct SOpAnd    { unsigned int operator()(unsigned int a, unsigned int b) const { return a & b; } };
+struct SOpAndNot { unsigned int operator()(unsigned int a, unsigned int b) const { return a & ~b; } };
+
+template<class OP>
+unsigned int CCharBitset::CountRange(const CCharBitset *other, unsigned int begin, unsigned int end, OP op) const
+{
+	assert( begin <= end && end < size );
+	assert( other == 0 || other->size == size );
+
+	unsigned int count = 0;
+	unsigned int first = begin>>5;
+	unsigned int last  = end>>5;
+	for( unsigned int w = first; w <= last; w++ )
+	{
+		unsigned int word = op(words[w], other ? other->words[w] : 0);
+		if( w == first ) word &= 0xFFFFFFFF << (begin&31);
+		if( w == last )  word &= 0xFFFFFFFF >> (31 - (end&31));
+		if( word )
+			count += PopCount(word);
+	}
+
+	return count;
+}
+
+unsigned int CCharBitset::Count() const
+{
+	unsigned int count = 0;
+	for( size_t w = 0; w < words.size(); w++ )
+		if( words[w] )
+			count += PopCount(words[w]);
+
+	return count;
+}
+
+unsigned int CCharBitset::Count(unsigned int begin, unsigned int end) const
+{
+	return CountRange(0, begin, end, SOpSelf());
+}
+
+unsigned int CCharBitset::CountAnd(const CCharBitset &other, unsigned int begin, unsigned int end) const
+{
+	return CountRange(&other, begin, end, SOpAnd());
+}
+
+unsigned int CCharBitset::CountAndNot(const CCharBitset &other, unsigned int begin, unsigned int end) const
+{
+	return CountRange(&other, begin, end, SOpAndNot());
+}
+
+int CCharBitset::FindNext(unsigned int start) const
+{
+	if( start >= size )
+		return -1;
+
+	unsigned int w = start>>5;
+	unsigned int word = words[w] & (0xFFFFFFFF << (start&31));
+	for( ;; )
+	{
+		if( word )
+		{
+			// Locate the lowest set bit in the word
+			unsigned int bit = 0;
+			while( !(word & (1u << bit)) )
+				bit++;
+			return int(w*32 + bit);
+		}
+
+		if( ++w >= words.size() )
+			return -1;
+		word = words[w];
+	}
+}
@@ -0,0 +1,79 @@
+/*
+   AngelCode Bitmap Font Generator
+   Copyright (c) 2004-2016 Andreas Jonsson
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any
+   damages arising from the use of this software.
+
+   Permission is granted to anyone to use this software for any
+   purpose, including commercial applications, and to alter it and
+   redistribute it freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you
+      must not claim that you wrote the original software. If you use
+      this software in a product, an acknowledgment in the product
+      documentation would be appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and
+      must not be misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+      distribution.
+
+   Andreas Jonsson
+   andreas@angelcode.com
+*/
+
+#ifndef CHARBITSET_H
+#define CHARBITSET_H
+
+#include <vector>
+
+// A fixed size set of bits, one for each character code. The counts are
+// computed with population counts over 32bit words, so querying how many
+// characters in a range are set doesn't require visiting each character.
+class CCharBitset
+{
+public:
+	CCharBitset(unsigned int size = 0);
+
+	void         Resize(unsigned int size);
+	unsigned int GetSize() const;
+
+	bool Test(unsigned int idx) const { return (words[idx>>5] >> (idx&31)) & 1; }
+	bool operator[](unsigned int idx) const { return Test(idx); }
+
+	void Set(unsigned int idx, bool set = true);
+	void SetRange(unsigned int begin, unsigned int end, bool set = true);
+	void ClearAll();
+	void SetAll();
+	void Invert();
+
+	// Combine with another set of the same size
+	void Or(const CCharBitset &other);
+	void And(const CCharBitset &other);
+	void AndNot(const CCharBitset &other);
+
+	bool operator==(const CCharBitset &other) const { return size == other.size && words == other.words; }
+	bool operator!=(const CCharBitset &other) const { return !(*this == other); }
+
+	// The ranges are inclusive
+	unsigned int Count() const;
+	unsigned int Count(unsigned int begin, unsigned int end) const;
+	unsigned int CountAnd(const CCharBitset &other, unsigned int begin, unsigned int end) const;
+	unsigned int CountAndNot(const CCharBitset &other, unsigned int begin, unsigned int end) const;
+
+	// Returns the index of the first set bit at or after start, or -1 if there are none
+	int FindNext(unsigned int start) const;
+
+	static unsigned int PopCount(unsigned int word);
+
+protected:
+	template<class OP> unsigned int CountRange(const CCharBitset *other, unsigned int begin, unsigned int end, OP op) const;
+
+	std::vector<unsigned int> words;
+	unsigned int              size;
+};
+
+#endif
@@ -0,0 +1,392 @@
+/*
+   AngelCode Bitmap Font Generator
+   Copyright (c) 2004-2016 Andreas Jonsson
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any
+   damages arising from the use of this software.
+
+   Permission is granted to anyone to use this software for any
+   purpose, including commercial applications, and to alter it and
+   redistribute it freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you
+      must not claim that you wrote the original software. If you use
+      this software in a product, an acknowledgment in the product
+      documentation would be appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and
+      must not be misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+      distribution.
+
+   Andreas Jonsson
+   andreas@angelcode.com
+*/
+
+#include <string.h>
+#include <mutex>
+#include <map>
+#include "charcorpus.h"
+#include "acutil_file.h"
+#include "acutil_parallel.h"
+
+// SSE2 is always available on x64, and is the default for x86 with the supported compilers
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define USE_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+// Files larger than this are split in parts that are scanned in parallel
+static const size_t partSize = 4*1024*1024;
+
+// Serializes the merging of the characters found by each thread
+static mutex charsMutex;
+
+CCharCorpus::CCharCorpus(unsigned int maxChar) : chars(maxChar+1)
+{
+}
+
+const CCharBitset &CCharCorpus::GetChars() const
+{
+	return chars;
+}
+
+const vector<unsigned int> &CCharCorpus::GetFrequencies() const
+{
+	return frequencies;
+}
+
+// Collects the characters in a bitset. The bytes of runs of ASCII characters
+// are first gathered in a local mask, so they are cheap to add.
+struct SCharSetSink
+{
+	SCharSetSink(CCharBitset &chars) : chars(chars), maxChar(chars.GetSize()-1) { memset(bytes, 0, sizeof(bytes)); }
+
+	void Add(unsigned int ch) { if( ch <= maxChar ) chars.Set(ch); }
+	void AddByte(unsigned char b) { bytes[b>>5] |= 1u << (b&31); }
+	void AddBytes(const unsigned char *p) { for( int n = 0; n < 16; n++ ) AddByte(p[n]); }
+
+	void Flush()
+	{
+		for( unsigned int ch = 0; ch < 256 && ch <= maxChar; ch++ )
+			if( bytes[ch>>5] & (1u << (ch&31)) )
+				chars.Set(ch);
+	}
+
+	CCharBitset &chars;
+	unsigned int maxChar;
+	unsigned int bytes[8];
+};
+
+// Counts the occurrences of each character. The characters outside the 
+// basic multilingual plane are rare, so those are counted in a map.
+struct SCharCountSink
+{
+	SCharCountSink(unsigned int maxChar) : counts(maxChar < 0xFFFF ? maxChar+1 : 0x10000, 0), maxChar(maxChar) {}
+
+	void Add(unsigned int ch) { if( ch < counts.size() ) counts[ch]++; else if( ch <= maxChar ) others[ch]++; }
+	void AddByte(unsigned char b) { counts[b]++; }
+	void AddBytes(const unsigned char *p) { for( int n = 0; n < 16; n++ ) counts[p[n]]++; }
+	void Flush() {}
+
+	vector<unsigned int>            counts;
+	map<unsigned int, unsigned int> others;
+	unsigned int                    maxChar;
+};
+
+// Returns true if none of the 16 bytes have the high bit set
+static inline bool IsASCII(const unsigned char *p)
+{
+#ifdef USE_SSE2
+	return _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)p)) == 0;
+#else
+	unsigned int a, b, c, d;
+	memcpy(&a, p, 4); memcpy(&b, p+4, 4); memcpy(&c, p+8, 4); memcpy(&d, p+12, 4);
+	return ((a | b | c | d) & 0x80808080) == 0;
+#endif
+}
+
+template<class SINK>
+static void DecodeUTF8(const unsigned char *data, size_t size, size_t begin, size_t end, SINK &sink)
+{
+	// Trailing bytes never start a valid sequence, so a part that begins
+	// in the middle of a sequence leaves it to the previous part
+	size_t n = begin;
+	if( n > 0 )
+		while( n < end && (data[n] & 0xC0) == 0x80 )
+			n++;
+
+	// Runs of ASCII characters are handled 16 at a time without decoding them
+	while( n < end )
+	{
+		if( n + 16 <= end && IsASCII(data + n) )
+		{
+			sink.AddBytes(data + n);
+			n += 16;
+			continue;
+		}
+
+		unsigned char byte = data[n];
+		if( byte < 0x80 )
+		{
+			sink.AddByte(byte);
+			n++;
+			continue;
+		}
+
+		unsigned int value = 0;
+		size_t length = 0;
+		if( (byte & 0xE0) == 0xC0 )
+		{
+			// The value must not be less than 2, because 
+			// that should have been encoded with one byte only
+			value = byte & 0x1F;
+			if( value >= 2 )
+				length = 2;
+		}
+		else if( (byte & 0xF0) == 0xE0 )
+		{
+			value = byte & 0x0F;
+			length = 3;
+		}
+		else if( (byte & 0xF8) == 0xF0 )
+		{
+			value = byte & 0x07;
+			length = 4;
+		}
+
+		size_t l = 1;
+		for( ; l < length && n + l < size; l++ )
+		{
+			if( (data[n+l] & 0xC0) != 0x80 )
+				break;
+			value = (value << 6) | (data[n+l] & 0x3F);
+		}
+
+		if( length && l == length )
+		{
+			sink.Add(value);
+			n += length;
+		}
+		else
+		{
+			// Invalid byte sequence, skip one byte
+			n++;
+		}
+	}
+
+	sink.Flush();
+}
+
+static inline unsigned int ReadUTF16(const unsigned char *p, bool littleEndian)
+{
+	return littleEndian ? (p[0] | (p[1] << 8)) : ((p[0] << 8) | p[1]);
+}
+
+template<class SINK>
+static void DecodeUTF16(const unsigned char *data, size_t size, size_t begin, size_t end, bool littleEndian, SINK &sink)
+{
+	// A trailing odd byte isn't a complete unit
+	size &= ~size_t(1);
+	if( end > size ) end = size;
+
+	// A high surrogate always starts a sequence, so if the part begins with 
+	// the low surrogate of a pair it is left to the previous part 
+	size_t n = begin;
+	if( n > 0 && n < end )
+	{
+		unsigned int prev = ReadUTF16(data + n - 2, littleEndian);
+		unsigned int curr = ReadUTF16(data + n, littleEndian);
+		if( prev >= 0xD800 && prev < 0xDC00 && curr >= 0xDC00 && curr <= 0xDFFF )
+			n += 2;
+	}
+
+	while( n < end )
+	{
+#ifdef USE_SSE2
+		// Runs of 8 units without surrogates are added directly
+		if( n + 16 <= end )
+		{
+			__m128i v = _mm_loadu_si128((const __m128i*)(data + n));
+			if( !littleEndian )
+				v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+			__m128i s = _mm_cmpeq_epi16(_mm_and_si128(v, _mm_set1_epi16((short)0xF800)), _mm_set1_epi16((short)0xD800));
+			if( _mm_movemask_epi8(s) == 0 )
+			{
+				unsigned short units[8];
+				_mm_storeu_si128((__m128i*)units, v);
+				for( int u = 0; u < 8; u++ )
+					sink.Add(units[u]);
+				n += 16;
+				continue;
+			}
+		}
+#endif
+
+		unsigned int value = ReadUTF16(data + n, littleEndian);
+		if( value < 0xD800 || value > 0xDFFF )
+		{
+			sink.Add(value);
+			n += 2;
+		}
+		else if( value < 0xDC00 && n + 4 <= size )
+		{
+			// The second surrogate word must be in the 0xDC00 - 0xDFFF range
+			unsigned int value2 = ReadUTF16(data + n + 2, littleEndian);
+			if( value2 >= 0xDC00 && value2 <= 0xDFFF )
+			{
+				value = ((value & 0x3FF) << 10) + (value2 & 0x3FF) + 0x10000;
+				sink.Add(value);
+				n += 4;
+			}
+			else
+				n += 2;
+		}
+		else
+		{
+			// Invalid sequence, skip one unit
+			n += 2;
+		}
+	}
+
+	sink.Flush();
+}
+
+template<class SINK>
+static void DecodeBytes(const unsigned char *data, size_t begin, size_t end, SINK &sink)
+{
+	size_t n = begin;
+	for( ; n + 16 <= end; n += 16 )
+		sink.AddBytes(data + n);
+	for( ; n < end; n++ )
+		sink.AddByte(data[n]);
+
+	sink.Flush();
+}
+
+void CCharCorpus::ScanUTF8(const unsigned char *data, size_t size, size_t begin, size_t end, CCharBitset &chars)
+{
+	SCharSetSink sink(chars);
+	DecodeUTF8(data, size, begin, end, sink);
+}
+
+void CCharCorpus::ScanUTF16(const unsigned char *data, size_t size, size_t begin, size_t end, bool littleEndian, CCharBitset &chars)
+{
+	SCharSetSink sink(chars);
+	DecodeUTF16(data, size, begin, end, littleEndian, sink);
+}
+
+void CCharCorpus::ScanBytes(const unsigned char *data, size_t begin, size_t end, CCharBitset &chars)
+{
+	SCharSetSink sink(chars);
+	DecodeBytes(data, begin, end, sink);
+}
+
+// Decodes a part of the data with the given encoding, 
+// 1 = UTF-8, 2 = UTF-16 LE, 3 = UTF-16 BE, otherwise bytes
+template<class SINK>
+static void DecodePart(const unsigned char *data, size_t size, size_t begin, size_t end, int encoding, SINK &sink)
+{
+	if( encoding == 1 )
+		DecodeUTF8(data, size, begin, end, sink);
+	else if( encoding == 2 || encoding == 3 )
+		DecodeUTF16(data, size, begin, end, encoding == 2, sink);
+	else
+		DecodeBytes(data, begin, end, sink);
+}
+
+int CCharCorpus::ScanFile(const string &filename, bool unicode, bool countFrequencies)
+{
+	acUtility::CMappedFile file;
+	if( file.Open(filename) < 0 )
+		return -1;
+
+	const unsigned char *data = file.GetData();
+	size_t size = file.GetSize();
+	if( size == 0 )
+		return 0;
+
+	// Determine the encoding from the byte order mark. Without it the 
+	// file is read as UTF-16 little endian, like the older versions did
+	int encoding = 0;
+	if( unicode )
+	{
+		if( size >= 3 && data[0] == 0xEF && data[1] == 0xBB && data[2] == 0xBF )
+			encoding = 1;
+		else if( size >= 2 && data[0] == 0xFE && data[1] == 0xFF )
+			encoding = 3;
+		else
+			encoding = 2;
+	}
+
+	// Large files are split in parts. UTF-16 parts must begin on a whole unit
+	unsigned int numParts = unsigned((size + partSize - 1) / partSize);
+	acUtility::ParallelFor(numParts, [&](unsigned int part)
+	{
+		size_t begin = part*partSize;
+		size_t end = begin + partSize < size ? begin + partSize : size;
+
+		if( countFrequencies )
+		{
+			SCharCountSink sink(chars.GetSize()-1);
+			DecodePart(data, size, begin, end, encoding, sink);
+
+			lock_guard<mutex> lock(charsMutex);
+			for( unsigned int ch = 0; ch < sink.counts.size(); ch++ )
+			{
+				if( sink.counts[ch] )
+				{
+					chars.Set(ch);
+					frequencies[ch] += sink.counts[ch];
+				}
+			}
+			for( map<unsigned int, unsigned int>::iterator it = sink.others.begin(); it != sink.others.end(); it++ )
+			{
+				chars.Set(it->first);
+				frequencies[it->first] += it->second;
+			}
+		}
+		else
+		{
+			CCharBitset found(chars.GetSize());
+			SCharSetSink sink(found);
+			DecodePart(data, size, begin, end, encoding, sink);
+
+			lock_guard<mutex> lock(charsMutex);
+			chars.Or(found);
+		}
+	});
+
+	return 0;
+}
+
+int CCharCorpus::Scan(const vector<string> &paths, bool unicode, bool countFrequencies)
+{
+	int result = 0;
+
+	if( countFrequencies && frequencies.size() != chars.GetSize() )
+		frequencies.assign(chars.GetSize(), 0);
+
+	vector<string> files;
+	for( size_t n = 0; n < paths.size(); n++ )
+		if( acUtility::FindFiles(paths[n], files) < 0 )
+			result = -1;
+
+	// The files are scanned in parallel. The parts of each file are scanned 
+	// in parallel too when the files aren't, e.g. for a single large file.
+	vector<int> results(files.size(), 0);
+	acUtility::ParallelFor((unsigned int)files.size(), [&](unsigned int n)
+	{
+		results[n] = ScanFile(files[n], unicode, countFrequencies);
+	});
+
+	for( size_t n = 0; n < results.size(); n++ )
+		if( results[n] < 0 )
+			result = -1;
+
+	return result;
+}
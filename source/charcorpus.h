@@ -0,0 +1,74 @@
+/*
+   AngelCode Bitmap Font Generator
+   Copyright (c) 2004-2016 Andreas Jonsson
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any
+   damages arising from the use of this software.
+
+   Permission is granted to anyone to use this software for any
+   purpose, including commercial applications, and to alter it and
+   redistribute it freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you
+      must not claim that you wrote the original software. If you use
+      this software in a product, an acknowledgment in the product
+      documentation would be appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and
+      must not be misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+      distribution.
+
+   Andreas Jonsson
+   andreas@angelcode.com
+*/
+
+#ifndef CHARCORPUS_H
+#define CHARCORPUS_H
+
+#include <string>
+#include <vector>
+#include "charbitset.h"
+
+// Collects the characters used in a set of text files, e.g. the localized
+// texts that a font must cover. The files are memory mapped and scanned in 
+// parallel, and large files are split so they too are scanned by multiple 
+// threads. The characters are gathered in a bitset so they can be added to
+// the selection in one go.
+class CCharCorpus
+{
+public:
+	CCharCorpus(unsigned int maxChar);
+
+	// Scans the files, and all files in the directories. With unicode the 
+	// encoding is determined by the byte order mark, and files without it 
+	// are read as UTF-16 little endian. Without unicode each byte is a 
+	// character. Returns -1 if any of the files couldn't be read. Counting 
+	// the frequencies of the characters is a little slower, so it is optional.
+	int Scan(const std::vector<std::string> &paths, bool unicode, bool countFrequencies = false);
+
+	const CCharBitset &GetChars() const;
+
+	// The number of times each character was found, indexed by the character.
+	// This is empty unless the frequencies were counted.
+	const std::vector<unsigned int> &GetFrequencies() const;
+
+	// The decoders add the characters of the sequences that start within 
+	// begin and end to the set, reading up to size to complete the last one.
+	// They give the same result as decoding the data one character at a time
+	// with DecodeUTF8 and DecodeUTF16, skipping one unit at each invalid 
+	// sequence, so the data can be split in parts that are scanned separately.
+	static void ScanUTF8(const unsigned char *data, size_t size, size_t begin, size_t end, CCharBitset &chars);
+	static void ScanUTF16(const unsigned char *data, size_t size, size_t begin, size_t end, bool littleEndian, CCharBitset &chars);
+	static void ScanBytes(const unsigned char *data, size_t begin, size_t end, CCharBitset &chars);
+
+protected:
+	int ScanFile(const std::string &filename, bool unicode, bool countFrequencies);
+
+	CCharBitset               chars;
+	std::vector<unsigned int> frequencies;
+};
+
+#endif
@@ -1032,7 +1032,8 @@ void CCharWin::OnExportOptions()
 	dlg.invG               = fontGen->IsGreenInverted();
 	dlg.invB               = fontGen->IsBlueInverted();
 
-	dlg.fontDescFormat  = fontGen->GetFontDescFormat();
+	dlg.fontDescFormat    = fontGen->GetFontDescFormat();
+	dlg.useKerningClasses = fontGen->GetUseKerningClasses();
 
 	if( dlg.DoModal(this) == IDOK )
 	{
@@ -1062,6 +1063,7 @@ void CCharWin::OnExportOptions()
 		fontGen->SetBlueInverted(dlg.invB);
 
 		fontGen->SetFontDescFormat(dlg.fontDescFormat);
+		fontGen->SetUseKerningClasses(dlg.useKerningClasses);
 	}
 }
 
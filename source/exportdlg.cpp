@@ -125,6 +125,11 @@ LRESULT CExportDlg::MsgProc(UINT msg, WPARAM wParam, LPARAM lParam)
 		case IDC_BIT32:
 		case IDC_4CHNLPACK:
 		case IDC_FORCEZERO:
+		case IDC_DESC_TEXT:
+		case IDC_DESC_XML:
+		case IDC_DESC_BIN:
+		case IDC_DESC_RUNTIME:
+		case IDC_DESC_HEADER:
 			EnableWidgets();
 			break;
 		}
@@ -170,6 +175,12 @@ void CExportDlg::EnableWidgets()
 		EnableWindow(GetDlgItem(hWnd, IDC_INV_G), TRUE);
 		EnableWindow(GetDlgItem(hWnd, IDC_INV_B), TRUE);
 	}
+
+	// Only the XML and binary formats can store kerning classes
+	if( !IsDlgButtonChecked(hWnd, IDC_DESC_XML) && !IsDlgButtonChecked(hWnd, IDC_DESC_BIN) )
+		EnableWindow(GetDlgItem(hWnd, IDC_KERNCLASSES), FALSE);
+	else
+		EnableWindow(GetDlgItem(hWnd, IDC_KERNCLASSES), TRUE);
 }
 
 void CExportDlg::OnInit()
@@ -243,9 +254,13 @@ void CExportDlg::OnInit()
 	CheckDlgButton(hWnd, IDC_DESC_TEXT, fontDescFormat == 0 ? BST_CHECKED : BST_UNCHECKED);
 	CheckDlgButton(hWnd, IDC_DESC_XML,  fontDescFormat == 1 ? BST_CHECKED : BST_UNCHECKED);
 	CheckDlgButton(hWnd, IDC_DESC_BIN,  fontDescFormat == 2 ? BST_CHECKED : BST_UNCHECKED);
+	CheckDlgButton(hWnd, IDC_DESC_RUNTIME, fontDescFormat == 3 ? BST_CHECKED : BST_UNCHECKED);
+	CheckDlgButton(hWnd, IDC_DESC_HEADER,  fontDescFormat == 4 ? BST_CHECKED : BST_UNCHECKED);
+	CheckDlgButton(hWnd, IDC_KERNCLASSES, useKerningClasses ? BST_CHECKED : BST_UNCHECKED);
 
 	// Fill in the texture file format combo
 	SendDlgItemMessage(hWnd, IDC_TEXTURE_FMT, CB_ADDSTRING, 0, (LPARAM)__TEXT("dds - DirectDraw Surface"));
+	SendDlgItemMessage(hWnd, IDC_TEXTURE_FMT, CB_ADDSTRING, 0, (LPARAM)__TEXT("ktx2 - Khronos Texture array"));
 	SendDlgItemMessage(hWnd, IDC_TEXTURE_FMT, CB_ADDSTRING, 0, (LPARAM)__TEXT("png - Portable Network Graphics"));
 	SendDlgItemMessage(hWnd, IDC_TEXTURE_FMT, CB_ADDSTRING, 0, (LPARAM)__TEXT("tga - Targa"));
 	ConvertUtf8ToTChar(textureFormat, buf, 256);
@@ -296,7 +311,7 @@ void CExportDlg::OnTextureChange()
 		TCHAR buf[256];
 		SendDlgItemMessage(hWnd, IDC_TEXTURE_FMT, CB_GETLBTEXT, idx, (LPARAM)buf);
 		ConvertTCharToUtf8(buf, textureFormat);
-		textureFormat.resize(3);
+		textureFormat.resize(textureFormat.find(' '));
 	}
 
 	// Add the compression options
@@ -309,12 +324,14 @@ void CExportDlg::OnTextureChange()
 	{
 		SendDlgItemMessage(hWnd, IDC_TEXTURE_COMPRESSION, CB_ADDSTRING, 0, (LPARAM)__TEXT("Deflate"));
 	}
-	else if( textureFormat == "dds" )
+	else if( textureFormat == "dds" || textureFormat == "ktx2" )
 	{
 		SendDlgItemMessage(hWnd, IDC_TEXTURE_COMPRESSION, CB_ADDSTRING, 0, (LPARAM)__TEXT("None"));
 		SendDlgItemMessage(hWnd, IDC_TEXTURE_COMPRESSION, CB_ADDSTRING, 0, (LPARAM)__TEXT("DXT1"));
 		SendDlgItemMessage(hWnd, IDC_TEXTURE_COMPRESSION, CB_ADDSTRING, 0, (LPARAM)__TEXT("DXT3"));
 		SendDlgItemMessage(hWnd, IDC_TEXTURE_COMPRESSION, CB_ADDSTRING, 0, (LPARAM)__TEXT("DXT5"));
+		SendDlgItemMessage(hWnd, IDC_TEXTURE_COMPRESSION, CB_ADDSTRING, 0, (LPARAM)__TEXT("BC4 (single channel)"));
+		SendDlgItemMessage(hWnd, IDC_TEXTURE_COMPRESSION, CB_ADDSTRING, 0, (LPARAM)__TEXT("BC5 (red and green)"));
 	}
 
 	SendDlgItemMessage(hWnd, IDC_TEXTURE_COMPRESSION, CB_SETCURSEL, 0, 0);
@@ -347,12 +364,15 @@ void CExportDlg::GetOptions()
 	if( IsDlgButtonChecked(hWnd, IDC_DESC_TEXT) ) fontDescFormat = 0;
 	if( IsDlgButtonChecked(hWnd, IDC_DESC_XML)  ) fontDescFormat = 1;
 	if( IsDlgButtonChecked(hWnd, IDC_DESC_BIN)  ) fontDescFormat = 2;
+	if( IsDlgButtonChecked(hWnd, IDC_DESC_RUNTIME) ) fontDescFormat = 3;
+	if( IsDlgButtonChecked(hWnd, IDC_DESC_HEADER)  ) fontDescFormat = 4;
+	useKerningClasses = IsDlgButtonChecked(hWnd, IDC_KERNCLASSES) ? true : false;
 
 	// Get the file extension from combo box
 	TCHAR buf[256];
 	GetDlgItemText(hWnd, IDC_TEXTURE_FMT, buf, 256);
 	ConvertTCharToUtf8(buf, textureFormat);
-	textureFormat.resize(3);
+	textureFormat.resize(textureFormat.find(' '));
 
 	textureCompression = (int)SendDlgItemMessage(hWnd, IDC_TEXTURE_COMPRESSION, CB_GETCURSEL, 0, 0);
 
@@ -63,6 +63,7 @@ public:
 	bool invB;
 
 	int fontDescFormat;
+	bool useKerningClasses;
 
 	string textureFormat;
 	int textureCompression;
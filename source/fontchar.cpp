@@ -26,6 +26,7 @@
 */
 
 #include <math.h>
+#include <string.h>
 #include "fontchar.h"
 #include "unicode.h"
 #include "acutil_unicode.h"
@@ -35,13 +36,220 @@
 
 CFontChar::CFontChar()
 {
-	m_charImg = 0;
+	m_charImg    = 0;
+	m_packedImg  = 0;
+	m_packedSize = 0;
+	m_packedGray = false;
 }
 
 CFontChar::~CFontChar()
+{
+	ReleaseImage();
+}
+
+void CFontChar::ReleaseImage()
 {
 	if( m_charImg )
 		delete m_charImg;
+	m_charImg = 0;
+
+	if( m_packedImg )
+		delete[] m_packedImg;
+	m_packedImg  = 0;
+	m_packedSize = 0;
+}
+
+// The images are run length encoded. A control byte of 0-127 is followed by
+// that many plus one literal values, and a control byte of 128-255 by a 
+// single value that is repeated control - 126 times. Gray images, where all
+// bytes of each pixel are equal, store a single byte per pixel.
+static inline BYTE  PackValue(PIXEL p, BYTE)  { return BYTE(p); }
+static inline PIXEL PackValue(PIXEL p, PIXEL) { return p; }
+static inline PIXEL UnpackValue(BYTE v)  { return PIXEL(v) * 0x01010101; }
+static inline PIXEL UnpackValue(PIXEL v) { return v; }
+
+template<class T>
+static size_t EncodeRuns(const PIXEL *src, size_t count, BYTE *dst)
+{
+	BYTE *out = dst;
+	size_t n = 0;
+	while( n < count )
+	{
+		T value = PackValue(src[n], T());
+		size_t run = 1;
+		while( n + run < count && run < 129 && PackValue(src[n+run], T()) == value )
+			run++;
+
+		if( run >= 2 )
+		{
+			*out++ = BYTE(126 + run);
+			memcpy(out, &value, sizeof(T));
+			out += sizeof(T);
+			n += run;
+		}
+		else
+		{
+			// Gather literals until the next run of equal values. The 
+			// first value is always taken since it doesn't start a run.
+			BYTE *ctrl = out++;
+			size_t len = 0;
+			while( n < count && len < 128 && (n + 1 >= count || PackValue(src[n+1], T()) != PackValue(src[n], T())) )
+			{
+				T v = PackValue(src[n++], T());
+				memcpy(out, &v, sizeof(T));
+				out += sizeof(T);
+				len++;
+			}
+			*ctrl = BYTE(len - 1);
+		}
+	}
+
+	return out - dst;
+}
+
+template<class T>
+static int DecodeRuns(const BYTE *src, size_t size, PIXEL *dst, size_t count)
+{
+	const BYTE *end = src + size;
+	size_t n = 0;
+	while( src < end )
+	{
+		BYTE ctrl = *src++;
+		size_t len = ctrl < 128 ? ctrl + 1 : ctrl - 126;
+		size_t bytes = ctrl < 128 ? len*sizeof(T) : sizeof(T);
+		if( n + len > count || src + bytes > end )
+			return -1;
+
+		T v;
+		if( ctrl < 128 )
+		{
+			for( size_t i = 0; i < len; i++, src += sizeof(T) )
+			{
+				memcpy(&v, src, sizeof(T));
+				dst[n++] = UnpackValue(v);
+			}
+		}
+		else
+		{
+			memcpy(&v, src, sizeof(T));
+			src += sizeof(T);
+			PIXEL p = UnpackValue(v);
+			for( size_t i = 0; i < len; i++ )
+				dst[n++] = p;
+		}
+	}
+
+	return n == count ? 0 : -1;
+}
+
+int CFontChar::CompressImage()
+{
+	if( m_charImg == 0 || m_charImg->pixels == 0 )
+		return 0;
+
+	size_t count = size_t(m_charImg->width) * m_charImg->height;
+	const PIXEL *pixels = m_charImg->pixels;
+
+	bool gray = true;
+	for( size_t n = 0; n < count && gray; n++ )
+		gray = pixels[n] == (pixels[n] & 0xFF) * 0x01010101;
+
+	// Encode to a buffer large enough for the worst case, and then
+	// keep only what was used. No pixel takes more than one control 
+	// byte and one value, which is what single literals between short
+	// runs come to.
+	size_t valueSize = gray ? 1 : sizeof(PIXEL);
+	BYTE *buf = new (std::nothrow) BYTE[count*(valueSize + 1) + 1];
+	if( buf == 0 )
+		return -1;
+	size_t size = gray ? EncodeRuns<BYTE>(pixels, count, buf) : EncodeRuns<PIXEL>(pixels, count, buf);
+
+	BYTE *packed = new (std::nothrow) BYTE[size ? size : 1];
+	if( packed == 0 )
+	{
+		delete[] buf;
+		return -1;
+	}
+	memcpy(packed, buf, size);
+	delete[] buf;
+
+	if( m_packedImg )
+		delete[] m_packedImg;
+	m_packedImg  = packed;
+	m_packedSize = (unsigned int)size;
+	m_packedGray = gray;
+
+	delete[] m_charImg->pixels;
+	m_charImg->pixels = 0;
+
+	return 0;
+}
+
+void CFontChar::ReleasePixels()
+{
+	if( m_charImg && m_charImg->pixels )
+	{
+		delete[] m_charImg->pixels;
+		m_charImg->pixels = 0;
+	}
+
+	if( m_packedImg )
+		delete[] m_packedImg;
+	m_packedImg  = 0;
+	m_packedSize = 0;
+}
+
+int CFontChar::RedrawImage(HFONT font, const CFontGen *gen)
+{
+	// Imported images are never released, and neither are the images that are still there
+	if( !m_isChar || m_charImg == 0 || m_charImg->pixels || m_packedImg )
+		return 0;
+
+	// The character is drawn the same way as when it was measured, so the image
+	// has the same size, but the metrics already adjusted for the page are kept
+	CFontChar ch;
+	int r = m_id == -1 ? ch.DrawInvalidCharGlyph(font, gen) : ch.DrawChar(font, m_id, gen);
+	if( r < 0 || ch.m_charImg == 0 )
+		return -1;
+	if( gen->GetOutlineThickness() )
+		ch.AddOutline(gen->GetOutlineThickness());
+
+	if( ch.m_charImg->width != m_charImg->width || ch.m_charImg->height != m_charImg->height )
+		return -1;
+
+	delete m_charImg;
+	m_charImg = ch.m_charImg;
+	ch.m_charImg = 0;
+
+	return 0;
+}
+
+bool CFontChar::IsImageCompressed() const
+{
+	return m_packedImg != 0;
+}
+
+const cImage *CFontChar::GetImage(cImage &temp) const
+{
+	if( m_packedImg == 0 )
+		return m_charImg;
+
+	if( temp.Create(m_charImg->width, m_charImg->height) < 0 )
+		return 0;
+
+	size_t count = size_t(temp.width) * temp.height;
+	int r = m_packedGray ? DecodeRuns<BYTE>(m_packedImg, m_packedSize, temp.pixels, count) : DecodeRuns<PIXEL>(m_packedImg, m_packedSize, temp.pixels, count);
+
+	return r >= 0 ? &temp : 0;
+}
+
+size_t CFontChar::GetImageMemory() const
+{
+	size_t size = m_packedSize;
+	if( m_charImg && m_charImg->pixels )
+		size += size_t(m_charImg->width) * m_charImg->height * 4;
+
+	return size;
 }
 
 void CFontChar::CreateFromImage(int ch, cImage *image, int xoffset, int yoffset, int advance)
@@ -70,42 +278,44 @@ bool CFontChar::HasOutline()
 BYTE CFontChar::GetPixelValue(int x, int y, int encoding)
 {
 	if( m_isChar )
-	{	
-		if( encoding == e_one ) return 255;
-		if( encoding == e_zero ) return 0;
+		return EncodePixelValue(m_charImg->pixels[y*m_charImg->width+x], m_colored, encoding);
+
+	return 0;
+}
+
+BYTE CFontChar::EncodePixelValue(DWORD color, bool hasOutline, int encoding)
+{
+	if( encoding == e_one ) return 255;
+	if( encoding == e_zero ) return 0;
 
-		// Does the character have an outline?
-		if( m_colored )
+	// Does the character have an outline?
+	if( hasOutline )
+	{
+		if( BYTE(color) )
 		{
-			DWORD color = m_charImg->pixels[y*m_charImg->width+x];
-			if( BYTE(color) )
-			{
-				if( encoding == e_glyph )
-					return (BYTE)color;
-				else if( encoding == e_outline )
-					return 255;
-				else if( encoding == e_glyph_outline )
-					return 0x80 | (((BYTE)(color))>>1);
-			}
-			else
-			{
-				if( encoding == e_glyph )
-					return 0;
-				else if( encoding == e_outline )
-                    return BYTE(color>>24);
-				else if( encoding == e_glyph_outline )
-					return BYTE(color>>25);
-			}
+			if( encoding == e_glyph )
+				return (BYTE)color;
+			else if( encoding == e_outline )
+				return 255;
+			else if( encoding == e_glyph_outline )
+				return 0x80 | (((BYTE)(color))>>1);
 		}
 		else
 		{
-			// Since the character has no outline we 
-			// always return the same value
-			return (BYTE)m_charImg->pixels[y*m_charImg->width+x];
+			if( encoding == e_glyph )
+				return 0;
+			else if( encoding == e_outline )
+				return BYTE(color>>24);
+			else if( encoding == e_glyph_outline )
+				return BYTE(color>>25);
 		}
+
+		return 0;
 	}
 
-	return 0;
+	// Since the character has no outline we 
+	// always return the same value
+	return (BYTE)color;
 }
 
 int CFontChar::DrawInvalidCharGlyph(HFONT font, const CFontGen *gen)
@@ -51,6 +51,26 @@ public:
 
 	void CreateFromImage(int id, cImage *image, int xoffset, int yoffset, int advance);
 
+	// The image can be compressed while the character waits to be composited,
+	// since glyphs are mostly empty. The size of m_charImg is kept for the 
+	// packing, but its pixels are freed. Returns -1 if out of memory.
+	int  CompressImage();
+	bool IsImageCompressed() const;
+
+	// Returns the image for compositing. A compressed image is decompressed
+	// to the temporary image. Returns 0 if out of memory.
+	const cImage *GetImage(cImage &temp) const;
+
+	// The number of bytes held by the image, compressed or not
+	size_t GetImageMemory() const;
+	void   ReleaseImage();
+
+	// Frees the pixels but keeps the size of m_charImg for the packing, so the
+	// character can be measured first and drawn again with RedrawImage once it
+	// has been placed. RedrawImage returns -1 if out of memory.
+	void   ReleasePixels();
+	int    RedrawImage(HFONT font, const CFontGen *gen);
+
 	int m_id;
 
 	int m_x;
@@ -66,10 +86,18 @@ public:
 	bool HasOutline();
 	BYTE GetPixelValue(int x, int y, int encoding);
 
+	// Encodes a pixel of a character image, i.e. the glyph in the lowest byte
+	// and the outline in the alpha byte, according to the channel encoding
+	static BYTE EncodePixelValue(DWORD color, bool hasOutline, int encoding);
+
 	bool m_colored;
 	bool m_isChar;
 
 	cImage *m_charImg;
+
+	BYTE        *m_packedImg;
+	unsigned int m_packedSize;
+	bool         m_packedGray; // Only the lowest byte of each pixel is stored
 };
 
 #endif
\ No newline at end of file
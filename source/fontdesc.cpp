@@ -0,0 +1,724 @@
+/*
+   AngelCode Bitmap Font Generator
+   Copyright (c) 2004-2016 Andreas Jonsson
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any
+   damages arising from the use of this software.
+
+   Permission is granted to anyone to use this software for any
+   purpose, including commercial applications, and to alter it and
+   redistribute it freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you
+      must not claim that you wrote the original software. If you use
+      this software in a product, an acknowledgment in the product
+      documentation would be appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and
+      must not be misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+      distribution.
+
+   Andreas Jonsson
+   andreas@angelcode.com
+*/
+
+#include <string.h>
+#include <algorithm>
+#include "fontdesc.h"
+#include "acutil_file.h"
+#include "runtimefont.h"
+
+using namespace std;
+
+// A piece of the mapped file. The tokens point into the file so 
+// nothing is allocated while tokenizing.
+struct SToken
+{
+	SToken() {str = 0; len = 0;}
+
+	bool Is(const char *s) const { return strlen(s) == len && memcmp(str, s, len) == 0; }
+	string ToString() const { return string(str, len); }
+
+	const char *str;
+	size_t      len;
+};
+
+// Splits the descriptor into tags with attributes. In the text format each
+// line is a tag, where the first word is the name and the rest are the 
+// attributes. In the XML format each element is a tag, and the closing 
+// elements, comments and the declaration are skipped.
+class CTokenizer
+{
+public:
+	CTokenizer(const char *data, const char *end, bool xml) { pos = data; this->end = end; this->xml = xml; inTag = false; }
+
+	bool NextTag(SToken &name);
+	bool NextAttr(SToken &key, SToken &value);
+
+protected:
+	void SkipSpace() { while( pos < end && (*pos == ' ' || *pos == '\t' || *pos == '\r' || (xml && *pos == '\n')) ) pos++; }
+	static bool IsNameChar(char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '-'; }
+
+	const char *pos;
+	const char *end;
+	bool        xml;
+	bool        inTag;
+};
+
+bool CTokenizer::NextTag(SToken &name)
+{
+	for( ;; )
+	{
+		if( xml )
+		{
+			// Skip what is left of the previous element
+			if( inTag )
+			{
+				while( pos < end && *pos != '>' ) pos++;
+				inTag = false;
+			}
+			while( pos < end && *pos != '<' ) pos++;
+			if( pos + 1 >= end ) return false;
+			pos++;
+
+			if( *pos == '/' || *pos == '?' || *pos == '!' )
+			{
+				while( pos < end && *pos != '>' ) pos++;
+				continue;
+			}
+		}
+		else
+		{
+			// Skip what is left of the previous line
+			if( inTag )
+			{
+				while( pos < end && *pos != '\n' ) pos++;
+				if( pos < end ) pos++;
+				inTag = false;
+			}
+			SkipSpace();
+			if( pos >= end ) return false;
+			if( *pos == '\n' ) 
+			{
+				pos++;
+				continue;
+			}
+		}
+
+		inTag = true;
+		name.str = pos;
+		while( pos < end && IsNameChar(*pos) ) pos++;
+		name.len = pos - name.str;
+		if( name.len ) 
+			return true;
+	}
+}
+
+bool CTokenizer::NextAttr(SToken &key, SToken &value)
+{
+	SkipSpace();
+	if( pos >= end || *pos == '\n' || *pos == '/' || *pos == '>' )
+		return false;
+
+	key.str = pos;
+	while( pos < end && IsNameChar(*pos) ) pos++;
+	key.len = pos - key.str;
+	if( key.len == 0 || pos >= end || *pos != '=' )
+		return false;
+	pos++;
+
+	if( pos < end && *pos == '"' )
+	{
+		value.str = ++pos;
+		while( pos < end && *pos != '"' && *pos != '\n' ) pos++;
+		value.len = pos - value.str;
+		if( pos < end && *pos == '"' ) pos++;
+	}
+	else
+	{
+		value.str = pos;
+		while( pos < end && *pos != ' ' && *pos != '\t' && *pos != '\r' && *pos != '\n' && *pos != '/' && *pos != '>' ) pos++;
+		value.len = pos - value.str;
+	}
+
+	return true;
+}
+
+// Parses the next integer in a list separated by commas or spaces.
+// Returns false when there are no more values.
+static bool ParseNextInt(const char *&pos, const char *end, int &value)
+{
+	while( pos < end && (*pos == ' ' || *pos == ',') ) pos++;
+	if( pos >= end || !(*pos == '-' || *pos == '+' || (*pos >= '0' && *pos <= '9')) ) 
+		return false;
+
+	bool neg = *pos == '-';
+	if( neg || *pos == '+' ) pos++;
+	int v = 0;
+	while( pos < end && *pos >= '0' && *pos <= '9' )
+		v = v*10 + (*pos++ - '0');
+	value = neg ? -v : v;
+
+	return true;
+}
+
+// Returns the number of values that were parsed
+static int ParseInts(const SToken &token, int *values, int maxValues)
+{
+	const char *pos = token.str;
+	int count = 0;
+	while( count < maxValues && ParseNextInt(pos, token.str + token.len, values[count]) )
+		count++;
+
+	return count;
+}
+
+static int ParseInt(const SToken &token)
+{
+	int v = 0;
+	ParseInts(token, &v, 1);
+	return v;
+}
+
+CFontDesc::CFontDesc()
+{
+	Clear();
+}
+
+void CFontDesc::Clear()
+{
+	format = FORMAT_TEXT;
+
+	info.face     = "";
+	info.charSet  = "";
+	info.size     = 0;
+	info.bold     = false;
+	info.italic   = false;
+	info.unicode  = false;
+	info.smooth   = false;
+	info.stretchH = 100;
+	info.aa       = 1;
+	info.padding[0] = info.padding[1] = info.padding[2] = info.padding[3] = 0;
+	info.spacing[0] = info.spacing[1] = 0;
+	info.outline  = 0;
+
+	memset(&common, 0, sizeof(common));
+
+	pages.clear();
+	chars.clear();
+	kernings.clear();
+
+	numFirstClasses  = 0;
+	numSecondClasses = 0;
+	firstClasses.clear();
+	secondClasses.clear();
+	classAmounts.clear();
+}
+
+int CFontDesc::Load(const string &filename)
+{
+	acUtility::CMappedFile file;
+	if( file.Open(filename) < 0 )
+		return -1;
+
+	return Parse(file.GetData(), file.GetSize());
+}
+
+int CFontDesc::Parse(const void *data, size_t size)
+{
+	Clear();
+
+	const char *str = (const char*)data;
+	int r;
+	if( size >= 4 && memcmp(str, "BMFR", 4) == 0 )
+	{
+		format = FORMAT_RUNTIME;
+		r = ParseRuntime(data, size);
+	}
+	else if( size >= 4 && memcmp(str, "BMF", 3) == 0 )
+	{
+		format = FORMAT_BINARY;
+		r = ParseBinary((const unsigned char*)data, size);
+	}
+	else
+	{
+		// The XML format starts with the declaration or the font element
+		size_t start = 0;
+		while( start < size && (str[start] == ' ' || str[start] == '\t' || str[start] == '\r' || str[start] == '\n') )
+			start++;
+		format = (start < size && str[start] == '<') ? FORMAT_XML : FORMAT_TEXT;
+		r = ParseText(str, str + size, format == FORMAT_XML);
+	}
+
+	if( r < 0 )
+	{
+		Clear();
+		return -1;
+	}
+
+	Sort();
+	return 0;
+}
+
+int CFontDesc::ParseText(const char *data, const char *end, bool xml)
+{
+	// Reserve for the typical length of a char line, unless the count is given
+	chars.reserve((end - data)/100);
+
+	CTokenizer tok(data, end, xml);
+	SToken name, key, value;
+	bool hasFont = false;
+	int  classRow = 0;
+	while( tok.NextTag(name) )
+	{
+		if( name.Is("char") )
+		{
+			SChar ch;
+			memset(&ch, 0, sizeof(ch));
+			while( tok.NextAttr(key, value) )
+			{
+				int v = ParseInt(value);
+				if( key.Is("id") )            ch.id       = v;
+				else if( key.Is("x") )        ch.x        = (unsigned short)v;
+				else if( key.Is("y") )        ch.y        = (unsigned short)v;
+				else if( key.Is("width") )    ch.width    = (unsigned short)v;
+				else if( key.Is("height") )   ch.height   = (unsigned short)v;
+				else if( key.Is("xoffset") )  ch.xoffset  = (short)v;
+				else if( key.Is("yoffset") )  ch.yoffset  = (short)v;
+				else if( key.Is("xadvance") ) ch.xadvance = (short)v;
+				else if( key.Is("page") )     ch.page     = (unsigned char)v;
+				else if( key.Is("chnl") )     ch.chnl     = (unsigned char)v;
+			}
+
+			// The text format doesn't always give the channel
+			if( !xml && ch.chnl == 0 )
+				ch.chnl = 15;
+			chars.push_back(ch);
+		}
+		else if( name.Is("kerning") )
+		{
+			SKerning k;
+			memset(&k, 0, sizeof(k));
+			while( tok.NextAttr(key, value) )
+			{
+				if( key.Is("first") )       k.first  = ParseInt(value);
+				else if( key.Is("second") ) k.second = ParseInt(value);
+				else if( key.Is("amount") ) k.amount = (short)ParseInt(value);
+			}
+			kernings.push_back(k);
+		}
+		else if( name.Is("info") )
+		{
+			hasFont = true;
+			while( tok.NextAttr(key, value) )
+			{
+				if( key.Is("face") )          info.face     = value.ToString();
+				else if( key.Is("charset") )  info.charSet  = value.ToString();
+				else if( key.Is("size") )     info.size     = ParseInt(value);
+				else if( key.Is("bold") )     info.bold     = ParseInt(value) != 0;
+				else if( key.Is("italic") )   info.italic   = ParseInt(value) != 0;
+				else if( key.Is("unicode") )  info.unicode  = ParseInt(value) != 0;
+				else if( key.Is("smooth") )   info.smooth   = ParseInt(value) != 0;
+				else if( key.Is("stretchH") ) info.stretchH = ParseInt(value);
+				else if( key.Is("aa") )       info.aa       = ParseInt(value);
+				else if( key.Is("padding") )  ParseInts(value, info.padding, 4);
+				else if( key.Is("spacing") )  ParseInts(value, info.spacing, 2);
+				else if( key.Is("outline") )  info.outline  = ParseInt(value);
+			}
+
+			// The text format has no unicode attribute, but leaves the charset empty for unicode
+			if( !xml )
+				info.unicode = info.charSet == "";
+		}
+		else if( name.Is("common") )
+		{
+			while( tok.NextAttr(key, value) )
+			{
+				int v = ParseInt(value);
+				if( key.Is("lineHeight") )     common.lineHeight = v;
+				else if( key.Is("base") )      common.base       = v;
+				else if( key.Is("scaleW") )    common.scaleW     = v;
+				else if( key.Is("scaleH") )    common.scaleH     = v;
+				else if( key.Is("pages") )     common.pages      = v;
+				else if( key.Is("packed") )    common.packed     = v != 0;
+				else if( key.Is("alphaChnl") ) common.alphaChnl  = v;
+				else if( key.Is("redChnl") )   common.redChnl    = v;
+				else if( key.Is("greenChnl") ) common.greenChnl  = v;
+				else if( key.Is("blueChnl") )  common.blueChnl   = v;
+			}
+		}
+		else if( name.Is("page") )
+		{
+			int id = -1;
+			SToken file;
+			while( tok.NextAttr(key, value) )
+			{
+				if( key.Is("id") )        id   = ParseInt(value);
+				else if( key.Is("file") ) file = value;
+			}
+			if( id < 0 || id > 0xFFFF )
+				return -1;
+			if( id >= (int)pages.size() )
+				pages.resize(id+1);
+			pages[id] = file.ToString();
+		}
+		else if( name.Is("chars") || name.Is("kernings") )
+		{
+			while( tok.NextAttr(key, value) )
+			{
+				if( !key.Is("count") ) continue;
+				if( name.Is("chars") ) chars.reserve(ParseInt(value));
+				else                   kernings.reserve(ParseInt(value));
+			}
+		}
+		else if( name.Is("kerningclasses") )
+		{
+			while( tok.NextAttr(key, value) )
+			{
+				if( key.Is("firstClasses") )       numFirstClasses  = ParseInt(value);
+				else if( key.Is("secondClasses") ) numSecondClasses = ParseInt(value);
+			}
+			if( numFirstClasses > 0xFFFF || numSecondClasses > 0xFFFF )
+				return -1;
+			classAmounts.assign(numFirstClasses*numSecondClasses, 0);
+			classRow = 0;
+		}
+		else if( name.Is("first") || name.Is("second") )
+		{
+			SCharClass c;
+			c.id  = 0;
+			c.cls = 0;
+			while( tok.NextAttr(key, value) )
+			{
+				if( key.Is("id") )         c.id  = ParseInt(value);
+				else if( key.Is("class") ) c.cls = (unsigned short)ParseInt(value);
+			}
+			if( name.Is("first") ) firstClasses.push_back(c);
+			else                   secondClasses.push_back(c);
+		}
+		else if( name.Is("row") )
+		{
+			int row = classRow++;
+			SToken amounts;
+			while( tok.NextAttr(key, value) )
+			{
+				if( key.Is("class") )        row     = ParseInt(value);
+				else if( key.Is("amounts") ) amounts = value;
+			}
+			if( row < 0 || unsigned(row) >= numFirstClasses )
+				return -1;
+
+			const char *pos = amounts.str;
+			int v;
+			for( unsigned int c = 0; c < numSecondClasses && ParseNextInt(pos, amounts.str + amounts.len, v); c++ )
+				classAmounts[row*numSecondClasses + c] = (short)v;
+		}
+		else if( name.Is("font") )
+			hasFont = true;
+	}
+
+	return hasFont ? 0 : -1;
+}
+
+#pragma pack(push)
+#pragma pack(1)
+struct SInfoBlock
+{
+	short          fontSize;
+	unsigned char  bits;     // smooth = 0x80, unicode = 0x40, italic = 0x20, bold = 0x10
+	unsigned char  charSet;
+	unsigned short stretchH;
+	unsigned char  aa;
+	unsigned char  padding[4];
+	unsigned char  spacing[2];
+	unsigned char  outline;
+};
+
+struct SCommonBlock
+{
+	unsigned short lineHeight;
+	unsigned short base;
+	unsigned short scaleW;
+	unsigned short scaleH;
+	unsigned short pages;
+	unsigned char  bits;     // packed = 0x01
+	unsigned char  alphaChnl;
+	unsigned char  redChnl;
+	unsigned char  greenChnl;
+	unsigned char  blueChnl;
+};
+
+struct SCharBlock
+{
+	unsigned int   id;
+	unsigned short x;
+	unsigned short y;
+	unsigned short width;
+	unsigned short height;
+	short          xoffset;
+	short          yoffset;
+	short          xadvance;
+	unsigned char  page;
+	unsigned char  chnl;
+};
+
+struct SKerningBlock
+{
+	unsigned int first;
+	unsigned int second;
+	short        amount;
+};
+
+struct SKerningClassesBlock
+{
+	unsigned short numFirstClasses;
+	unsigned short numSecondClasses;
+	unsigned int   numFirstChars;
+	unsigned int   numSecondChars;
+};
+
+struct SKerningClassBlock
+{
+	unsigned int   id;
+	unsigned short cls;
+};
+#pragma pack(pop)
+
+int CFontDesc::ParseBinary(const unsigned char *data, size_t size)
+{
+	// Only version 3 is written by the generator
+	if( data[3] != 3 )
+		return -1;
+
+	size_t pos = 4;
+	while( pos < size )
+	{
+		if( size - pos < 5 )
+			return -1;
+		int type = data[pos];
+		unsigned int blockSize;
+		memcpy(&blockSize, data + pos + 1, 4);
+		pos += 5;
+		if( blockSize > size - pos )
+			return -1;
+		const unsigned char *block = data + pos;
+		pos += blockSize;
+
+		if( type == 1 )
+		{
+			SInfoBlock b;
+			if( blockSize < sizeof(b) + 1 || block[blockSize-1] != 0 )
+				return -1;
+			memcpy(&b, block, sizeof(b));
+			info.size     = b.fontSize;
+			info.smooth   = (b.bits & 0x80) != 0;
+			info.unicode  = (b.bits & 0x40) != 0;
+			info.italic   = (b.bits & 0x20) != 0;
+			info.bold     = (b.bits & 0x10) != 0;
+			info.charSet  = to_string((long long)b.charSet);
+			info.stretchH = b.stretchH;
+			info.aa       = b.aa;
+			for( int n = 0; n < 4; n++ ) info.padding[n] = b.padding[n];
+			for( int n = 0; n < 2; n++ ) info.spacing[n] = b.spacing[n];
+			info.outline  = b.outline;
+			info.face     = (const char*)block + sizeof(b);
+		}
+		else if( type == 2 )
+		{
+			SCommonBlock b;
+			if( blockSize < sizeof(b) )
+				return -1;
+			memcpy(&b, block, sizeof(b));
+			common.lineHeight = b.lineHeight;
+			common.base       = b.base;
+			common.scaleW     = b.scaleW;
+			common.scaleH     = b.scaleH;
+			common.pages      = b.pages;
+			common.packed     = (b.bits & 0x01) != 0;
+			common.alphaChnl  = b.alphaChnl;
+			common.redChnl    = b.redChnl;
+			common.greenChnl  = b.greenChnl;
+			common.blueChnl   = b.blueChnl;
+		}
+		else if( type == 3 )
+		{
+			// The file names are null terminated one after the other
+			if( blockSize && block[blockSize-1] != 0 )
+				return -1;
+			for( size_t n = 0; n < blockSize; )
+			{
+				const char *name = (const char*)block + n;
+				size_t len = strlen(name);
+				pages.push_back(string(name, len));
+				n += len + 1;
+			}
+		}
+		else if( type == 4 )
+		{
+			// The records are copied directly, as the layout is the same
+			static_assert(sizeof(SChar) == sizeof(SCharBlock), "The char must have the layout of the char block");
+			if( blockSize % sizeof(SCharBlock) )
+				return -1;
+			size_t count = blockSize / sizeof(SCharBlock);
+			size_t first = chars.size();
+			chars.resize(first + count);
+			memcpy(&chars[first], block, blockSize);
+		}
+		else if( type == 5 )
+		{
+			if( blockSize % sizeof(SKerningBlock) )
+				return -1;
+			size_t count = blockSize / sizeof(SKerningBlock);
+			kernings.reserve(kernings.size() + count);
+			for( size_t n = 0; n < count; n++ )
+			{
+				SKerningBlock b;
+				memcpy(&b, block + n*sizeof(b), sizeof(b));
+				SKerning k;
+				k.first  = int(b.first);
+				k.second = int(b.second);
+				k.amount = b.amount;
+				kernings.push_back(k);
+			}
+		}
+		else if( type == 6 )
+		{
+			SKerningClassesBlock h;
+			if( blockSize < sizeof(h) )
+				return -1;
+			memcpy(&h, block, sizeof(h));
+			size_t expected = sizeof(h) + sizeof(SKerningClassBlock)*(size_t(h.numFirstChars) + h.numSecondChars) + sizeof(short)*size_t(h.numFirstClasses)*h.numSecondClasses;
+			if( blockSize != expected )
+				return -1;
+
+			numFirstClasses  = h.numFirstClasses;
+			numSecondClasses = h.numSecondClasses;
+			const unsigned char *p = block + sizeof(h);
+			for( unsigned int n = 0; n < h.numFirstChars + h.numSecondChars; n++, p += sizeof(SKerningClassBlock) )
+			{
+				SKerningClassBlock b;
+				memcpy(&b, p, sizeof(b));
+				SCharClass c;
+				c.id  = int(b.id);
+				c.cls = b.cls;
+				if( n < h.numFirstChars ) firstClasses.push_back(c);
+				else                      secondClasses.push_back(c);
+			}
+			classAmounts.resize(size_t(numFirstClasses)*numSecondClasses);
+			if( classAmounts.size() )
+				memcpy(&classAmounts[0], p, classAmounts.size()*sizeof(short));
+		}
+
+		// Unknown blocks are skipped, so newer files can still be read
+	}
+
+	return 0;
+}
+
+// The view has already verified the arrays, kerning ranges and names, so the values are only copied
+int CFontDesc::ParseRuntime(const void *data, size_t size)
+{
+	CRuntimeFontView view;
+	if( view.Attach(data, size) < 0 )
+		return -1;
+
+	const SRuntimeFontHeader *h = view.GetHeader();
+	info.face         = view.GetFaceName();
+	info.size         = h->fontSize;
+	common.lineHeight = h->lineHeight;
+	common.base       = h->base;
+	common.scaleW     = h->scaleW;
+	common.scaleH     = h->scaleH;
+	common.pages      = h->numPages;
+	common.packed     = h->packed != 0;
+	common.alphaChnl  = h->alphaChnl;
+	common.redChnl    = h->redChnl;
+	common.greenChnl  = h->greenChnl;
+	common.blueChnl   = h->blueChnl;
+	for( unsigned int n = 0; n < h->numPages; n++ )
+		pages.push_back(view.GetPageFile(n));
+
+	chars.resize(h->numGlyphs);
+	for( unsigned int n = 0; n < h->numGlyphs; n++ )
+	{
+		SChar &ch   = chars[n];
+		ch.id       = int(view.GetArray<unsigned int>(RTF_CODEPOINTS)[n]);
+		ch.x        = view.GetArray<unsigned short>(RTF_X)[n];
+		ch.y        = view.GetArray<unsigned short>(RTF_Y)[n];
+		ch.width    = view.GetArray<unsigned short>(RTF_WIDTH)[n];
+		ch.height   = view.GetArray<unsigned short>(RTF_HEIGHT)[n];
+		ch.xoffset  = view.GetArray<short>(RTF_XOFFSET)[n];
+		ch.yoffset  = view.GetArray<short>(RTF_YOFFSET)[n];
+		ch.xadvance = view.GetArray<short>(RTF_XADVANCE)[n];
+		ch.page     = view.GetArray<unsigned char>(RTF_PAGE)[n];
+		ch.chnl     = view.GetArray<unsigned char>(RTF_CHNL)[n];
+
+		const unsigned int *start = view.GetArray<unsigned int>(RTF_KERNING_START);
+		for( unsigned int k = start[n]; k < start[n+1] && k < h->numKernings; k++ )
+		{
+			SKerning pair;
+			pair.first  = ch.id;
+			pair.second = int(view.GetArray<unsigned int>(RTF_KERNING_SECOND)[k]);
+			pair.amount = view.GetArray<short>(RTF_KERNING_AMOUNT)[k];
+			kernings.push_back(pair);
+		}
+	}
+
+	return 0;
+}
+
+static bool CharLess(const CFontDesc::SChar &a, const CFontDesc::SChar &b) { return a.id < b.id; }
+static bool ClassLess(const CFontDesc::SCharClass &a, const CFontDesc::SCharClass &b) { return a.id < b.id; }
+static bool KerningLess(const CFontDesc::SKerning &a, const CFontDesc::SKerning &b) { return a.first < b.first || (a.first == b.first && a.second < b.second); }
+
+// The generator writes the characters in order already, so this is cheap
+void CFontDesc::Sort()
+{
+	if( !is_sorted(chars.begin(), chars.end(), CharLess) )
+		stable_sort(chars.begin(), chars.end(), CharLess);
+	if( !is_sorted(kernings.begin(), kernings.end(), KerningLess) )
+		stable_sort(kernings.begin(), kernings.end(), KerningLess);
+	if( !is_sorted(firstClasses.begin(), firstClasses.end(), ClassLess) )
+		stable_sort(firstClasses.begin(), firstClasses.end(), ClassLess);
+	if( !is_sorted(secondClasses.begin(), secondClasses.end(), ClassLess) )
+		stable_sort(secondClasses.begin(), secondClasses.end(), ClassLess);
+}
+
+const CFontDesc::SChar *CFontDesc::FindChar(int id) const
+{
+	SChar key;
+	key.id = id;
+	vector<SChar>::const_iterator it = lower_bound(chars.begin(), chars.end(), key, CharLess);
+	if( it == chars.end() || it->id != id )
+		return 0;
+
+	return &*it;
+}
+
+int CFontDesc::GetKerning(int first, int second) const
+{
+	SKerning key;
+	key.first  = first;
+	key.second = second;
+	vector<SKerning>::const_iterator it = lower_bound(kernings.begin(), kernings.end(), key, KerningLess);
+	if( it != kernings.end() && it->first == first && it->second == second )
+		return it->amount;
+
+	if( classAmounts.empty() )
+		return 0;
+
+	SCharClass c;
+	c.id = first;
+	vector<SCharClass>::const_iterator f = lower_bound(firstClasses.begin(), firstClasses.end(), c, ClassLess);
+	c.id = second;
+	vector<SCharClass>::const_iterator s = lower_bound(secondClasses.begin(), secondClasses.end(), c, ClassLess);
+	if( f == firstClasses.end() || f->id != first || s == secondClasses.end() || s->id != second )
+		return 0;
+	if( f->cls >= numFirstClasses || s->cls >= numSecondClasses )
+		return 0;
+
+	return classAmounts[f->cls*numSecondClasses + s->cls];
+}
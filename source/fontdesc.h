@@ -0,0 +1,143 @@
+/*
+   AngelCode Bitmap Font Generator
+   Copyright (c) 2004-2016 Andreas Jonsson
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any
+   damages arising from the use of this software.
+
+   Permission is granted to anyone to use this software for any
+   purpose, including commercial applications, and to alter it and
+   redistribute it freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you
+      must not claim that you wrote the original software. If you use
+      this software in a product, an acknowledgment in the product
+      documentation would be appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and
+      must not be misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+      distribution.
+
+   Andreas Jonsson
+   andreas@angelcode.com
+*/
+
+#ifndef FONTDESC_H
+#define FONTDESC_H
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+// Reads the font descriptors written by CFontGen::SaveFont in the text, XML,
+// binary and runtime formats. The text format may omit the page lines and the chars 
+// count. The file is memory mapped and parsed in place, so only the model 
+// itself is allocated. It doesn't depend on the rest of the generator, so it
+// can be used by the tools that consume the fonts too.
+class CFontDesc
+{
+public:
+	enum EFormat
+	{
+		FORMAT_TEXT   = 0,
+		FORMAT_XML    = 1,
+		FORMAT_BINARY = 2,
+		FORMAT_RUNTIME = 3
+	};
+
+	struct SInfo
+	{
+		std::string face;
+		std::string charSet;    // The name in the text formats, the number in the binary format
+		int         size;
+		bool        bold;
+		bool        italic;
+		bool        unicode;
+		bool        smooth;
+		int         stretchH;
+		int         aa;
+		int         padding[4]; // up, right, down, left
+		int         spacing[2]; // horizontal, vertical
+		int         outline;
+	};
+
+	struct SCommon
+	{
+		int  lineHeight;
+		int  base;
+		int  scaleW;
+		int  scaleH;
+		int  pages;
+		bool packed;
+		int  alphaChnl;
+		int  redChnl;
+		int  greenChnl;
+		int  blueChnl;
+	};
+
+	// The same 20 bytes as the char block of the binary format
+	struct SChar
+	{
+		int            id;      // -1 for the invalid char glyph
+		unsigned short x;
+		unsigned short y;
+		unsigned short width;
+		unsigned short height;
+		short          xoffset;
+		short          yoffset;
+		short          xadvance;
+		unsigned char  page;
+		unsigned char  chnl;
+	};
+
+	struct SKerning
+	{
+		int   first;
+		int   second;
+		short amount;
+	};
+
+	struct SCharClass
+	{
+		int            id;
+		unsigned short cls;
+	};
+
+	CFontDesc();
+
+	// Returns 0 on success, and -1 if the file can't be read or is malformed
+	int  Load(const std::string &filename);
+	int  Parse(const void *data, size_t size);
+	void Clear();
+
+	// The characters are sorted by id, so they are found with a binary search
+	const SChar *FindChar(int id) const;
+
+	// Looks up the pair first, and then the kerning classes
+	int  GetKerning(int first, int second) const;
+
+	EFormat                  format;
+	SInfo                    info;
+	SCommon                  common;
+	std::vector<std::string> pages;    // Empty if the descriptor has no page lines
+	std::vector<SChar>       chars;
+	std::vector<SKerning>    kernings; // Sorted by first and second
+
+	// The kerning classes, with the amounts in a first by second class matrix
+	unsigned int             numFirstClasses;
+	unsigned int             numSecondClasses;
+	std::vector<SCharClass>  firstClasses;  // Sorted by id
+	std::vector<SCharClass>  secondClasses; // Sorted by id
+	std::vector<short>       classAmounts;
+
+protected:
+	int  ParseText(const char *data, const char *end, bool xml);
+	int  ParseBinary(const unsigned char *data, size_t size);
+	int  ParseRuntime(const void *data, size_t size);
+	void Sort();
+};
+
+#endif
@@ -32,6 +32,7 @@
 #include <math.h>
 #include <Usp10.h>
 #include <fstream>
+#include <algorithm>
 
 #include "acutil_config.h"
 #include "dynamic_funcs.h"
@@ -43,6 +44,11 @@
 #include "acutil_unicode.h"
 #include "acutil_path.h"
 #include "acwin_window.h"
+#include "acutil_parallel.h"
+#include "acutil_file.h"
+#include "runtimefont.h"
+#include "fontheader.h"
+#include "charcorpus.h"
 
 using namespace std;
 using namespace acWindow;
@@ -85,6 +91,10 @@ CFontGen::CFontGen()
 	xScaleV                = 100;
 	fixedHeight            = false;
 	forceZero              = false;
+	frequencyOrder         = false;
+	memoryBudget           = 0;
+	charMemory             = 0;
+	compressChars          = false;
 
 	outWidth           = 256;
 	outHeight          = 256;
@@ -92,7 +102,13 @@ CFontGen::CFontGen()
 	fourChnlPacked     = false;
 	textureFormat      = "tga";
 	textureCompression = 0;
+	dxtFit             = 1;
+	pngLevel           = -1;
+	pngFilter          = 0;
+	pngParallel        = false;
+	ktxZlib            = false;
 	fontDescFormat     = 0;
+	useKerningClasses  = false;
 
 	outlineThickness   = 0;
 	alphaChnl = 1;
@@ -104,7 +120,11 @@ CFontGen::CFontGen()
 	invG = false;
 	invB = false;
 
-	memset(selected, 0, sizeof(selected));
+	numCharsSelected  = 0;
+	numCharsAvailable = 0;
+	lastFoundSubset   = 0;
+	disabled.Resize(maxUnicodeChar+1);
+	selected.Resize(maxUnicodeChar+1);
 	memset(chars, 0, sizeof(chars));
 	invalidCharGlyph = 0;
 }
@@ -354,23 +374,85 @@ int CFontGen::SetTextureCompression(int compression)
 	return 0;
 }
 
+int CFontGen::GetPngLevel() const
+{
+	return pngLevel;
+}
+
+int CFontGen::SetPngLevel(int level)
+{
+	if( level < -1 || level > 9 ) return -1;
+
+	pngLevel = level;
+
+	return 0;
+}
+
+int CFontGen::GetPngFilter() const
+{
+	return pngFilter;
+}
+
+int CFontGen::SetPngFilter(int filter)
+{
+	if( filter < 0 || filter > 4 ) return -1;
+
+	pngFilter = filter;
+
+	return 0;
+}
+
+bool CFontGen::GetPngParallel() const
+{
+	return pngParallel;
+}
+
+int CFontGen::SetPngParallel(bool set)
+{
+	pngParallel = set;
+
+	return 0;
+}
+
+bool CFontGen::GetKtxZlib() const
+{
+	return ktxZlib;
+}
+
+int CFontGen::SetKtxZlib(bool set)
+{
+	ktxZlib = set;
+
+	return 0;
+}
+
+int CFontGen::GetDxtFit() const
+{
+	return dxtFit;
+}
+
+int CFontGen::SetDxtFit(int fit)
+{
+	if( fit < 0 || fit > 2 ) return -1;
+
+	dxtFit = fit;
+
+	return 0;
+}
+
 int CFontGen::IsSubsetSelected(int subset)
 {
 	if( subsets[subset]->selected == -1 )
 	{
-		bool allChecked = true;
-		bool someChecked = false;
+		int begin = subsets[subset]->charBegin;
+		int end   = subsets[subset]->charEnd;
 
-		for( int n = subsets[subset]->charBegin; n <= subsets[subset]->charEnd; n++ )
-		{
-			if( !disabled[n] )
-			{
-				if( selected[n] )
-					someChecked = true;
-				else
-					allChecked = false;
-			}
-		}
+		// Compare the number of selected characters with the available ones
+		unsigned int numAvailable = (end - begin + 1) - disabled.Count(begin, end);
+		unsigned int numSelected  = selected.CountAndNot(disabled, begin, end);
+
+		bool allChecked  = numSelected == numAvailable;
+		bool someChecked = numSelected > 0;
 
 		if( allChecked && someChecked )
 			subsets[subset]->selected = 2;
@@ -400,8 +482,9 @@ int CFontGen::ClearAll()
 	if( isWorking ) return -1;
 	arePagesGenerated = false;
 	
-	memset(selected, 0, (maxUnicodeChar+1)*sizeof(bool));
+	selected.ClearAll();
 	numCharsSelected = 0;
+	charFrequencies.clear();
 
 	// Clear all subset selected flags
 	for( unsigned int n = 0; n < subsets.size(); n++ )
@@ -491,7 +574,7 @@ int CFontGen::SetSelected(int idx, bool set)
 
 	if( selected[idx] != set )
 	{
-		selected[idx] = set;
+		selected.Set(idx, set);
 		numCharsSelected += set ? 1 : -1;
 
 		// Clear the cached subset selected flag
@@ -551,6 +634,15 @@ int CFontGen::SetFontDescFormat(int format)
 	return 0;
 }
 
+int CFontGen::SetUseKerningClasses(bool set)
+{
+	if( isWorking ) return -1;
+	arePagesGenerated = false;
+
+	useKerningClasses = set;
+	return 0;
+}
+
 int CFontGen::SetOutBitDepth(int bitDepth)
 {
 	if( isWorking ) return -1;
@@ -770,6 +862,15 @@ int CFontGen::SetForceZero(bool force)
 	return 0;
 }
 
+int CFontGen::SetFrequencyOrder(bool set)
+{
+	if( isWorking ) return -1;
+	arePagesGenerated = false;
+
+	frequencyOrder = set;
+	return 0;
+}
+
 int CFontGen::SetUseSmoothing(bool set)
 {
 	if( isWorking ) return -1;
@@ -924,6 +1025,11 @@ int CFontGen::GetFontDescFormat() const
 	return fontDescFormat;
 }
 
+bool CFontGen::GetUseKerningClasses() const
+{
+	return useKerningClasses;
+}
+
 int CFontGen::GetOutBitDepth() const
 {
 	return outBitDepth;
@@ -1014,6 +1120,24 @@ bool CFontGen::GetForceZero() const
 	return forceZero;
 }
 
+bool CFontGen::GetFrequencyOrder() const
+{
+	return frequencyOrder;
+}
+
+unsigned int CFontGen::GetCharFrequency(int ch) const
+{
+	if( ch < 0 || ch >= (int)charFrequencies.size() )
+		return 0;
+
+	return charFrequencies[ch];
+}
+
+bool CFontGen::UseFrequencyOrder() const
+{
+	return frequencyOrder && !charFrequencies.empty();
+}
+
 bool CFontGen::IsUsingSmoothing() const
 {
 	return useSmoothing;
@@ -1071,6 +1195,10 @@ int CFontGen::GetCharSet() const
 
 cImage *CFontGen::GetPageImage(int page, int channel)
 {
+	// Pages that have been streamed to disk are no longer in memory
+	if( pages[page] == 0 )
+		return 0;
+
 	pages[page]->GeneratePreviewTexture(channel);
 	return pages[page]->GetPageImage();
 }
@@ -1080,6 +1208,34 @@ int CFontGen::GetNumPages()
 	return (int)pages.size();
 }
 
+// The stats are computed from the characters rather than the pages,
+// so they are also available for pages that have been streamed to disk
+int CFontGen::GetPageStats(vector<SPageStats> &stats) const
+{
+	if( !arePagesGenerated ) return -1;
+
+	int channels = (outBitDepth == 32 && fourChnlPacked) ? 4 : 1;
+
+	stats.assign(pages.size(), SPageStats());
+	for( size_t n = 0; n < stats.size(); n++ )
+		stats[n].totalArea = (long long)outWidth * outHeight * channels;
+
+	for( int n = 0; n <= maxUnicodeChar + 1; n++ )
+	{
+		const CFontChar *ch = n <= maxUnicodeChar ? chars[n] : (outputInvalidCharGlyph ? invalidCharGlyph : 0);
+		if( ch == 0 || ch->m_page < 0 || ch->m_page >= (int)stats.size() )
+			continue;
+
+		// Colored images take all the channels they are packed into
+		int used = 1;
+		if( channels == 4 )
+			used = CCharBitset::PopCount(ch->m_chnl & 0xF);
+		stats[ch->m_page].usedArea += (long long)ch->m_width * ch->m_height * used;
+	}
+
+	return 0;
+}
+
 string CFontGen::GetFontName() const
 {
 	return fontName;
@@ -1106,7 +1262,7 @@ void CFontGen::ResetFont()
 {
 	if( fontChanged )
 	{
-		memset(disabled, 0, sizeof(disabled));
+		disabled.ClearAll();
 		memset(noFit, 0, sizeof(noFit));
 
 		DetermineExistingChars();
@@ -1117,35 +1273,51 @@ void CFontGen::ResetFont()
 // Internal
 void CFontGen::DetermineExistingChars()
 {
+	acUtility::CProfilePhase phase(profiler, "font scan");
+
 	HDC dc = GetDC(0);
 
 	HFONT font = CreateFont(10);
 	HFONT oldFont = (HFONT)SelectObject(dc, font);
 
-	// TODO: This is taking too long. If it is not possible to optimize significantly, then it is necessary
-	//       to add a status bar for the user to see the progress while scanning the font for glyphs
-	EnumTrueTypeCMAP(dc, unicodeToGlyph);
-	if (unicodeToGlyph.empty())
+	OpenSelectedFont(dc, fontFile, fontName, isBold, isItalic, openTypeFont);
+
+	EnumTrueTypeCMAP(openTypeFont, unicodeToGlyph);
+	if (unicodeToGlyph.IsEmpty())
 		EnumUnicodeGlyphs(dc, unicodeToGlyph);
+	unicodeToGlyph.Finalize();
 
 	if( fGetGlyphIndicesA )
 	{
 		numCharsAvailable = 0;
 		numCharsSelected = 0;
 
+		ClearSubsets();
+
 		if( useUnicode )
 		{
-			ClearSubsets();
-			memset(disabled, 1, (maxUnicodeChar+1)*sizeof(bool));
+			// Mark the existing characters in a single pass over the character map,
+			// rather than looking up each possible code point individually
+			CCharBitset available(maxUnicodeChar+1);
+			if( disableBoxChars )
+			{
+				for( int ch = unicodeToGlyph.FindNext(0); ch >= 0; ch = unicodeToGlyph.FindNext(ch+1) )
+					available.Set(ch);
+			}
+			else
+				available.SetAll();
 
-			// GetGlyphIndices doesn't support surrogate pairs
-			// neither does ScriptGetCMap, so we'll have to go the
-			// long route and use ScriptItemize and ScriptShape
-			SCRIPT_CACHE sc = 0;
+			// Unicode subsets that have no defined characters are all disabled
+			CCharBitset defined(maxUnicodeChar+1);
+			for( int subset = 0; subset < numUnicodeSubsets; subset++ )
+			{
+				if( UnicodeSubsets[subset].name[0] != '(' )
+					defined.SetRange(UnicodeSubsets[subset].beginChar, UnicodeSubsets[subset].endChar);
+			}
+			available.And(defined);
 
 			for( int subset = 0; subset < numUnicodeSubsets; subset++ )
 			{
-				// Unicode subsets that have no defined characters are all disabled
 				if( UnicodeSubsets[subset].name[0] == '(' )
 					continue;
 
@@ -1156,31 +1328,22 @@ void CFontGen::DetermineExistingChars()
 					if( end > UnicodeSubsets[subset].endChar )
 						end = UnicodeSubsets[subset].endChar;
 
-					// Create a subset with at most 256 characters
-					SSubset *set = new SSubset;
-					set->name      = UnicodeSubsets[subset].name;
-					set->charBegin = begin;
-					set->charEnd   = end;
-					subsets.push_back(set);
-
-					// Determine the available characters in this set
-					for( unsigned int n = begin; n <= end; n++ )
+					// Only ranges that hold any of the font's glyphs are shown
+					unsigned int count = available.Count(begin, end);
+					if( count )
 					{
-						bool exists = DoesUnicodeCharExist(n);
-
-						if( !disableBoxChars || exists )
-						{
-							disabled[n] = false;
-
-							// Mark the subset as available
-							set->available = true;
-
-							// Count the number of available characters
-							// and update the number of selected ones
-							numCharsAvailable++;
-							if( selected[n] ) 
-								numCharsSelected++;
-						}
+						// Create a subset with at most 256 characters
+						SSubset *set = new SSubset;
+						set->name      = UnicodeSubsets[subset].name;
+						set->charBegin = begin;
+						set->charEnd   = end;
+						set->available = true;
+						subsets.push_back(set);
+
+						// Count the number of available characters
+						// and update the number of selected ones
+						numCharsAvailable += count;
+						numCharsSelected  += selected.CountAnd(available, begin, end);
 					}
 
 					// Next 256 characters in the subset
@@ -1188,9 +1351,9 @@ void CFontGen::DetermineExistingChars()
 				}
 			}
 
-			// Clean up the cache created by Uniscribe
-			if( sc != 0 )
-				ScriptFreeCache(&sc);
+			// Everything that isn't available is disabled
+			disabled = available;
+			disabled.Invert();
 		}
 		else
 		{
@@ -1201,7 +1364,7 @@ void CFontGen::DetermineExistingChars()
 			set->charEnd   = 255;
 			subsets.push_back(set);
 
-			memset(disabled, 0, 256*sizeof(bool));
+			disabled.ClearAll();
 
 			for( int n = 0; n < 256; n++ )
 			{
@@ -1213,7 +1376,7 @@ void CFontGen::DetermineExistingChars()
 				int r = fGetGlyphIndicesA(dc, buf, 1, &idx, GGI_MARK_NONEXISTING_GLYPHS);
 
 				if( disableBoxChars && (r == GDI_ERROR || idx == 0xFFFF) )
-					disabled[n] = true;
+					disabled.Set(n);
 				else
 				{
 					numCharsAvailable++;
@@ -1232,20 +1395,24 @@ void CFontGen::DetermineExistingChars()
 
 bool CFontGen::DoesUnicodeCharExist(unsigned int ch) const
 {
-	if (unicodeToGlyph.find(ch) != unicodeToGlyph.end())
-		return true;
-
-	return false;
+	return unicodeToGlyph.Exists(ch);
 }
 
 // Returns 0 (the default glyph) if the character isn't found
 int CFontGen::GetUnicodeGlyph(unsigned int ch) const
 {
-	auto it = unicodeToGlyph.find(ch);
-	if (it == unicodeToGlyph.end())
-		return 0;
+	return unicodeToGlyph.GetGlyph(ch);
+}
+
+// The map is built when the font is loaded and only read afterwards
+const CGlyphMap &CFontGen::GetGlyphMap() const
+{
+	return unicodeToGlyph;
+}
 
-	return it->second;
+const COpenTypeFont &CFontGen::GetOpenTypeFont() const
+{
+	return openTypeFont;
 }
 
 // Returns 0 (the default glyph) if the character isn't found
@@ -1282,6 +1449,16 @@ void CFontGen::ClearPages()
 
 	pages.clear();
 
+	// The streamed pages that SaveFont hasn't committed are only temporary files
+	string tempSuffix = acUtility::GetTempOutputName("");
+	for( size_t n = 0; n < streamedPages.size(); n++ )
+	{
+		const string &file = streamedPages[n];
+		if( file.length() >= tempSuffix.length() && file.compare(file.length() - tempSuffix.length(), tempSuffix.length(), tempSuffix) == 0 )
+			remove(file.c_str());
+	}
+	streamedPages.clear();
+
 	for( int n = 0; n < maxUnicodeChar+1; n++ )
 	{
 		if( chars[n] ) delete chars[n];
@@ -1317,6 +1494,8 @@ int CFontGen::CreatePage()
 		return -1;
 	}
 
+	profiler.AddCount("pages", 1);
+
 	page->SetPadding(paddingLeft, paddingUp, paddingRight, paddingDown);
 	page->SetIntendedFormat(outBitDepth, fourChnlPacked, alphaChnl, redChnl, greenChnl, blueChnl);
 	pages.push_back(page);
@@ -1327,6 +1506,8 @@ int CFontGen::CreatePage()
 // Internal
 void CFontGen::InternalGeneratePages()
 {
+	acUtility::CProfilePhase phase(profiler, "generate pages");
+
 	if( arePagesGenerated )
 	{
 		status    = 0;
@@ -1345,6 +1526,9 @@ void CFontGen::InternalGeneratePages()
 	bool didNotFit = false;
 	memset(noFit, 0, sizeof(noFit));
 
+	charMemory    = 0;
+	compressChars = false;
+
 	if( stopWorking )
 	{
 		status    = 0;
@@ -1371,6 +1555,7 @@ void CFontGen::InternalGeneratePages()
 		int ch = iconImages[n]->id;
 		chars[ch] = new CFontChar();
 		chars[ch]->CreateFromImage(n, iconImages[n]->image, iconImages[n]->xoffset, iconImages[n]->yoffset, iconImages[n]->advance);
+		profiler.AddCount("icons", 1);
 
 #ifdef TRACE_GENERATE
 //		trace << "Character [" << ch << "] created from image" << endl;
@@ -1396,6 +1581,9 @@ void CFontGen::InternalGeneratePages()
 			}
 		}
 
+		if( chars[ch] )
+			KeepWithinMemoryBudget(chars[ch]);
+
 		if( stopWorking )
 		{
 			status    = 0;
@@ -1409,6 +1597,13 @@ void CFontGen::InternalGeneratePages()
 		}
 	}
 
+	// When streaming, the page is complete once the next page is started
+	// so it can be saved and released right away. The C++ header and the
+	// KTX2 texture array hold all pages, so then they must be kept until the end.
+	// The characters are only measured here then, and their images are drawn 
+	// again when the page they were placed on is saved.
+	bool streamPages = streamedOutput != "" && fontDescFormat != 4 && textureFormat != "ktx2";
+
 	// Draw each of the chars into individual images
 	HFONT font = CreateFont(0);
 	for( int n = 0; n < maxChars; n++ )
@@ -1422,7 +1617,18 @@ void CFontGen::InternalGeneratePages()
 			{
 				chars[n] = new CFontChar();
 
+				acUtility::CProfilePhase drawPhase(profiler, "rasterization", "char", n);
 				int r = chars[n]->DrawChar(font, n, this);
+				if( r < 0 && CompressCharImages() > 0 )
+				{
+					// Try again now that the images drawn so far take less memory,
+					// and keep compressing the images from now on
+					compressChars = true;
+					delete chars[n];
+					chars[n] = new CFontChar();
+					r = chars[n]->DrawChar(font, n, this);
+				}
+				drawPhase.End();
 				if( r < 0 )
 				{
 					// The character couldn't be drawn (probably due to out of memory)
@@ -1436,8 +1642,13 @@ void CFontGen::InternalGeneratePages()
 					trace.flush();
 #endif
 				}
+				if( chars[n] )
+					profiler.AddCount("glyphs", 1);
 				if( outlineThickness && chars[n] )
+				{
+					acUtility::CProfilePhase outlinePhase(profiler, "outline", "char", n);
 					chars[n]->AddOutline(outlineThickness);
+				}
 
 #ifdef TRACE_GENERATE
 //		trace << "Character [" << n << "] was drawn" << endl;
@@ -1462,6 +1673,11 @@ void CFontGen::InternalGeneratePages()
 #endif
 					}
 				}
+
+				if( chars[n] && streamPages )
+					chars[n]->ReleasePixels();
+				else if( chars[n] )
+					KeepWithinMemoryBudget(chars[n]);
 			}
 			counter++;
 
@@ -1533,6 +1749,11 @@ void CFontGen::InternalGeneratePages()
 			trace.flush();
 #endif
 		}
+
+		if( invalidCharGlyph && streamPages )
+			invalidCharGlyph->ReleasePixels();
+		else if( invalidCharGlyph )
+			KeepWithinMemoryBudget(invalidCharGlyph);
 	}
 
 	DeleteObject(font);
@@ -1592,6 +1813,21 @@ void CFontGen::InternalGeneratePages()
 
 		pages[page]->AddChars(ch, numChars);
 
+		if( streamPages && SaveStreamedPage(page) < 0 )
+		{
+			ClearPages();
+
+			status    = 0;
+			isWorking = false;
+
+#ifdef TRACE_GENERATE
+			trace << "Failed to save page " << page << endl;
+			trace.close();
+#endif
+
+			return;
+		}
+
 #ifdef TRACE_GENERATE
 		trace << "Compacting list of remaining characters" << endl;
 		trace.flush();
@@ -1638,9 +1874,9 @@ int CFontGen::GeneratePages(bool async)
 
 	// Make a final validation of configuration
 	{
-		// DDS with compression only support 32bit textures
-		if( textureFormat == "dds" &&
-			textureCompression > 0 &&
+		// DDS with DXT compression only support 32bit textures
+		if( (textureFormat == "dds" || textureFormat == "ktx2") &&
+			textureCompression >= 1 && textureCompression <= 3 &&
 			outBitDepth == 8 )
 		{
 			// Change the format to 32bit with all color channels set to 1
@@ -1649,6 +1885,18 @@ int CFontGen::GeneratePages(bool async)
 			SetGreenChnl(e_one);
 			SetBlueChnl(e_one);
 		}
+
+		// BC5 stores the red and green channels of 32bit textures
+		if( (textureFormat == "dds" || textureFormat == "ktx2") &&
+			textureCompression == 5 &&
+			outBitDepth == 8 )
+		{
+			// Change the format to 32bit with the glyph and outline in red and green
+			SetOutBitDepth(32);
+			SetRedChnl(e_glyph);
+			SetGreenChnl(e_outline);
+			SetBlueChnl(e_zero);
+		}
 	}
 
 	// Set status refresh timer
@@ -1668,102 +1916,480 @@ int CFontGen::GeneratePages(bool async)
 	return 0;
 }
 
-int CFontGen::SaveFont(const char *szFile)
+static bool CompareKerningPairs(const SKerningPair &a, const SKerningPair &b)
 {
-	if( isWorking ) return -1;
+	return a.first < b.first || (a.first == b.first && a.second < b.second);
+}
 
-	// The pages must be generated first
-	if( !arePagesGenerated ) return -1;
+static bool IsSameKerningPair(const SKerningPair &a, const SKerningPair &b)
+{
+	return a.first == b.first && a.second == b.second;
+}
 
-	// Create a memory dc
-	HDC dc = CreateCompatibleDC(0);
+// Internal
+void CFontGen::GetKerningPairs(HDC dc, vector<SKerningPair> &pairs)
+{
+	const unsigned int maxChars = useUnicode ? maxUnicodeChar+1 : 256;
 
-	HFONT font = CreateFont(0);
-	HFONT oldFont = (HFONT)SelectObject(dc, font);
+	// The pairs only have to be extracted again if the font or the selected characters have changed
+	string font = acStringFormat("%d|%d|%d|%d|%d|%d|", fontSize, aa, isBold, isItalic, charSet, useUnicode) + fontName + "|" + fontFile;
+	if( font != kerningFont || selected != kerningChars )
+	{
+		kerningPairs.clear();
 
-	// Determine the size needed for the char
-	int height, base;
+		vector<KERNINGPAIR> gdiPairs;
+		if( useUnicode )
+		{
+			// TODO: How do I obtain the kerning pairs for 
+			// the characters in the higher planes?
 
-	TEXTMETRIC tm;
-	GetTextMetrics(dc, &tm);
+			int num = GetKerningPairsW(dc, 0, 0);
+			if( num > 0 )
+			{
+				gdiPairs.resize(num);
+				GetKerningPairsW(dc, num, &gdiPairs[0]);
+			}
+		}
+		else
+		{
+			int num = GetKerningPairsA(dc, 0, 0);
+			if( num > 0 )
+			{
+				gdiPairs.resize(num);
+				GetKerningPairsA(dc, num, &gdiPairs[0]);
+			}
+		}
 
-	// Round up to make sure fractional pixels are covered
-	height = (int)ceil(float(tm.tmHeight)/aa);
-	base = (int)ceil(float(tm.tmAscent)/aa);
+		kerningPairs.resize(gdiPairs.size());
+		for( size_t n = 0; n < gdiPairs.size(); n++ )
+		{
+			kerningPairs[n].first  = gdiPairs[n].wFirst;
+			kerningPairs[n].second = gdiPairs[n].wSecond;
+			kerningPairs[n].amount = gdiPairs[n].iKernAmount;
+		}
 
-	// Save the character attributes
-	FILE *f;
+		if( kerningPairs.size() == 0 )
+		{
+			// Make sure the tables are read from the font that is used
+			OpenSelectedFont(dc, fontFile, fontName, isBold, isItalic, openTypeFont);
 
-	string filename = szFile;
-	if( _stricmp(filename.substr(filename.length() - 4).c_str(), ".fnt") == 0 )
-		filename = filename.substr(0, filename.length() - 4);
+			// Build a list of all selected chars
+			vector<UINT> chars;
+			chars.reserve(GetNumCharsSelected());
+			for( int n = selected.FindNext(0); n >= 0; n = selected.FindNext(n+1) )
+				chars.push_back(n);
+
+			// Both the GPOS and the kern table are read. The kern pairs are added
+			// after the GPOS pairs, so the stable sort and the removal of the 
+			// duplicates below keep the GPOS adjustment when both have the pair
+			GetKerningPairsFromGPOS(dc, kerningPairs, chars, this);
+			GetKerningPairsFromKERN(dc, kerningPairs, chars, this);
+		}
 
-	errno_t e = fopen_s(&f, (filename + ".fnt").c_str(), "wb");
-	if( e != 0 || f == 0 )
-		return -1;
+		kerningFont  = font;
+		kerningChars = selected;
+	}
 
-	// Get the filename without path
-	size_t r = filename.rfind('\\');
-	string filenameonly;
-	if( r != -1 )
-		filenameonly = filename.substr(r+1);
-	else
-		filenameonly = filename;
-		
-	if( outBitDepth != 32 ) fourChnlPacked = false;
-	size_t numPages = pages.size();
+	// Filter the pairs for the characters that will be exported in a single pass.
+	// It's been reported that for Chinese WinXP the kerning pairs for 
+	// non-unicode charsets may contain characters > 255, so we need to 
+	// filter for this.
+	pairs.clear();
+	pairs.reserve(kerningPairs.size());
+	for( size_t n = 0; n < kerningPairs.size(); n++ )
+	{
+		const SKerningPair &pair = kerningPairs[n];
+		if( pair.amount/aa == 0 ||                 // Filter kerning pairs where the adjustment is too small
+			pair.first >= maxChars ||              // Filter kerning pairs if they are outside the valid range
+			pair.second >= maxChars ||
+			disabled[pair.first] ||                // Filter kerning pairs for characters that won't be exported
+			disabled[pair.second] ||
+			!selected[pair.first] ||               // Filter kerning pairs for characters that won't be exported
+			!selected[pair.second] ||
+			chars[pair.first] == 0 ||              // Filter kerning pairs for characters that won't be exported
+			chars[pair.second] == 0 ||
+			!chars[pair.first]->m_isChar ||        // Filter kerning pairs for imported images
+			!chars[pair.second]->m_isChar )
+			continue;
+
+		pairs.push_back(pair);
+	}
 
-	// Determine the number of digits needed for the page file id
-	int numDigits = numPages > 1 ? int(log10(float(numPages-1))+1) : 1;
+	// Sort the pairs so the output doesn't depend on the order they were found in.
+	// The list of kerning pairs returned by GetKerningPairs sometimes also 
+	// have duplicates, so that needs to be filtered too. It seems to be a bug 
+	// when calling GetKerningPairsA but not for W.
+	// TODO: Sometimes the adjustment is not equal for the duplicates, which should be used then?
+	stable_sort(pairs.begin(), pairs.end(), CompareKerningPairs);
+	pairs.erase(unique(pairs.begin(), pairs.end(), IsSameKerningPair), pairs.end());
+}
 
-	int lineHeight = int(ceilf(height*float(scaleH) / 100.0f));
+// Internal
+// Factors the kerning pairs into classes of characters with identical kerning.
+// The pairs must be sorted and filtered as done by GetKerningPairs. Returns
+// false if the classes wouldn't be more compact than the list of pairs.
+bool CFontGen::GetKerningClasses(const vector<SKerningPair> &pairs, SKerningClasses &classes) const
+{
+	typedef vector<std::pair<unsigned int, int> > TKerningRow;
 
+	classes = SKerningClasses();
 
-	if( fontDescFormat == 1 ) 
+	// The pairs are sorted on the first character, so each row is 
+	// a contiguous range. Characters with identical rows share a class.
+	map<TKerningRow, unsigned int> rowClasses;
+	vector<unsigned int> pairFirstClass(pairs.size());
+	for( size_t start = 0, end; start < pairs.size(); start = end )
 	{
-		fprintf(f, "<?xml version=\"1.0\"?>\r\n");
-		fprintf(f, "<font>\r\n");
-		fprintf(f, "  <info face=\"%s\" size=\"%d\" bold=\"%d\" italic=\"%d\" charset=\"%s\" unicode=\"%d\" stretchH=\"%d\" smooth=\"%d\" aa=\"%d\" padding=\"%d,%d,%d,%d\" spacing=\"%d,%d\" outline=\"%d\"/>\r\n", fontName.c_str(), fontSize, isBold, isItalic, useUnicode ? "" : GetCharSetName(charSet).c_str(), useUnicode, scaleH, useSmoothing, aa, paddingUp, paddingRight, paddingDown, paddingLeft, spacingHoriz, spacingVert, outlineThickness);
-		fprintf(f, "  <common lineHeight=\"%d\" base=\"%d\" scaleW=\"%d\" scaleH=\"%d\" pages=\"%d\" packed=\"%d\" alphaChnl=\"%d\" redChnl=\"%d\" greenChnl=\"%d\" blueChnl=\"%d\"/>\r\n", lineHeight, int(ceilf(base*float(scaleH)/100.0f)), outWidth, outHeight, int(numPages), fourChnlPacked, alphaChnl, redChnl, greenChnl, blueChnl);
+		TKerningRow row;
+		for( end = start; end < pairs.size() && pairs[end].first == pairs[start].first; end++ )
+			row.push_back(std::make_pair(pairs[end].second, pairs[end].amount/aa));
 
-		fprintf(f, "  <pages>\r\n");
-		for( size_t n = 0; n < numPages; n++ )
-			fprintf(f, "    <page id=\"%d\" file=\"%s_%0*d.%s\" />\r\n", (int)n, filenameonly.c_str(), numDigits, (int)n, textureFormat.c_str());
-		fprintf(f, "  </pages>\r\n");
+		unsigned int cls = (unsigned int)rowClasses.size();
+		cls = rowClasses.insert(std::make_pair(row, cls)).first->second;
+
+		classes.firstChars.push_back(pairs[start].first);
+		classes.firstClasses.push_back(cls);
+		for( size_t n = start; n < end; n++ )
+			pairFirstClass[n] = cls;
 	}
-	else if( fontDescFormat == 0 )
+
+	// Once the rows are classified the second characters with identical 
+	// columns can share a class too, and all amounts within a cell are equal
+	map<unsigned int, TKerningRow> columns;
+	for( size_t n = 0; n < pairs.size(); n++ )
+		columns[pairs[n].second].push_back(std::make_pair(pairFirstClass[n], pairs[n].amount/aa));
+
+	map<TKerningRow, unsigned int> columnClasses;
+	map<unsigned int, unsigned int> secondClassOf;
+	for( map<unsigned int, TKerningRow>::iterator it = columns.begin(); it != columns.end(); ++it )
 	{
-		fprintf(f, "info face=\"%s\" size=%d bold=%d italic=%d charset=\"%s\" stretchH=%d smooth=%d aa=%d padding=%d,%d,%d,%d spacing=%d,%d\r\n", fontName.c_str(), fontSize, isBold, isItalic, useUnicode ? "" : GetCharSetName(charSet).c_str(), scaleH, useSmoothing, aa, paddingUp, paddingRight, paddingDown, paddingLeft, spacingHoriz, spacingVert);
-		fprintf(f, "common lineHeight=%d base=%d scaleW=%d scaleH=%d pages=%d\r\n", lineHeight, int(ceilf(base*float(scaleH)/100.0f)), outWidth, outHeight, int(numPages));
+		TKerningRow &column = it->second;
+		sort(column.begin(), column.end());
+		column.erase(unique(column.begin(), column.end()), column.end());
 
-		//for( size_t n = 0; n < numPages; n++ )
-		//	fprintf(f, "page id=%d file=\"%s_%0*d.%s\"\r\n", (int)n, filenameonly.c_str(), numDigits, (int)n, textureFormat.c_str());
+		unsigned int cls = (unsigned int)columnClasses.size();
+		cls = columnClasses.insert(std::make_pair(column, cls)).first->second;
+
+		classes.secondChars.push_back(it->first);
+		classes.secondClasses.push_back(cls);
+		secondClassOf[it->first] = cls;
 	}
-	else
+
+	classes.numFirstClasses  = (unsigned int)rowClasses.size();
+	classes.numSecondClasses = (unsigned int)columnClasses.size();
+
+	// Compare the size of the binary blocks before building the matrix
+	unsigned long long pairSize  = (unsigned long long)pairs.size()*10;
+	unsigned long long classSize = 12 + 6*(unsigned long long)(classes.firstChars.size() + classes.secondChars.size()) +
+	                               2*(unsigned long long)classes.numFirstClasses*classes.numSecondClasses;
+	if( pairs.size() == 0 || classSize >= pairSize || 
+		classes.numFirstClasses > 0xFFFF || classes.numSecondClasses > 0xFFFF )
 	{
-		// Write the magic word and file version
-		fwrite("BMF", 3, 1, f);
-		fputc(3, f); 
+		classes = SKerningClasses();
+		return false;
+	}
 
-		// Write the info block
-#pragma pack(push)
-#pragma pack(1)
-		struct infoBlock
-		{
-			int            blockSize;
-			unsigned short fontSize;
-			char           reserved    :4;
-			char           bold        :1;
-			char           italic      :1;
-			char           unicode     :1;
-			char           smooth      :1;
-			unsigned char  charSet;
-			unsigned short stretchH;
-			char           aa;
-			unsigned char  paddingUp;
-			unsigned char  paddingRight;
-			unsigned char  paddingDown;
-			unsigned char  paddingLeft;
+	classes.amounts.assign(classes.numFirstClasses*classes.numSecondClasses, 0);
+	for( size_t n = 0; n < pairs.size(); n++ )
+		classes.amounts[pairFirstClass[n]*classes.numSecondClasses + secondClassOf[pairs[n].second]] = short(pairs[n].amount/aa);
+
+	return true;
+}
+
+// The runtime format takes the same values as the text and XML formats
+static SRuntimeFontGlyph MakeRuntimeGlyph(unsigned int id, int x, int y, int width, int height, int xoffset, int yoffset, int xadvance, int page, int chnl)
+{
+	SRuntimeFontGlyph g;
+	g.id       = id;
+	g.x        = (unsigned short)x;
+	g.y        = (unsigned short)y;
+	g.width    = (unsigned short)width;
+	g.height   = (unsigned short)height;
+	g.xoffset  = (short)xoffset;
+	g.yoffset  = (short)yoffset;
+	g.xadvance = (short)xadvance;
+	g.page     = (unsigned char)page;
+	g.chnl     = (unsigned char)chnl;
+	return g;
+}
+
+// Returns the file name without the .fnt extension, to which the
+// page number and texture extension are appended for the pages
+static string GetOutputBaseName(const char *szFile)
+{
+	string filename = szFile;
+	if( filename.length() >= 4 && _stricmp(filename.substr(filename.length() - 4).c_str(), ".fnt") == 0 )
+		filename = filename.substr(0, filename.length() - 4);
+	return filename;
+}
+
+int CFontGen::SetStreamedOutput(const char *szFile)
+{
+	if( isWorking ) return -1;
+
+	arePagesGenerated = false;
+
+	streamedOutput = szFile ? GetOutputBaseName(szFile) : "";
+
+	return 0;
+}
+
+bool CFontGen::GetProfiling() const
+{
+	return profiler.IsEnabled();
+}
+
+// The profiling doesn't change the output, so the pages are kept
+int CFontGen::SetProfiling(bool set)
+{
+	if( isWorking ) return -1;
+
+	profiler.Enable(set);
+	return 0;
+}
+
+acUtility::CProfiler &CFontGen::GetProfiler()
+{
+	return profiler;
+}
+
+int CFontGen::GetMemoryBudget() const
+{
+	return memoryBudget;
+}
+
+// The budget doesn't change the output, so the pages are kept
+int CFontGen::SetMemoryBudget(int budget)
+{
+	if( isWorking ) return -1;
+
+	if( budget < 0 ) budget = 0;
+	memoryBudget = budget;
+	return 0;
+}
+
+// Internal
+// Accounts for the memory of a newly drawn character. Once the budget has 
+// been exceeded all the images drawn so far are compressed, and so is every
+// image drawn after that.
+void CFontGen::KeepWithinMemoryBudget(CFontChar *ch)
+{
+	if( compressChars && ch->GetImageMemory() > 0 )
+	{
+		if( ch->CompressImage() >= 0 )
+			profiler.AddCount("compressed glyphs", 1);
+	}
+
+	charMemory += ch->GetImageMemory();
+
+	if( !compressChars && memoryBudget > 0 && charMemory > size_t(memoryBudget)*1024*1024 )
+	{
+		compressChars = true;
+		CompressCharImages();
+	}
+}
+
+// Internal
+// Compresses the images of all the characters that have been drawn, 
+// and returns the number of images that were compressed
+int CFontGen::CompressCharImages()
+{
+	int count = 0;
+	for( int n = 0; n <= maxUnicodeChar; n++ )
+	{
+		if( chars[n] && !chars[n]->IsImageCompressed() && chars[n]->GetImageMemory() > 0 )
+		{
+			size_t before = chars[n]->GetImageMemory();
+			if( chars[n]->CompressImage() >= 0 )
+			{
+				charMemory -= before - chars[n]->GetImageMemory();
+				count++;
+			}
+		}
+	}
+
+	if( invalidCharGlyph && !invalidCharGlyph->IsImageCompressed() && invalidCharGlyph->GetImageMemory() > 0 )
+	{
+		size_t before = invalidCharGlyph->GetImageMemory();
+		if( invalidCharGlyph->CompressImage() >= 0 )
+		{
+			charMemory -= before - invalidCharGlyph->GetImageMemory();
+			count++;
+		}
+	}
+
+	if( count )
+		profiler.AddCount("compressed glyphs", count);
+
+	return count;
+}
+
+// Internal
+// Saves a completed page while streaming. The total number of pages isn't known 
+// yet, so the page is saved to a temporary file that SaveFont commits later.
+int CFontGen::SaveStreamedPage(int page)
+{
+	// The images of the characters on the page are drawn now that they are needed
+	acUtility::CProfilePhase drawPhase(profiler, "rasterization", "page", page);
+	HFONT font = CreateFont(0);
+	size_t drawn = 0;
+	int r = pages[page]->RedrawCharImages(font, drawn);
+	DeleteObject(font);
+	drawPhase.End();
+	charMemory += drawn;
+	if( r < 0 )
+	{
+		outOfMemory = true;
+		return -1;
+	}
+
+	string str = acUtility::GetTempOutputName(acStringFormat("%s_%d.%s", streamedOutput.c_str(), page, textureFormat.c_str()));
+	if( SavePage(page, str) < 0 )
+		return -1;
+
+	streamedPages.push_back(str);
+
+	// Only the character metrics are needed from now on
+	size_t freed = pages[page]->ReleaseCharImages();
+	charMemory = freed < charMemory ? charMemory - freed : 0;
+	delete pages[page];
+	pages[page] = 0;
+
+	return 0;
+}
+
+int CFontGen::SaveFont(const char *szFile)
+{
+	if( isWorking ) return -1;
+
+	// The pages must be generated first
+	if( !arePagesGenerated ) return -1;
+
+	acUtility::CProfilePhase phase(profiler, "save font");
+
+	// Create a memory dc
+	HDC dc = CreateCompatibleDC(0);
+
+	HFONT font = CreateFont(0);
+	HFONT oldFont = (HFONT)SelectObject(dc, font);
+
+	// Determine the size needed for the char
+	int height, base;
+
+	TEXTMETRIC tm;
+	GetTextMetrics(dc, &tm);
+
+	// Round up to make sure fractional pixels are covered
+	height = (int)ceil(float(tm.tmHeight)/aa);
+	base = (int)ceil(float(tm.tmAscent)/aa);
+
+	// Save the character attributes
+	FILE *f;
+
+	string filename = GetOutputBaseName(szFile);
+
+	changedFiles.clear();
+	unchangedFiles.clear();
+
+	// The descriptor is written to a temporary file first, so the 
+	// existing file is only replaced if the content has changed
+	string fntFile = filename + (fontDescFormat == 4 ? ".h" : ".fnt");
+	string fntTemp = acUtility::GetTempOutputName(fntFile);
+	acUtility::CProfilePhase descriptorPhase(profiler, "write descriptor");
+	errno_t e = fopen_s(&f, fntTemp.c_str(), "wb");
+	if( e != 0 || f == 0 )
+		return -1;
+
+	// Get the filename without path
+	size_t r = filename.rfind('\\');
+	string filenameonly;
+	if( r != -1 )
+		filenameonly = filename.substr(r+1);
+	else
+		filenameonly = filename;
+		
+	if( outBitDepth != 32 ) fourChnlPacked = false;
+	size_t numPages = pages.size();
+
+	// Determine the number of digits needed for the page file id
+	int numDigits = numPages > 1 ? int(log10(float(numPages-1))+1) : 1;
+
+	// The KTX2 texture holds all pages as the layers of one texture array,
+	// so the pages refer to the same file and the page id is the layer
+	vector<string> pageFiles(numPages);
+	for( size_t n = 0; n < numPages; n++ )
+	{
+		if( textureFormat == "ktx2" )
+			pageFiles[n] = acStringFormat("%s.%s", filenameonly.c_str(), textureFormat.c_str());
+		else
+			pageFiles[n] = acStringFormat("%s_%0*d.%s", filenameonly.c_str(), numDigits, (int)n, textureFormat.c_str());
+	}
+
+	int lineHeight = int(ceilf(height*float(scaleH) / 100.0f));
+
+	CRuntimeFontWriter runtime;
+	CFontHeaderWriter  header;
+
+	if( fontDescFormat == 1 ) 
+	{
+		fprintf(f, "<?xml version=\"1.0\"?>\r\n");
+		fprintf(f, "<font>\r\n");
+		fprintf(f, "  <info face=\"%s\" size=\"%d\" bold=\"%d\" italic=\"%d\" charset=\"%s\" unicode=\"%d\" stretchH=\"%d\" smooth=\"%d\" aa=\"%d\" padding=\"%d,%d,%d,%d\" spacing=\"%d,%d\" outline=\"%d\"/>\r\n", fontName.c_str(), fontSize, isBold, isItalic, useUnicode ? "" : GetCharSetName(charSet).c_str(), useUnicode, scaleH, useSmoothing, aa, paddingUp, paddingRight, paddingDown, paddingLeft, spacingHoriz, spacingVert, outlineThickness);
+		fprintf(f, "  <common lineHeight=\"%d\" base=\"%d\" scaleW=\"%d\" scaleH=\"%d\" pages=\"%d\" packed=\"%d\" alphaChnl=\"%d\" redChnl=\"%d\" greenChnl=\"%d\" blueChnl=\"%d\"/>\r\n", lineHeight, int(ceilf(base*float(scaleH)/100.0f)), outWidth, outHeight, int(numPages), fourChnlPacked, alphaChnl, redChnl, greenChnl, blueChnl);
+
+		fprintf(f, "  <pages>\r\n");
+		for( size_t n = 0; n < numPages; n++ )
+			fprintf(f, "    <page id=\"%d\" file=\"%s\" />\r\n", (int)n, pageFiles[n].c_str());
+		fprintf(f, "  </pages>\r\n");
+	}
+	else if( fontDescFormat == 0 )
+	{
+		fprintf(f, "info face=\"%s\" size=%d bold=%d italic=%d charset=\"%s\" stretchH=%d smooth=%d aa=%d padding=%d,%d,%d,%d spacing=%d,%d\r\n", fontName.c_str(), fontSize, isBold, isItalic, useUnicode ? "" : GetCharSetName(charSet).c_str(), scaleH, useSmoothing, aa, paddingUp, paddingRight, paddingDown, paddingLeft, spacingHoriz, spacingVert);
+		fprintf(f, "common lineHeight=%d base=%d scaleW=%d scaleH=%d pages=%d\r\n", lineHeight, int(ceilf(base*float(scaleH)/100.0f)), outWidth, outHeight, int(numPages));
+
+		//for( size_t n = 0; n < numPages; n++ )
+		//	fprintf(f, "page id=%d file=\"%s\"\r\n", (int)n, pageFiles[n].c_str());
+	}
+	else if( fontDescFormat == 3 )
+	{
+		// The runtime format is written at the end, once the glyphs and kerning pairs are known
+		runtime.SetFaceName(fontName);
+		runtime.SetCommon(fontSize, lineHeight, int(ceilf(base*float(scaleH)/100.0f)), outWidth, outHeight, fourChnlPacked, alphaChnl, redChnl, greenChnl, blueChnl);
+		for( size_t n = 0; n < numPages; n++ )
+			runtime.AddPage(pageFiles[n]);
+	}
+	else if( fontDescFormat == 4 )
+	{
+		// The header is written at the end too, with the pixels of the pages
+		header.SetName(filenameonly);
+		header.SetFaceName(fontName);
+		header.SetCommon(fontSize, lineHeight, int(ceilf(base*float(scaleH)/100.0f)), outWidth, outHeight, fourChnlPacked, alphaChnl, redChnl, greenChnl, blueChnl);
+	}
+	else
+	{
+		// Write the magic word and file version
+		fwrite("BMF", 3, 1, f);
+		fputc(3, f); 
+
+		// Write the info block
+#pragma pack(push)
+#pragma pack(1)
+		struct infoBlock
+		{
+			int            blockSize;
+			unsigned short fontSize;
+			char           reserved    :4;
+			char           bold        :1;
+			char           italic      :1;
+			char           unicode     :1;
+			char           smooth      :1;
+			unsigned char  charSet;
+			unsigned short stretchH;
+			char           aa;
+			unsigned char  paddingUp;
+			unsigned char  paddingRight;
+			unsigned char  paddingDown;
+			unsigned char  paddingLeft;
 			unsigned char  spacingHoriz;
 			unsigned char  spacingVert;
 			unsigned char  outline;
@@ -1831,18 +2457,40 @@ int CFontGen::SaveFont(const char *szFile)
 
 		// Write the page block
 		fputc(3, f);
-		int size = int((filenameonly.length() + numDigits + 2 + textureFormat.length() + 1)*numPages);
+		int size = 0;
+		for( size_t n = 0; n < numPages; n++ )
+			size += int(pageFiles[n].length() + 1);
 		fwrite(&size, sizeof(size), 1, f);
 
 		for( size_t n = 0; n < numPages; n++ )
-		{
-			fprintf(f, "%s_%0*d.%s", filenameonly.c_str(), numDigits, (int)n, textureFormat.c_str());
-			fputc(0, f);
-		}
+			fwrite(pageFiles[n].c_str(), pageFiles[n].length() + 1, 1, f);
 	}
 
 	const int maxChars = useUnicode ? maxUnicodeChar+1 : 256;
 
+	// The aliases are set before counting, so the size of the 
+	// binary char block includes them
+	//　日付用
+	if (chars[0x65E5]) { // 日
+		chars[14] = chars[0x65E5];
+	}
+	if (chars[0x5E74]) { //年 
+		chars[15] = chars[0x5E74];
+	}
+	if (chars[0x6708]) { // 月
+		chars[7] = chars[0x6708];
+	}
+
+	// issue-21: https://github.com/matanki-saito/BMFont/issues/21
+	if (isMap && useUnicode) {
+		if (chars[26397]) { // ✐ → 朝
+			chars[10000] = chars[26397];
+		}
+		if (chars[27663]) { // ✑ → 氏 
+			chars[10001] = chars[27663];
+		}
+	}
+
 	// Count the number of characters that will be written
 	int numChars = 0;
 	int n;
@@ -1872,6 +2520,10 @@ int CFontGen::SaveFont(const char *szFile)
 			fprintf(f, "    <char id=\"%d\" x=\"%d\" y=\"%d\" width=\"%d\" height=\"%d\" xoffset=\"%d\" yoffset=\"%d\" xadvance=\"%d\" page=\"%d\" chnl=\"%d\" />\r\n", -1, invalidCharGlyph->m_x, invalidCharGlyph->m_y, invalidCharGlyph->m_width, invalidCharGlyph->m_height, invalidCharGlyph->m_xoffset, invalidCharGlyph->m_yoffset, invalidCharGlyph->m_advance, invalidCharGlyph->m_page, invalidCharGlyph->m_chnl);
 		else if( fontDescFormat == 0 )
 			fprintf(f, "char id=%-4d x=%-5d y=%-5d width=%-5d height=%-5d xoffset=%-5d yoffset=%-5d xadvance=%-5d page=%-2d\r\n", -1, invalidCharGlyph->m_x, invalidCharGlyph->m_y, invalidCharGlyph->m_width, invalidCharGlyph->m_height, invalidCharGlyph->m_xoffset, invalidCharGlyph->m_yoffset, invalidCharGlyph->m_advance, invalidCharGlyph->m_page);
+		else if( fontDescFormat == 3 )
+			runtime.AddGlyph(MakeRuntimeGlyph(0xFFFFFFFF, invalidCharGlyph->m_x, invalidCharGlyph->m_y, invalidCharGlyph->m_width, invalidCharGlyph->m_height, invalidCharGlyph->m_xoffset, invalidCharGlyph->m_yoffset, invalidCharGlyph->m_advance, invalidCharGlyph->m_page, invalidCharGlyph->m_chnl));
+		else if( fontDescFormat == 4 )
+			header.AddGlyph(MakeRuntimeGlyph(0xFFFFFFFF, invalidCharGlyph->m_x, invalidCharGlyph->m_y, invalidCharGlyph->m_width, invalidCharGlyph->m_height, invalidCharGlyph->m_xoffset, invalidCharGlyph->m_yoffset, invalidCharGlyph->m_advance, invalidCharGlyph->m_page, invalidCharGlyph->m_chnl));
 		else
 		{
 #pragma pack(push)
@@ -1976,25 +2628,6 @@ int CFontGen::SaveFont(const char *szFile)
 
 	for( n = 0; n < maxChars; n++ )
 	{
-		//　日付用
-		if (n == 14 && chars[0x65E5]) { // 日
-			chars[n] = chars[0x65E5];
-		}else if (n == 15 && chars[0x5E74]) { //年 
-			chars[n] = chars[0x5E74];
-		}else if (n == 7 && chars[0x6708]) { // 月
-			chars[n] = chars[0x6708];
-		}
-
-		// issue-21: https://github.com/matanki-saito/BMFont/issues/21
-		if (isMap) {
-			if (n == 10000 && chars[26397]) { // ✐ → 朝
-				chars[n] = chars[26397];
-			}
-			else if (n == 10001 && chars[27663]) { // ✑ → 氏 
-				chars[n] = chars[27663];
-			}
-		}
-
         if( chars[n] )
 		{
 			int page, chnl;
@@ -2081,6 +2714,10 @@ int CFontGen::SaveFont(const char *szFile)
 					);
 			    }
 			}
+			else if( fontDescFormat == 3 )
+				runtime.AddGlyph(MakeRuntimeGlyph(n, x, y, width, height, xoff, yoff, xadv, page, chnl));
+			else if( fontDescFormat == 4 )
+				header.AddGlyph(MakeRuntimeGlyph(n, x, y, width, height, xoff, yoff, xadv, page, chnl));
 			else
 			{
 #pragma pack(push)
@@ -2122,110 +2759,78 @@ int CFontGen::SaveFont(const char *szFile)
 	if( !dontIncludeKerningPairs )
 	{
 		// Save the kerning pairs as well
-		vector<KERNINGPAIR> pairs;
-		if( useUnicode )
-		{
-			// TODO: How do I obtain the kerning pairs for 
-			// the characters in the higher planes?
-
-			int num = GetKerningPairsW(dc, 0, 0);
-			if( num > 0 )
-			{
-				pairs.resize(num);
-				GetKerningPairsW(dc, num, &pairs[0]);
-			}
-		}
-		else
-		{
-			int num = GetKerningPairsA(dc, 0, 0);
-			if( num > 0 )
-			{
-				pairs.resize(num);
-				GetKerningPairsA(dc, num, &pairs[0]);
-			}
-		}
-	/*
+		vector<SKerningPair> pairs;
+		acUtility::CProfilePhase kerningPhase(profiler, "kerning");
+		GetKerningPairs(dc, pairs);
+		kerningPhase.End();
+		profiler.AddCount("kerning pairs", pairs.size());
+
+		// The text format always lists the individual pairs
+		SKerningClasses classes;
+		if( useKerningClasses && (fontDescFormat == 1 || fontDescFormat == 2) && GetKerningClasses(pairs, classes) )
 		{
-			pairs.resize(0);
+			pairs.clear();
 
-			// Build a list of all selected chars
-			vector<UINT> chars;
-			chars.reserve(GetNumCharsSelected());
-			for( UINT n = 0; n <= maxUnicodeChar; n++ )
+			if( fontDescFormat == 1 )
 			{
-				if( selected[n] )
+				fprintf(f, "  <kerningclasses firstClasses=\"%d\" secondClasses=\"%d\">\r\n", classes.numFirstClasses, classes.numSecondClasses);
+				for( size_t n = 0; n < classes.firstChars.size(); n++ )
+					fprintf(f, "    <first id=\"%d\" class=\"%d\" />\r\n", classes.firstChars[n], classes.firstClasses[n]);
+				for( size_t n = 0; n < classes.secondChars.size(); n++ )
+					fprintf(f, "    <second id=\"%d\" class=\"%d\" />\r\n", classes.secondChars[n], classes.secondClasses[n]);
+				for( unsigned int r = 0; r < classes.numFirstClasses; r++ )
 				{
-					chars.push_back(n);
-					if( chars.size() == GetNumCharsSelected() )
-						break;
+					fprintf(f, "    <row class=\"%d\" amounts=\"", r);
+					for( unsigned int c = 0; c < classes.numSecondClasses; c++ )
+						fprintf(f, c ? " %d" : "%d", classes.amounts[r*classes.numSecondClasses + c]);
+					fprintf(f, "\" />\r\n");
 				}
+				fprintf(f, "  </kerningclasses>\r\n");
 			}
-
-			GetKerningPairsFromKERN(dc, pairs, chars, this);
-		}
-	*/
-		if( pairs.size() == 0 )
-		{
-			// Build a list of all selected chars
-			vector<UINT> chars;
-			chars.reserve(GetNumCharsSelected());
-			for( UINT n = 0; n <= maxUnicodeChar; n++ )
+			else if( fontDescFormat == 2 )
 			{
-				if( selected[n] )
+				fputc(6, f);
+
+				// Determine the size of the block
+				int size = 12 + 6*int(classes.firstChars.size() + classes.secondChars.size()) + 2*int(classes.amounts.size());
+				fwrite(&size, 4, 1, f);
+
+#pragma pack(push)
+#pragma pack(1)
+				struct kerningClassesBlock
 				{
-					chars.push_back(n);
-					if( chars.size() == GetNumCharsSelected() )
-						break;
-				}
-			}
+					WORD  numFirstClasses;
+					WORD  numSecondClasses;
+					DWORD numFirstChars;
+					DWORD numSecondChars;
+				} header;
 
-			GetKerningPairsFromGPOS(dc, pairs, chars, this);
-		}
+				struct kerningClassBlock
+				{
+					DWORD id;
+					WORD  cls;
+				} charClass;
+#pragma pack(pop)
+				header.numFirstClasses  = WORD(classes.numFirstClasses);
+				header.numSecondClasses = WORD(classes.numSecondClasses);
+				header.numFirstChars    = DWORD(classes.firstChars.size());
+				header.numSecondChars   = DWORD(classes.secondChars.size());
+				fwrite(&header, sizeof(header), 1, f);
 
-		if( pairs.size() > 0 )
-		{
-			// It's been reported that for Chinese WinXP the kerning pairs for 
-			// non-unicode charsets may contain characters > 255, so we need to 
-			// filter for this.
-			for( unsigned int n = 0; n < pairs.size(); n++ )
-			{
-				if( pairs[n].iKernAmount/aa == 0 ||       // Filter kerning pairs where the adjustment is too small
-					pairs[n].wFirst >= maxChars ||        // Filter kerning pairs if they are outside the valid range
-					pairs[n].wSecond >= maxChars ||
-					disabled[pairs[n].wFirst] ||          // Filter kerning pairs for characters that won't be exported
-					disabled[pairs[n].wSecond] ||
-					!selected[pairs[n].wFirst] ||         // Filter kerning pairs for characters that won't be exported
-					!selected[pairs[n].wSecond] ||
-					chars[pairs[n].wFirst] == 0 ||        // Filter kerning pairs for characters that won't be exported
-					chars[pairs[n].wSecond] == 0 ||
-					!chars[pairs[n].wFirst]->m_isChar ||  // Filter kerning pairs for imported images
-					!chars[pairs[n].wSecond]->m_isChar )
+				for( size_t n = 0; n < classes.firstChars.size(); n++ )
 				{
-					pairs[n] = pairs[pairs.size()-1];
-					pairs.pop_back();
-					n--;
+					charClass.id  = classes.firstChars[n];
+					charClass.cls = WORD(classes.firstClasses[n]);
+					fwrite(&charClass, sizeof(charClass), 1, f);
 				}
-			}
-
-			// The list of kerning pairs returned by GetKerningPairs sometimes also 
-			// have duplicates, so that needs to be filtered too. It seems to be a bug 
-			// when calling GetKerningPairsA but not for W.
-			// TODO: Sometimes the adjustment is not equal for the duplicates, which should be used then?
-			if( !useUnicode )
-			{
-				for( unsigned int n = 0; n < pairs.size(); n++ )
+				for( size_t n = 0; n < classes.secondChars.size(); n++ )
 				{
-					for( unsigned int m = n+1; m < pairs.size(); m++ )
-					{
-						if( pairs[n].wFirst  == pairs[m].wFirst  &&
-							pairs[n].wSecond == pairs[m].wSecond )
-						{
-							pairs[m] = pairs[pairs.size()-1];
-							pairs.pop_back();
-							m--;
-						}
-					}
+					charClass.id  = classes.secondChars[n];
+					charClass.cls = WORD(classes.secondClasses[n]);
+					fwrite(&charClass, sizeof(charClass), 1, f);
 				}
+
+				fwrite(&classes.amounts[0], sizeof(short), classes.amounts.size(), f);
 			}
 		}
 
@@ -2249,9 +2854,13 @@ int CFontGen::SaveFont(const char *szFile)
 		for( unsigned int n = 0; n < pairs.size(); n++ )
 		{
 			if( fontDescFormat == 1 )
-				fprintf(f, "    <kerning first=\"%d\" second=\"%d\" amount=\"%d\" />\r\n", pairs[n].wFirst, pairs[n].wSecond, pairs[n].iKernAmount/aa);
+				fprintf(f, "    <kerning first=\"%d\" second=\"%d\" amount=\"%d\" />\r\n", pairs[n].first, pairs[n].second, pairs[n].amount/aa);
 			else if( fontDescFormat == 0 )
-				fprintf(f, "kerning first=%-3d second=%-3d amount=%-4d\r\n", pairs[n].wFirst, pairs[n].wSecond, pairs[n].iKernAmount/aa);
+				fprintf(f, "kerning first=%-3d second=%-3d amount=%-4d\r\n", pairs[n].first, pairs[n].second, pairs[n].amount/aa);
+			else if( fontDescFormat == 3 )
+				runtime.AddKerning(pairs[n].first, pairs[n].second, short(pairs[n].amount/aa));
+			else if( fontDescFormat == 4 )
+				header.AddKerning(pairs[n].first, pairs[n].second, short(pairs[n].amount/aa));
 			else 
 			{
 #pragma pack(push)
@@ -2263,9 +2872,9 @@ int CFontGen::SaveFont(const char *szFile)
 					short amount;
 				} kerning;
 #pragma pack(pop)
-				kerning.first = pairs[n].wFirst;
-				kerning.second = pairs[n].wSecond;
-				kerning.amount = pairs[n].iKernAmount/aa;
+				kerning.first = pairs[n].first;
+				kerning.second = pairs[n].second;
+				kerning.amount = pairs[n].amount/aa;
 
 				fwrite(&kerning, sizeof(kerning), 1, f);
 			}
@@ -2277,76 +2886,391 @@ int CFontGen::SaveFont(const char *szFile)
 
 	if( fontDescFormat == 1 ) fprintf(f, "</font>\r\n");
 
+	// The pages are generated again for the header, one at a time to keep the memory down
+	int writeResult = 0;
+	if( fontDescFormat == 3 )
+		writeResult = runtime.Write(f);
+	else if( fontDescFormat == 4 )
+	{
+		writeResult = header.WriteMetrics(f, int(numPages));
+		for( size_t p = 0; p < numPages && writeResult >= 0; p++ )
+		{
+			acImage::Image image;
+			writeResult = GeneratePageImage(int(p), image, acImage::PF_A8B8G8R8);
+			if( writeResult >= 0 )
+				writeResult = header.WritePage(f, int(p), image);
+		}
+		if( writeResult >= 0 )
+			writeResult = header.WriteEnd(f);
+	}
+
+	if( writeResult < 0 )
+	{
+		fclose(f);
+		remove(fntTemp.c_str());
+		SelectObject(dc, oldFont);
+		DeleteObject(font);
+		DeleteDC(dc);
+		return -1;
+	}
+
+	profiler.AddCount("bytes written", ftell(f));
 	fclose(f);
+	descriptorPhase.End();
 
 	SelectObject(dc, oldFont);
 	DeleteObject(font);
 
 	DeleteDC(dc);
 
-	// Save the image file
+	// All the texture files are encoded to temporary files first, and nothing
+	// is committed unless all of them succeeded. The descriptor is committed 
+	// last, so it never refers to pages that couldn't be written.
 	int pageSize = (signed)pages.size();
-	for( n = 0; n < pageSize; n++ )
+	bool isStreamed = streamedPages.size() == pages.size() && pageSize > 0;
+	vector<string> files, temps;
+	int result = 0;
+	if( fontDescFormat == 4 )
 	{
-		string str = acStringFormat("%s_%0*d.%s", filename.c_str(), numDigits, n, textureFormat.c_str());
-		if (pageSize == 1) {
-			str = acStringFormat("%s.%s", filename.c_str(),textureFormat.c_str());
-		}
-
-
-		acImage::Image image;
-		image.width = outWidth;
-		image.height = outHeight;
-		if( outBitDepth == 32 )
+		// The pixels of the pages are in the header, so there are no texture files
+	}
+	else if( textureFormat == "ktx2" )
+	{
+		files.push_back(acStringFormat("%s.%s", filename.c_str(), textureFormat.c_str()));
+		temps.push_back(acUtility::GetTempOutputName(files[0]));
+		result = SaveTextureArray(temps[0]);
+	}
+	else
+	{
+		files.resize(pageSize);
+		for( n = 0; n < pageSize; n++ )
 		{
-			image.pitch = image.width*4;
-			image.format = acImage::PF_A8R8G8B8;
+			files[n] = acStringFormat("%s_%0*d.%s", filename.c_str(), numDigits, n, textureFormat.c_str());
+			if( pageSize == 1 )
+				files[n] = acStringFormat("%s.%s", filename.c_str(), textureFormat.c_str());
 		}
+
+		// The pages that were streamed during the generation have already been
+		// encoded to temporary files, and only need to be committed
+		if( isStreamed )
+			temps = streamedPages;
 		else
 		{
-			image.pitch = image.width;
-			image.format = acImage::PF_A8;
+			// Save the image files. The pages are independent of each other so they
+			// are composited, converted and encoded concurrently. Each page in flight
+			// holds the converted image and the encoder's buffers, so the number of 
+			// pages processed at the same time is limited to keep the memory in check.
+			// When a memory budget is set, the pages get what the characters don't use.
+			size_t pageBudget = 512*1024*1024;
+			if( memoryBudget > 0 )
+			{
+				size_t budget = size_t(memoryBudget)*1024*1024;
+				pageBudget = budget > charMemory ? budget - charMemory : 0;
+			}
+			size_t pageMemory = size_t(outWidth)*outHeight*4*3;
+			unsigned int maxInFlight = pageMemory ? unsigned(pageBudget/pageMemory) : 1;
+			if( maxInFlight < 1 ) maxInFlight = 1;
+
+			vector<int> results(pageSize, 0);
+			temps.resize(pageSize);
+			acUtility::ParallelFor(pageSize, [&](unsigned int page)
+			{
+				temps[page] = acUtility::GetTempOutputName(files[page]);
+				results[page] = SavePage(page, temps[page]);
+			}, maxInFlight);
+
+			for( n = 0; n < pageSize; n++ )
+				if( results[n] < 0 )
+					result = -1;
 		}
+	}
 
-		image.data = new BYTE[image.pitch * image.height];
+	if( result < 0 )
+	{
+		// The streamed pages are kept, as they can't be encoded again
+		for( size_t t = 0; t < temps.size() && !isStreamed; t++ )
+			remove(temps[t].c_str());
+		remove(fntTemp.c_str());
+		return -1;
+	}
 
-		// Generate the output texture for saving
-		pages[n]->GenerateOutputTexture();
+	acUtility::CProfilePhase commitPhase(profiler, "commit");
+	vector<int> commits(files.size(), 0);
+	for( size_t t = 0; t < files.size(); t++ )
+	{
+		// A streamed page is already in place if the font was saved before
+		acUtility::CProfilePhase pageCommitPhase(profiler, "commit", "page", (int)t);
+		commits[t] = temps[t] == files[t] ? 0 : acUtility::CommitFile(temps[t], files[t]);
+		if( commits[t] < 0 )
+			result = -1;
+		else if( isStreamed )
+			streamedPages[t] = files[t];
+	}
 
-		cImage *page = pages[n]->GetPageImage();
-		if( outBitDepth == 8 )
-		{
-			// Write image data
-			for( int y = 0; y < outHeight; y++ )
-			{
-				for( int x = 0; x < outWidth; x++ )
-				{
-					DWORD pixel = page->pixels[y*outWidth + x];
-					image.data[y*image.pitch + x] = (BYTE)(pixel>>24);
-				}
-			}
-		}
-		else
+	if( result < 0 )
+		remove(fntTemp.c_str());
+	else
+		result = acUtility::CommitFile(fntTemp, fntFile);
+	commitPhase.End();
+
+	// The descriptor is listed first and then the textures in order
+	if( RecordOutput(fntFile, result) < 0 )
+		result = -1;
+	for( size_t t = 0; t < files.size(); t++ )
+		RecordOutput(files[t], commits[t]);
+
+	return result < 0 ? -1 : 0;
+}
+
+// Internal
+// Keeps track of which output files were changed for the caller to report.
+// Returns the result so it can be checked for errors.
+int CFontGen::RecordOutput(const string &filename, int result)
+{
+	if( result > 0 )
+		changedFiles.push_back(filename);
+	else if( result == 0 )
+		unchangedFiles.push_back(filename);
+
+	return result;
+}
+
+int CFontGen::GetBuildKey(const char *szFile, string &key)
+{
+	if( isWorking ) return -1;
+
+	string filename = GetOutputBaseName(szFile);
+
+	unsigned long long hash = acUtility::HashData(BMFONT_VERSION, sizeof(BMFONT_VERSION));
+
+	// The page file names are written in the font descriptor
+	size_t r = filename.find_last_of("\\/");
+	string filenameonly = r != string::npos ? filename.substr(r+1) : filename;
+	hash = acUtility::HashData(filenameonly.c_str(), filenameonly.length()+1, hash);
+
+	// Only the settings that affect the generated files are hashed, so e.g. 
+	// profiling or a different memory budget still give the same key
+	auto hashInt = [&hash](int value) { hash = acUtility::HashData(&value, sizeof(value), hash); };
+	hash = acUtility::HashData(fontName.c_str(), fontName.length()+1, hash);
+	hashInt(charSet);
+	hashInt(fontSize);
+	hashInt(aa);
+	hashInt(scaleH);
+	hashInt(useSmoothing);
+	hashInt(isBold);
+	hashInt(isItalic);
+	hashInt(useUnicode);
+	hashInt(disableBoxChars);
+	hashInt(outputInvalidCharGlyph);
+	hashInt(dontIncludeKerningPairs);
+	hashInt(useHinting);
+	hashInt(renderFromOutline);
+	hashInt(useClearType);
+
+	hashInt(paddingDown);
+	hashInt(paddingUp);
+	hashInt(paddingRight);
+	hashInt(paddingLeft);
+	hashInt(spacingHoriz);
+	hashInt(spacingVert);
+	hashInt(fixedHeight);
+	hashInt(forceZero);
+	hashInt(frequencyOrder);
+
+	hashInt(outWidth);
+	hashInt(outHeight);
+	hashInt(outBitDepth);
+	hashInt(fontDescFormat);
+	hashInt(useKerningClasses);
+	hashInt(fourChnlPacked);
+	hash = acUtility::HashData(textureFormat.c_str(), textureFormat.length()+1, hash);
+	hashInt(textureCompression);
+	hashInt(dxtFit);
+	hashInt(pngLevel);
+	hashInt(pngFilter);
+	hashInt(pngParallel);
+	hashInt(ktxZlib);
+	hashInt(alphaChnl);
+	hashInt(redChnl);
+	hashInt(greenChnl);
+	hashInt(blueChnl);
+	hashInt(invA);
+	hashInt(invR);
+	hashInt(invG);
+	hashInt(invB);
+
+	hashInt(outlineThickness);
+
+	int maxChars = useUnicode ? maxUnicodeChar+1 : 256;
+	for( int n = selected.FindNext(0); n >= 0 && n < maxChars; n = selected.FindNext(n+1) )
+	{
+		if( !disabled[n] )
+			hashInt(n);
+	}
+
+	// The counted frequencies decide the order of the characters on the pages
+	if( UseFrequencyOrder() )
+		hash = acUtility::HashData(&charFrequencies[0], charFrequencies.size()*sizeof(charFrequencies[0]), hash);
+
+	// The font is identified by its content rather than its name or file, 
+	// so an updated font with the same name gives a different key. The data
+	// is read from GDI so it is the font that is actually used, whatever type
+	HDC dc = CreateCompatibleDC(0);
+	HFONT font = CreateFont(0);
+	HFONT oldFont = (HFONT)SelectObject(dc, font);
+	DWORD dataSize = GetFontData(dc, 0, 0, 0, 0);
+	int result = 0;
+	if( dataSize != GDI_ERROR )
+	{
+		vector<BYTE> buffer(1024*1024);
+		for( DWORD offset = 0; offset < dataSize && result >= 0; )
 		{
-			// Write image data
-			for( int y = 0; y < outHeight; y++ )
-			{
-				for( int x = 0; x < outWidth; x++ )
-				{
-					DWORD pixel = page->pixels[y*outWidth + x];
-					*(DWORD*)&image.data[y*image.pitch + x*4] = pixel;
-				}
-			}
+			DWORD size = dataSize - offset;
+			if( size > buffer.size() ) size = DWORD(buffer.size());
+			if( GetFontData(dc, 0, offset, &buffer[0], size) != size )
+				result = -1;
+			hash = acUtility::HashData(&buffer[0], size, hash);
+			offset += size;
 		}
+	}
+	else if( fontFile != "" )
+	{
+		// Raster and vector fonts don't give their data, but if the 
+		// font was loaded from a file that can be hashed instead
+		result = acUtility::HashFile(fontFile, hash);
+	}
+	SelectObject(dc, oldFont);
+	DeleteObject(font);
+	DeleteDC(dc);
+	if( result < 0 )
+		return -1;
+
+	for( size_t n = 0; n < iconImages.size(); n++ )
+	{
+		hashInt(iconImages[n]->id);
+		hashInt(iconImages[n]->xoffset);
+		hashInt(iconImages[n]->yoffset);
+		hashInt(iconImages[n]->advance);
+		if( acUtility::HashFile(iconImages[n]->fileName, hash) < 0 )
+			return -1;
+	}
+
+	key = acStringFormat("%016llx", hash);
+
+	return 0;
+}
+
+const vector<string> &CFontGen::GetChangedFiles() const
+{
+	return changedFiles;
+}
+
+const vector<string> &CFontGen::GetUnchangedFiles() const
+{
+	return unchangedFiles;
+}
+
+// Internal
+// Composites the page in the output bit depth, with the format for 32bit pages.
+int CFontGen::GeneratePageImage(int n, acImage::Image &image, acImage::PixelFormat format32)
+{
+	// The pages of a streamed font have already been released
+	if( pages[n] == 0 )
+		return -1;
+
+	image.width = outWidth;
+	image.height = outHeight;
+	if( outBitDepth == 32 )
+	{
+		image.pitch = image.width*4;
+		image.format = format32;
+	}
+	else
+	{
+		image.pitch = image.width;
+		image.format = acImage::PF_A8;
+	}
+
+	image.data = new (std::nothrow) BYTE[image.pitch * image.height];
+	if( image.data == 0 )
+		return -1;
+
+	return pages[n]->GenerateOutputTexture(image);
+}
+
+// Internal
+// Composites the page, converts it to the output format, and encodes it to the file.
+// This may be called for different pages at the same time.
+int CFontGen::SavePage(int n, const string &str)
+{
+	// The page is composited directly in the layout the encoder wants, so 
+	// there is no need to convert it. squish and libpng take RGBA while TGA
+	// and uncompressed DDS store BGRA.
+	acImage::Image image;
+	acImage::PixelFormat format32 = acImage::PF_A8R8G8B8;
+	if( textureFormat == "png" || (textureFormat == "dds" && textureCompression >= 1 && textureCompression <= 3) )
+		format32 = acImage::PF_A8B8G8R8;
+	if( GeneratePageImage(n, image, format32) < 0 )
+		return -1;
+
+	acUtility::CProfilePhase phase(profiler, "encoding", "page", n);
+	int r = 0;
+	if( textureFormat == "tga" )
+		r = acImage::SaveTga(str.c_str(), image, textureCompression ? acImage::TGA_RLE : 0);
+	else if( textureFormat == "png" )
+	{
+		DWORD flags = acImage::PngLevel(pngLevel) | (DWORD(pngFilter) << 4);
+		if( pngParallel ) flags |= acImage::PNG_PARALLEL;
+		r = acImage::SavePng(str.c_str(), image, flags);
+	}
+	else if( textureFormat == "dds" )
+	{
+		DWORD flags = textureCompression;
+		if( dxtFit == 0 )      flags |= acImage::DDS_FIT_RANGE;
+		else if( dxtFit == 2 ) flags |= acImage::DDS_FIT_ITERATIVE;
+		r = acImage::SaveDds(str.c_str(), image, flags);
+	}
+
+	// Don't leave a partially written file behind
+	if( r < 0 )
+	{
+		remove(str.c_str());
+		return -1;
+	}
+
+	if( profiler.IsEnabled() )
+		profiler.AddCount("bytes written", acUtility::GetFileLength(str));
+
+	return 0;
+}
+
+// Internal
+// Saves all pages as the layers of one KTX2 texture array. The layers are 
+// composited one at a time as the encoder asks for them.
+int CFontGen::SaveTextureArray(const string &str)
+{
+	acUtility::CProfilePhase phase(profiler, "encoding");
+
+	DWORD flags = textureCompression;
+	if( dxtFit == 0 )      flags |= acImage::DDS_FIT_RANGE;
+	else if( dxtFit == 2 ) flags |= acImage::DDS_FIT_ITERATIVE;
+	if( ktxZlib )          flags |= acImage::KTX_ZLIB;
+
+	int r = acImage::SaveKtx2(str.c_str(), (unsigned int)pages.size(), [&](unsigned int layer, acImage::Image &image)
+	{
+		return GeneratePageImage(layer, image, acImage::PF_A8B8G8R8);
+	}, flags);
 
-		if( textureFormat == "tga" )
-			acImage::SaveTga(str.c_str(), image, textureCompression ? acImage::TGA_RLE : 0);
-		else if( textureFormat == "png" )
-			acImage::SavePng(str.c_str(), image);
-		else if( textureFormat == "dds" )
-			acImage::SaveDds(str.c_str(), image, textureCompression);
+	// Don't leave a partially written file behind
+	if( r < 0 )
+	{
+		remove(str.c_str());
+		return -1;
 	}
 
+	if( profiler.IsEnabled() )
+		profiler.AddCount("bytes written", acUtility::GetFileLength(str));
+
 	return 0;
 }
 
@@ -2402,15 +3326,22 @@ int CFontGen::SaveConfiguration(const char *szFile)
 	fprintf(f, "spacingVert=%d\n", spacingVert);
 	fprintf(f, "useFixedHeight=%d\n", fixedHeight);
 	fprintf(f, "forceZero=%d\n", forceZero);
+	fprintf(f, "frequencyOrder=%d\n", frequencyOrder);
 
 	fprintf(f, "\n# output file\n");
 	fprintf(f, "outWidth=%d\n", outWidth);
 	fprintf(f, "outHeight=%d\n", outHeight);
 	fprintf(f, "outBitDepth=%d\n", outBitDepth);
 	fprintf(f, "fontDescFormat=%d\n", fontDescFormat);
+	fprintf(f, "kerningClasses=%d\n", useKerningClasses);
 	fprintf(f, "fourChnlPacked=%d\n", fourChnlPacked);
 	fprintf(f, "textureFormat=%s\n", textureFormat.c_str());
 	fprintf(f, "textureCompression=%d\n", textureCompression);
+	fprintf(f, "dxtFit=%d\n", dxtFit);
+	fprintf(f, "pngLevel=%d\n", pngLevel);
+	fprintf(f, "pngFilter=%d\n", pngFilter);
+	fprintf(f, "pngParallel=%d\n", pngParallel);
+	fprintf(f, "ktxZlib=%d\n", ktxZlib);
 	fprintf(f, "alphaChnl=%d\n", alphaChnl);
 	fprintf(f, "redChnl=%d\n", redChnl);
 	fprintf(f, "greenChnl=%d\n", greenChnl);
@@ -2423,6 +3354,10 @@ int CFontGen::SaveConfiguration(const char *szFile)
 	fprintf(f, "\n# outline\n");
 	fprintf(f, "outlineThickness=%d\n", outlineThickness);
 
+	fprintf(f, "\n# generation\n");
+	fprintf(f, "profiling=%d\n", GetProfiling());
+	fprintf(f, "memoryBudget=%d\n", memoryBudget);
+
 	fprintf(f, "\n# selected chars\n");
 	
 	int maxChars = useUnicode ? maxUnicodeChar+1 : 256;
@@ -2525,13 +3460,22 @@ int CFontGen::LoadConfiguration(const char *filename)
 	int    _spacingVert;            config.GetAttrAsInt("spacingVert", _spacingVert, 0, 1);
 	bool   _fixedHeight;            config.GetAttrAsBool("useFixedHeight", _fixedHeight, 0, false);
 	bool   _forceZero;              config.GetAttrAsBool("forceZero", _forceZero, 0, false);
+	bool   _frequencyOrder;         config.GetAttrAsBool("frequencyOrder", _frequencyOrder, 0, false);
+	bool   _profiling;              config.GetAttrAsBool("profiling", _profiling, 0, false);
+	int    _memoryBudget;           config.GetAttrAsInt("memoryBudget", _memoryBudget, 0, 0);
 	int    _outWidth;               config.GetAttrAsInt("outWidth", _outWidth, 0, 256);
 	int    _outHeight;              config.GetAttrAsInt("outHeight", _outHeight, 0, 256);
 	int    _outBitDepth;            config.GetAttrAsInt("outBitDepth", _outBitDepth, 0, 8);
 	int    _fontDescFormat;         config.GetAttrAsInt("fontDescFormat", _fontDescFormat, 0, 0);
+	bool   _useKerningClasses;      config.GetAttrAsBool("kerningClasses", _useKerningClasses, 0, false);
 	bool   _fourChnlPacked;         config.GetAttrAsBool("fourChnlPacked", _fourChnlPacked, 0, false);
 	string _textureFormat;          config.GetAttrAsString("textureFormat", _textureFormat, 0, "tga");
 	int    _textureCompression;     config.GetAttrAsInt("textureCompression", _textureCompression, 0, 0);
+	int    _dxtFit;                 config.GetAttrAsInt("dxtFit", _dxtFit, 0, 1);
+	int    _pngLevel;               config.GetAttrAsInt("pngLevel", _pngLevel, 0, -1);
+	int    _pngFilter;              config.GetAttrAsInt("pngFilter", _pngFilter, 0, 0);
+	bool   _pngParallel;            config.GetAttrAsBool("pngParallel", _pngParallel, 0, false);
+	bool   _ktxZlib;                config.GetAttrAsBool("ktxZlib", _ktxZlib, 0, false);
 	bool   _outputInvalidCharGlyph; config.GetAttrAsBool("outputInvalidCharGlyph", _outputInvalidCharGlyph, 0, false);
 	bool   _dontIncludeKerningPairs; config.GetAttrAsBool("dontIncludeKerningPairs", _dontIncludeKerningPairs, 0, false);
 	int    _outlineThickness;       config.GetAttrAsInt("outlineThickness", _outlineThickness, 0, 0);
@@ -2624,7 +3568,7 @@ int CFontGen::LoadConfiguration(const char *filename)
 	if( _outWidth < 1 ) _outWidth = 1;
 	if( _outHeight < 1 ) _outHeight = 1;
 	if( _outBitDepth != 8 && _outBitDepth != 32 ) _outBitDepth = 8;
-	if( _fontDescFormat < 0 || _fontDescFormat > 2 ) _fontDescFormat = 0;
+	if( _fontDescFormat < 0 || _fontDescFormat > 4 ) _fontDescFormat = 0;
     
 	pos = _textureFormat.find_last_not_of(" \t\n\r");
 	if( pos != string::npos ) _textureFormat.erase(pos + 1);
@@ -2638,10 +3582,10 @@ int CFontGen::LoadConfiguration(const char *filename)
 	{
 		_textureCompression = 0;
 	}
-	else if( _textureFormat == "dds" )
+	else if( _textureFormat == "dds" || _textureFormat == "ktx2" )
 	{
 		if( _textureCompression < 0 ) _textureCompression = 0;
-		if( _textureCompression > 3 ) _textureCompression = 3;
+		if( _textureCompression > 5 ) _textureCompression = 5;
 	}
 	else
 	{
@@ -2649,6 +3593,10 @@ int CFontGen::LoadConfiguration(const char *filename)
 		_textureCompression = 0;
 	}
 
+	if( _dxtFit < 0 || _dxtFit > 2 ) _dxtFit = 1;
+	if( _pngLevel < -1 || _pngLevel > 9 ) _pngLevel = -1;
+	if( _pngFilter < 0 || _pngFilter > 4 ) _pngFilter = 0;
+
 	// Is it the right file version?
 	if( _fileVersion != 1 )
 		return -1;
@@ -2679,15 +3627,24 @@ int CFontGen::LoadConfiguration(const char *filename)
 	SetSpacingVert(_spacingVert);
 	SetFixedHeight(_fixedHeight);
 	SetForceZero(_forceZero);
+	SetFrequencyOrder(_frequencyOrder);
+	SetProfiling(_profiling);
+	SetMemoryBudget(_memoryBudget);
 	SetOutWidth(_outWidth);
 	SetOutHeight(_outHeight);
 	SetOutBitDepth(_outBitDepth);
 	SetFontDescFormat(_fontDescFormat);
+	SetUseKerningClasses(_useKerningClasses);
 	Set4ChnlPacked(_fourChnlPacked);
 	SetOutputInvalidCharGlyph(_outputInvalidCharGlyph);
 	SetDontIncludeKerningPairs(_dontIncludeKerningPairs);
 	SetTextureFormat(_textureFormat);
 	SetTextureCompression(_textureCompression);
+	SetDxtFit(_dxtFit);
+	SetPngLevel(_pngLevel);
+	SetPngFilter(_pngFilter);
+	SetPngParallel(_pngParallel);
+	SetKtxZlib(_ktxZlib);
 	SetOutlineThickness(_outlineThickness);
 	SetAlphaChnl(_alphaChnl);
 	SetRedChnl(_redChnl);
@@ -2717,107 +3674,66 @@ int CFontGen::GetNumFailedChars()
 }
 
 int CFontGen::SelectCharsFromFile(const char *filename)
+{
+	vector<string> paths(1, filename);
+	return SelectCharsFromFiles(paths);
+}
+
+// Selects all characters used in the text files, and in all files in the 
+// directories. The files are scanned in parallel into a set of characters
+// that is then added to the selection at once.
+int CFontGen::SelectCharsFromFiles(const vector<string> &paths)
 {
 	if( isWorking ) return -1;
 
-	FILE *f = 0;
-	errno_t e = fopen_s(&f, filename, "rb");
-	if( e != 0 || f == 0 ) return -1;
+	acUtility::CProfilePhase phase(profiler, "text scan");
 
 	memset(noFit, 0, sizeof(noFit));
 
-	if( IsUsingUnicode() )
-	{
-		unsigned char byteOrderMark[4];
-		size_t cnt = fread(byteOrderMark, 1, 4, f);
-		fseek(f, 0, SEEK_SET);
-
-		// Try to determine the encoding from the byte order mark
-		bool utf8 = false;
-		bool utf16_littleEndian = false;
-		bool utf16_bigEndian = false;
-		if( byteOrderMark[0] == 0xEF &&
-			byteOrderMark[1] == 0xBB &&
-			byteOrderMark[2] == 0xBF )
-			utf8 = true;
-		else if( byteOrderMark[0] == 0xFF &&
-				 byteOrderMark[1] == 0xFE )
-			utf16_littleEndian = true;
-		else if( byteOrderMark[0] == 0xFE &&
-				 byteOrderMark[1] == 0xFF )
-			utf16_bigEndian = true;
-		else
-		{
-			// TODO: Ask the user
-			// TODO: Use IsTextUnicode from Windows API
-			//       ref: https://msdn.microsoft.com/en-us/library/windows/desktop/dd318672(v=vs.85).aspx
-			// No byte order mark was found, let's read as utf-16 little endian
-			utf16_littleEndian = true;
-		}
+	int maxChars = IsUsingUnicode() ? maxUnicodeChar+1 : 256;
+	CCharCorpus corpus(maxUnicodeChar);
+	int result = corpus.Scan(paths, IsUsingUnicode(), frequencyOrder);
+	const CCharBitset &found = corpus.GetChars();
 
-		unsigned char buf[1024];
-		size_t remain = 0;
-		while( (cnt = fread(buf + remain, 1, 1024 - remain, f) + remain) )
-		{
-			UINT n = 0;
-			for( ; n < cnt && n < 1020; )
-			{
-				unsigned int len;
-				int value;
+	// Accumulate the frequencies with the ones from previous files
+	if( frequencyOrder )
+	{
+		const vector<unsigned int> &frequencies = corpus.GetFrequencies();
+		if( charFrequencies.empty() )
+			charFrequencies.assign(maxUnicodeChar+1, 0);
+		for( int ch = found.FindNext(0); ch >= 0; ch = found.FindNext(ch+1) )
+			charFrequencies[ch] += frequencies[ch];
+		arePagesGenerated = false;
+	}
 
-				if( utf8 )
-					value = acUtility::DecodeUTF8(buf+n, &len);
-				else
-					value = acUtility::DecodeUTF16(buf+n, &len, utf16_littleEndian ? acUtility::LITTLE_ENDIAN : acUtility::BIG_ENDIAN);
+	// The characters that the font doesn't have are shown as not fitting,
+	// except for the control characters that are not visible anyway
+	for( int ch = found.FindNext(0); ch >= 0 && ch < maxChars; ch = found.FindNext(ch+1) )
+	{
+		if( disabled[ch] && (!IsUsingUnicode() || (ch >= 32 && ch != 0xFEFF)) )
+			noFit[ch] = true;
+	}
 
-				if( value >= 0 )
-				{
-					n += len;
-					if( SetSelected(value, true) < 0 )
-					{
-						// Control characters are not visible
-						if( value >= 32 && value != 0xFEFF )
-							noFit[value] = true;
-					}
-				}
-				else
-				{
-					// Invalid byte sequence, skip one unit
-					if( utf8 )
-						n++;
-					else
-						n += 2;
-				}
-			}
+	CCharBitset add = found;
+	add.AndNot(disabled);
+	add.AndNot(selected);
+	unsigned int count = add.Count();
+	if( count == 0 )
+		return result;
 
-			// Move the last remaining characters to the beginning of the buffer
-			if( n < cnt )
-			{
-				remain = cnt - n;
-				for( size_t l = 0; l < remain; l++ )
-				{
-					buf[l] = buf[n+l];
-				}
-			}
-			else
-				remain = 0;
-		}
-	}
-	else
+	arePagesGenerated = false;
+
+	selected.Or(add);
+	numCharsSelected += count;
+
+	// Clear the cached selected flag of the subsets that have changed
+	for( unsigned int n = 0; n < subsets.size(); n++ )
 	{
-		unsigned char buf[1024];
-		size_t cnt;
-		while( (cnt = fread(buf, 1, 1024, f)) )
-			for( UINT n = 0; n < cnt; n++ )
-			{
-				if( SetSelected(buf[n], true) < 0 )
-					noFit[buf[n]] = true;
-			}
+		if( !useUnicode || add.Count(subsets[n]->charBegin, subsets[n]->charEnd) )
+			subsets[n]->selected = -1;
 	}
 
-	fclose(f);
-
-	return 0;
+	return result;
 }
 
 int CFontGen::FindNextFailedCharacterSubset(int startSubset)
@@ -38,8 +38,16 @@ using std::vector;
 using std::map;
 
 #include "fontpage.h"
+#include "charbitset.h"
+#include "glyphmap.h"
+#include "opentype.h"
+#include "acutil_profiler.h"
 
 static const int maxUnicodeChar = 0x10FFFF;
+
+// The version of the generator. This must be updated together with the version
+// shown in the about dialog, as it is part of the keys for the build cache
+#define BMFONT_VERSION "1.14 beta"
 class CFontChar;
 
 struct SSubset
@@ -65,6 +73,42 @@ struct SIconImage
 	int     advance;
 };
 
+struct SKerningPair
+{
+	SKerningPair() {first = 0; second = 0; amount = 0;}
+
+	unsigned int first;
+	unsigned int second;
+	int          amount;
+};
+
+// The kerning pairs factored into classes of characters that share the
+// same kerning. The amount for a pair is found in the class by class 
+// matrix, i.e. amounts[firstClass*numSecondClasses + secondClass]
+struct SKerningClasses
+{
+	SKerningClasses() {numFirstClasses = 0; numSecondClasses = 0;}
+
+	unsigned int         numFirstClasses;
+	unsigned int         numSecondClasses;
+	vector<unsigned int> firstChars;
+	vector<unsigned int> firstClasses;
+	vector<unsigned int> secondChars;
+	vector<unsigned int> secondClasses;
+	vector<short>        amounts;
+};
+
+// How well the characters were packed on a page. The areas are in pixels
+// summed over the channels that the characters are packed into, so a four 
+// channel packed page has four times the area of its size.
+struct SPageStats
+{
+	SPageStats() {usedArea = 0; totalArea = 0;}
+
+	long long usedArea;
+	long long totalArea;
+};
+
 enum EChnlValues
 {
 	e_glyph,
@@ -116,8 +160,12 @@ public:
 	int     GetNumCharsSelected();
 	int     GetNumCharsAvailable();
 	int     SelectCharsFromFile(const char *filename);
+	int     SelectCharsFromFiles(const vector<string> &paths);
+	unsigned int GetCharFrequency(int ch) const;
 	bool    DoesUnicodeCharExist(unsigned int ch) const;
 	int     GetUnicodeGlyph(unsigned int ch) const;
+	const CGlyphMap &GetGlyphMap() const;
+	const COpenTypeFont &GetOpenTypeFont() const;
 	int     GetNonUnicodeGlyph(unsigned int ch) const;
 
 	// Failed characters
@@ -154,15 +202,22 @@ public:
 	int     GetXScaleVertical() const;     int SetXScaleVertical(int scale);
 	bool    GetFixedHeight() const;        int SetFixedHeight(bool fixed);
 	bool    GetForceZero() const;          int SetForceZero(bool force);
+	bool    GetFrequencyOrder() const;     int SetFrequencyOrder(bool set);
 									
 	// Output font file
 	int     GetOutWidth() const;           int SetOutWidth(int width);
 	int     GetOutHeight() const;          int SetOutHeight(int height);
 	int     GetOutBitDepth() const;        int SetOutBitDepth(int bitDepth);
 	int     GetFontDescFormat() const;     int SetFontDescFormat(int format);
+	bool    GetUseKerningClasses() const;  int SetUseKerningClasses(bool set);
 	bool    Is4ChnlPacked() const;         int Set4ChnlPacked(bool set);
 	string  GetTextureFormat() const;      int SetTextureFormat(string &format);
 	int     GetTextureCompression() const; int SetTextureCompression(int compression);
+	int     GetDxtFit() const;             int SetDxtFit(int fit);
+	int     GetPngLevel() const;           int SetPngLevel(int level);
+	int     GetPngFilter() const;          int SetPngFilter(int filter);
+	bool    GetPngParallel() const;        int SetPngParallel(bool set);
+	bool    GetKtxZlib() const;            int SetKtxZlib(bool set);
 	int     GetAlphaChnl() const;          int SetAlphaChnl(int value);
 	int     GetRedChnl() const;            int SetRedChnl(int value);
 	int     GetGreenChnl() const;          int SetGreenChnl(int value);
@@ -185,9 +240,38 @@ public:
 	int     GetNumPages();
 	cImage *GetPageImage(int page, int channel);
 
+	// Returns -1 if the pages haven't been generated
+	int     GetPageStats(vector<SPageStats> &stats) const;
+
 	// Save the font to disk
 	int     SaveFont(const char *filename);
 
+	// When a streamed output is set the pages are saved to disk as soon as
+	// they have been filled, and then released, so only one page is kept in
+	// memory at a time. SaveFont must still be called afterwards to write the
+	// font descriptor and give the page files their final names.
+	int     SetStreamedOutput(const char *filename);
+
+	// The files written by the last SaveFont, and the files that were 
+	// left untouched because their content would have been the same
+	const vector<string> &GetChangedFiles() const;
+	const vector<string> &GetUnchangedFiles() const;
+
+	// Computes a key that identifies the output of SaveFont with the current 
+	// settings, selected characters, font data, and icon images. Fonts with 
+	// equal keys produce identical files, so the key can be used for caching.
+	int     GetBuildKey(const char *filename, string &key);
+
+	// Times the phases of the generation and counts the work done in them, 
+	// so it can be seen where a slow font build spends its time
+	bool    GetProfiling() const;          int SetProfiling(bool set);
+	acUtility::CProfiler &GetProfiler();
+
+	// Limits the memory held by the character images in MB, 0 for no limit. 
+	// When the limit is reached the images are compressed, and they are only
+	// decompressed one at a time when compositing the pages.
+	int     GetMemoryBudget() const;       int SetMemoryBudget(int budget);
+
 	// Configuration
 	int     SaveConfiguration(const char *filename);
 	int     LoadConfiguration(const char *filename);
@@ -201,10 +285,21 @@ protected:
 	int  CreatePage();
 	void ClearSubsets();
 	void DetermineExistingChars();
+	void GetKerningPairs(HDC dc, vector<SKerningPair> &pairs);
+	bool GetKerningClasses(const vector<SKerningPair> &pairs, SKerningClasses &classes) const;
+	int  GeneratePageImage(int page, acImage::Image &image, acImage::PixelFormat format32);
+	int  SavePage(int page, const string &filename);
+	int  SaveTextureArray(const string &filename);
+	int  SaveStreamedPage(int page);
+	void KeepWithinMemoryBudget(CFontChar *ch);
+	int  CompressCharImages();
+	int  RecordOutput(const string &filename, int result);
 
 	static void __cdecl GenerateThread(CFontGen *fontGen);
 	void InternalGeneratePages();
 
+	bool UseFrequencyOrder() const;
+
 	bool fontChanged;
 
 	bool isWorking;
@@ -245,15 +340,22 @@ protected:
 	int  spacingVert;
 	bool fixedHeight;
 	bool forceZero;
+	bool frequencyOrder;
 
 	// File output options
 	int    outWidth;
 	int    outHeight;
 	int    outBitDepth;
 	int    fontDescFormat;
+	bool   useKerningClasses;
 	bool   fourChnlPacked;
 	string textureFormat;
 	int    textureCompression;
+	int    dxtFit;             // 0 = range fit, 1 = cluster fit, 2 = iterative cluster fit
+	int    pngLevel;           // zlib level 0-9, or -1 for the default
+	int    pngFilter;          // 0 = adaptive, 1 = none, 2 = sub, 3 = up, 4 = paeth
+	bool   pngParallel;
+	bool   ktxZlib;            // Supercompress the KTX2 texture with zlib
 	int    alphaChnl;
 	int    redChnl;
 	int    greenChnl;
@@ -269,15 +371,34 @@ protected:
 	// Characters
 	int  numCharsSelected;
 	int  numCharsAvailable;
-	bool disabled[maxUnicodeChar+1];
-	bool selected[maxUnicodeChar+1];
+	CCharBitset disabled;
+	CCharBitset selected;
 	bool noFit[maxUnicodeChar+1];
 	CFontChar *chars[maxUnicodeChar+1];
 	CFontChar *invalidCharGlyph;
 
+	// Counted when selecting characters from text files, so the 
+	// most frequent characters can be placed on the first pages
+	vector<unsigned int> charFrequencies;
+
 	// Font textures
 	vector<CFontPage *> pages;
 
+	// The files the pages have been streamed to, when not keeping them in memory
+	string         streamedOutput;
+	vector<string> streamedPages;
+
+	acUtility::CProfiler profiler;
+
+	// The memory held by the character images while generating the pages
+	int    memoryBudget;
+	size_t charMemory;
+	bool   compressChars;
+
+	// The outcome of the last SaveFont
+	vector<string> changedFiles;
+	vector<string> unchangedFiles;
+
 	// Icon images
 	vector<SIconImage *> iconImages;
 
@@ -286,7 +407,16 @@ protected:
 	unsigned int lastFoundSubset;
 
 	// Character to glyph mapping
-	map<unsigned int, unsigned int> unicodeToGlyph;
+	CGlyphMap unicodeToGlyph;
+
+	// The mapped font file that the tables are read from
+	COpenTypeFont openTypeFont;
+
+	// The kerning pairs extracted from the font are kept until
+	// the font or the selected characters change
+	vector<SKerningPair> kerningPairs;
+	string               kerningFont;
+	CCharBitset          kerningChars;
 
 	// Font config
 	string fontConfigFile;
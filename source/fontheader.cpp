@@ -0,0 +1,304 @@
+/*
+   AngelCode Bitmap Font Generator
+   Copyright (c) 2004-2016 Andreas Jonsson
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any
+   damages arising from the use of this software.
+
+   Permission is granted to anyone to use this software for any
+   purpose, including commercial applications, and to alter it and
+   redistribute it freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you
+      must not claim that you wrote the original software. If you use
+      this software in a product, an acknowledgment in the product
+      documentation would be appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and
+      must not be misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+      distribution.
+
+   Andreas Jonsson
+   andreas@angelcode.com
+*/
+#include <string.h>
+#include <ctype.h>
+#include <algorithm>
+#include "fontheader.h"
+
+using namespace std;
+
+// Runs of consecutive code points shorter than this are left to the binary search
+static const unsigned int MIN_RANGE_LENGTH = 4;
+
+// The keywords and alternative operator names of C++, which can't be used as the namespace
+static const char *keywords[] = 
+{
+	"alignas", "alignof", "and", "and_eq", "asm", "auto", "bitand", "bitor", "bool", "break", 
+	"case", "catch", "char", "char8_t", "char16_t", "char32_t", "class", "compl", "concept", 
+	"const", "consteval", "constexpr", "constinit", "const_cast", "continue", "co_await", 
+	"co_return", "co_yield", "decltype", "default", "delete", "do", "double", "dynamic_cast", 
+	"else", "enum", "explicit", "export", "extern", "false", "float", "for", "friend", "goto", 
+	"if", "inline", "int", "long", "mutable", "namespace", "new", "noexcept", "not", "not_eq", 
+	"nullptr", "operator", "or", "or_eq", "private", "protected", "public", "register", 
+	"reinterpret_cast", "requires", "return", "short", "signed", "sizeof", "static", 
+	"static_assert", "static_cast", "struct", "switch", "template", "this", "thread_local", 
+	"throw", "true", "try", "typedef", "typeid", "typename", "union", "unsigned", "using", 
+	"virtual", "void", "volatile", "wchar_t", "while", "xor", "xor_eq"
+};
+
+CFontHeaderWriter::CFontHeaderWriter()
+{
+	memset(common, 0, sizeof(common));
+	numPages      = 0;
+	bytesPerPixel = 0;
+}
+
+void CFontHeaderWriter::SetName(const string &n)
+{
+	// Only letters, digits and underscores are allowed in identifiers
+	name = "";
+	for( size_t c = 0; c < n.length(); c++ )
+	{
+		char ch = n[c];
+		if( (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9') )
+			name += ch;
+		else
+			name += '_';
+	}
+	if( name == "" || (name[0] >= '0' && name[0] <= '9') )
+		name = "font_" + name;
+
+	for( size_t k = 0; k < sizeof(keywords)/sizeof(keywords[0]); k++ )
+	{
+		if( name == keywords[k] )
+		{
+			name += '_';
+			break;
+		}
+	}
+}
+
+void CFontHeaderWriter::SetFaceName(const string &n)
+{
+	faceName = n;
+}
+
+void CFontHeaderWriter::SetCommon(int fontSize, int lineHeight, int base, int scaleW, int scaleH, bool packed, int alphaChnl, int redChnl, int greenChnl, int blueChnl)
+{
+	common[0] = fontSize;
+	common[1] = lineHeight;
+	common[2] = base;
+	common[3] = scaleW;
+	common[4] = scaleH;
+	common[5] = packed ? 1 : 0;
+	common[6] = alphaChnl;
+	common[7] = redChnl;
+	common[8] = greenChnl;
+	common[9] = blueChnl;
+}
+
+void CFontHeaderWriter::AddGlyph(const SRuntimeFontGlyph &glyph)
+{
+	glyphs.push_back(glyph);
+}
+
+void CFontHeaderWriter::AddKerning(unsigned int first, unsigned int second, short amount)
+{
+	SKerning k;
+	k.first  = first;
+	k.second = second;
+	k.amount = amount;
+	kernings.push_back(k);
+}
+
+static bool GlyphLess(const SRuntimeFontGlyph &a, const SRuntimeFontGlyph &b) { return a.id < b.id; }
+static bool GlyphEqual(const SRuntimeFontGlyph &a, const SRuntimeFontGlyph &b) { return a.id == b.id; }
+
+// Writes the string as a literal. The bytes outside of printable ASCII are 
+// escaped in octal, since a hex escape would also consume following digits.
+static void WriteStringLiteral(FILE *f, const string &str)
+{
+	fputc('"', f);
+	for( size_t n = 0; n < str.length(); n++ )
+	{
+		unsigned char ch = (unsigned char)str[n];
+		if( ch == '"' || ch == '\\' )
+			fprintf(f, "\\%c", ch);
+		else if( ch < 32 || ch >= 127 || ch == '?' )
+			fprintf(f, "\\%03o", ch);
+		else
+			fputc(ch, f);
+	}
+	fputc('"', f);
+}
+
+int CFontHeaderWriter::WriteMetrics(FILE *f, int pages)
+{
+	// Each code point can only have one glyph
+	stable_sort(glyphs.begin(), glyphs.end(), GlyphLess);
+	glyphs.erase(unique(glyphs.begin(), glyphs.end(), GlyphEqual), glyphs.end());
+
+	stable_sort(kernings.begin(), kernings.end(), [](const SKerning &a, const SKerning &b) { return a.first < b.first || (a.first == b.first && a.second < b.second); });
+	kernings.erase(unique(kernings.begin(), kernings.end(), [](const SKerning &a, const SKerning &b) { return a.first == b.first && a.second == b.second; }), kernings.end());
+
+	numPages = pages;
+	bytesPerPixel = 0;
+
+	string guard = name + "_FONT_H";
+	transform(guard.begin(), guard.end(), guard.begin(), ::toupper);
+
+	fprintf(f, "// Generated by AngelCode Bitmap Font Generator. Don't edit.\n\n");
+	fprintf(f, "#ifndef %s\n#define %s\n\n", guard.c_str(), guard.c_str());
+	fprintf(f, "namespace %s\n{\n\n", name.c_str());
+
+	fprintf(f, "struct SGlyph { unsigned int id; unsigned short x, y, width, height; short xoffset, yoffset, xadvance; unsigned char page, chnl; };\n");
+	fprintf(f, "struct SRange { unsigned int first, count, glyph; };\n");
+	fprintf(f, "struct SKerning { unsigned int first, second; short amount; };\n\n");
+
+	fprintf(f, "constexpr const char faceName[] = ");
+	WriteStringLiteral(f, faceName);
+	fprintf(f, ";\n");
+	static const char *commonNames[10] = {"fontSize", "lineHeight", "base", "scaleW", "scaleH", "packed", "alphaChnl", "redChnl", "greenChnl", "blueChnl"};
+	for( int n = 0; n < 10; n++ )
+		fprintf(f, "constexpr int %s = %d;\n", commonNames[n], common[n]);
+	fprintf(f, "constexpr int numPages = %d;\n\n", numPages);
+
+	// The arrays can't be empty, so an unused entry is written when there is nothing 
+	// to list. The counts tell how many entries are valid.
+	fprintf(f, "constexpr int numGlyphs = %d;\n", int(glyphs.size()));
+	fprintf(f, "constexpr SGlyph glyphs[] =\n{\n");
+	for( size_t n = 0; n < glyphs.size(); n++ )
+	{
+		const SRuntimeFontGlyph &g = glyphs[n];
+		fprintf(f, "\t{%uu, %u, %u, %u, %u, %d, %d, %d, %u, %u},\n", g.id, g.x, g.y, g.width, g.height, g.xoffset, g.yoffset, g.xadvance, g.page, g.chnl);
+	}
+	if( glyphs.size() == 0 )
+		fprintf(f, "\t{0xFFFFFFFFu, 0, 0, 0, 0, 0, 0, 0, 0, 0},\n");
+	fprintf(f, "};\n\n");
+
+	// List the runs of consecutive code points, so their glyphs are found by offset
+	unsigned int numRanges = 0;
+	fprintf(f, "constexpr SRange ranges[] =\n{\n");
+	for( size_t n = 0; n < glyphs.size(); )
+	{
+		size_t end = n + 1;
+		while( end < glyphs.size() && glyphs[end].id == glyphs[end-1].id + 1 )
+			end++;
+		if( end - n >= MIN_RANGE_LENGTH )
+		{
+			fprintf(f, "\t{%uu, %u, %u},\n", glyphs[n].id, unsigned(end - n), unsigned(n));
+			numRanges++;
+		}
+		n = end;
+	}
+	if( numRanges == 0 )
+		fprintf(f, "\t{0, 0, 0},\n");
+	fprintf(f, "};\n");
+	fprintf(f, "constexpr int numRanges = %u;\n\n", numRanges);
+
+	fprintf(f, "constexpr int numKernings = %d;\n", int(kernings.size()));
+	fprintf(f, "constexpr SKerning kernings[] =\n{\n");
+	for( size_t n = 0; n < kernings.size(); n++ )
+		fprintf(f, "\t{%uu, %uu, %d},\n", kernings[n].first, kernings[n].second, kernings[n].amount);
+	if( kernings.size() == 0 )
+		fprintf(f, "\t{0, 0, 0},\n");
+	fprintf(f, "};\n\n");
+
+	return ferror(f) ? -1 : 0;
+}
+
+int CFontHeaderWriter::WritePage(FILE *f, int page, const acImage::Image &image)
+{
+	if( image.format == acImage::PF_A8 )
+		bytesPerPixel = 1;
+	else if( image.format == acImage::PF_A8B8G8R8 )
+		bytesPerPixel = 4;
+	else
+		return -1;
+
+	// The bytes are formatted into a buffer, as fprintf would be far too slow for large pages
+	static const char hex[] = "0123456789abcdef";
+	size_t rowBytes = size_t(image.width)*bytesPerPixel;
+	vector<char> line;
+	fprintf(f, "constexpr unsigned char page%d[] =\n{\n", page);
+	for( unsigned int y = 0; y < image.height; y++ )
+	{
+		const unsigned char *row = image.data + size_t(y)*image.pitch;
+		for( size_t x = 0; x < rowBytes; x += 16 )
+		{
+			line.clear();
+			line.push_back('\t');
+			for( size_t b = x; b < rowBytes && b < x + 16; b++ )
+			{
+				line.push_back('0'); line.push_back('x');
+				line.push_back(hex[row[b] >> 4]); line.push_back(hex[row[b] & 15]);
+				line.push_back(',');
+			}
+			line.push_back('\n');
+			fwrite(&line[0], 1, line.size(), f);
+		}
+	}
+	if( rowBytes*image.height == 0 )
+		fprintf(f, "\t0\n");
+	fprintf(f, "};\n\n");
+
+	return ferror(f) ? -1 : 0;
+}
+
+int CFontHeaderWriter::WriteEnd(FILE *f)
+{
+	fprintf(f, "constexpr int pageBytesPerPixel = %d;\n", bytesPerPixel);
+	fprintf(f, "constexpr const unsigned char *pages[] = {");
+	for( int n = 0; n < numPages; n++ )
+		fprintf(f, n ? ", page%d" : "page%d", n);
+	if( numPages == 0 )
+		fprintf(f, "0");
+	fprintf(f, "};\n\n");
+
+	// The lookups are written with a single return statement each, so they
+	// are valid constexpr functions with C++11 too
+	fprintf(f, 
+		"constexpr int FindGlyphSorted(unsigned int id, int lo, int hi)\n"
+		"{\n"
+		"\treturn lo >= hi ? -1 :\n"
+		"\t       glyphs[(lo+hi)/2].id < id ? FindGlyphSorted(id, (lo+hi)/2+1, hi) :\n"
+		"\t       glyphs[(lo+hi)/2].id > id ? FindGlyphSorted(id, lo, (lo+hi)/2) : (lo+hi)/2;\n"
+		"}\n\n"
+		"constexpr int FindGlyphInRanges(unsigned int id, int lo, int hi)\n"
+		"{\n"
+		"\treturn lo >= hi ? -1 :\n"
+		"\t       id < ranges[(lo+hi)/2].first ? FindGlyphInRanges(id, lo, (lo+hi)/2) :\n"
+		"\t       id - ranges[(lo+hi)/2].first >= ranges[(lo+hi)/2].count ? FindGlyphInRanges(id, (lo+hi)/2+1, hi) :\n"
+		"\t       int(ranges[(lo+hi)/2].glyph + (id - ranges[(lo+hi)/2].first));\n"
+		"}\n\n"
+		"constexpr int FindGlyphFallback(unsigned int id, int glyph)\n"
+		"{\n"
+		"\treturn glyph >= 0 ? glyph : FindGlyphSorted(id, 0, numGlyphs);\n"
+		"}\n\n"
+		"// Returns the index of the glyph in glyphs, or -1 if the font doesn't have it.\n"
+		"// The invalid char glyph has the id 0xFFFFFFFF.\n"
+		"constexpr int FindGlyph(unsigned int id)\n"
+		"{\n"
+		"\treturn FindGlyphFallback(id, FindGlyphInRanges(id, 0, numRanges));\n"
+		"}\n\n"
+		"constexpr int FindKerning(unsigned int first, unsigned int second, int lo, int hi)\n"
+		"{\n"
+		"\treturn lo >= hi ? 0 :\n"
+		"\t       kernings[(lo+hi)/2].first < first || (kernings[(lo+hi)/2].first == first && kernings[(lo+hi)/2].second < second) ? FindKerning(first, second, (lo+hi)/2+1, hi) :\n"
+		"\t       kernings[(lo+hi)/2].first > first || kernings[(lo+hi)/2].second > second ? FindKerning(first, second, lo, (lo+hi)/2) :\n"
+		"\t       kernings[(lo+hi)/2].amount;\n"
+		"}\n\n"
+		"// Returns the kerning between the two code points\n"
+		"constexpr int GetKerning(unsigned int first, unsigned int second)\n"
+		"{\n"
+		"\treturn FindKerning(first, second, 0, numKernings);\n"
+		"}\n\n");
+
+	fprintf(f, "}\n\n#endif\n");
+
+	return ferror(f) ? -1 : 0;
+}
@@ -0,0 +1,77 @@
+/*
+   AngelCode Bitmap Font Generator
+   Copyright (c) 2004-2016 Andreas Jonsson
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any
+   damages arising from the use of this software.
+
+   Permission is granted to anyone to use this software for any
+   purpose, including commercial applications, and to alter it and
+   redistribute it freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you
+      must not claim that you wrote the original software. If you use
+      this software in a product, an acknowledgment in the product
+      documentation would be appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and
+      must not be misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+      distribution.
+
+   Andreas Jonsson
+   andreas@angelcode.com
+*/
+#ifndef FONTHEADER_H
+#define FONTHEADER_H
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "runtimefont.h"
+#include "acimg.h"
+
+// Writes the font as a C++ header that can be compiled into the application.
+// The glyphs are sorted by code point, and the runs of consecutive code points
+// are listed as ranges so most glyphs are found without searching the glyphs.
+// The lookups are constexpr functions that only use the C++11 subset, so the
+// compiler can inline them or evaluate them at compile time. The page pixels
+// are written as byte arrays, in R, G, B, A order for 32bit pages.
+class CFontHeaderWriter
+{
+public:
+	CFontHeaderWriter();
+
+	// The name is used for the namespace and the include guard
+	void SetName(const std::string &name);
+	void SetFaceName(const std::string &name);
+	void SetCommon(int fontSize, int lineHeight, int base, int scaleW, int scaleH, bool packed, int alphaChnl, int redChnl, int greenChnl, int blueChnl);
+	void AddGlyph(const SRuntimeFontGlyph &glyph);
+	void AddKerning(unsigned int first, unsigned int second, short amount);
+
+	// The pages are written one at a time between WriteMetrics and WriteEnd,
+	// so only one page image has to be in memory. Returns -1 on error.
+	int  WriteMetrics(FILE *f, int numPages);
+	int  WritePage(FILE *f, int page, const acImage::Image &image);
+	int  WriteEnd(FILE *f);
+
+protected:
+	struct SKerning
+	{
+		unsigned int first;
+		unsigned int second;
+		short        amount;
+	};
+
+	std::string                    name;
+	std::string                    faceName;
+	int                            common[10];
+	int                            numPages;
+	int                            bytesPerPixel;
+	std::vector<SRuntimeFontGlyph> glyphs;
+	std::vector<SKerning>          kernings;
+};
+
+#endif
@@ -27,11 +27,18 @@
 
 #include <algorithm>
 #include <fstream>
+#include <string.h>
 
 #include "fontpage.h"
 #include "fontchar.h"
 #include "fontgen.h"
 
+// SSE2 is always available on x64, and is the default for x86 with the supported compilers
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define USE_SSE2
+#include <emmintrin.h>
+#endif
+
 using namespace std;
 
 #define CLR_BORDER 0x007F00ul
@@ -42,9 +49,10 @@ CFontPage::CFontPage(CFontGen *gen, int id, int width, int height, int spacingH,
 	this->gen = gen;
 	pageId = id;
 
-	// Allocate and clear the image with the unused color
-	pageImg = new (std::nothrow) cImage(width, height);
-	pageImg->Clear(CLR_UNUSED);
+	// The image is only needed for the preview, so it isn't allocated until then
+	pageImg    = 0;
+	pageWidth  = width;
+	pageHeight = height;
 
 	// Initialize the height array that shows free space
 	heights[0] = new (std::nothrow) int[width];
@@ -67,9 +75,7 @@ CFontPage::CFontPage(CFontGen *gen, int id, int width, int height, int spacingH,
 
 bool CFontPage::IsOK()
 {
-	if( pageImg == 0 || heights[0] == 0 ) return false;
-
-	if( pageImg->pixels == 0 ) return false;
+	if( heights[0] == 0 ) return false;
 
 	return true;
 }
@@ -115,7 +121,7 @@ void CFontPage::AddChar(int cx, int cy, CFontChar *ch, int channel)
 	for( int x = -spacingH; x < img->width + paddingLeft + paddingRight + spacingH; x++ )
 	{
 		int tempX = x + cx;
-		if( tempX < 0 ) tempX += pageImg->width;
+		if( tempX < 0 ) tempX += pageWidth;
 		if( cy + img->height + spacingV + paddingUp + paddingDown > heights[channel][tempX] )
 			heights[channel][tempX] = cy + img->height + spacingV + paddingUp + paddingDown;
 	}
@@ -133,10 +139,10 @@ int CFontPage::AddChar(CFontChar *ch, int channel)
 
 	// Iterate for each possible x position
 	int i = 0;
-	while( i++ < pageImg->width - img->width - paddingRight - paddingLeft - spacingH )
+	while( i++ < pageWidth - img->width - paddingRight - paddingLeft - spacingH )
 	{
 		// Is the character narrow enough to fit?
-		if( img->width + currX + paddingRight + paddingLeft > pageImg->width - spacingH )
+		if( img->width + currX + paddingRight + paddingLeft > pageWidth - spacingH )
 		{
 			// Start from the left side again
 			currX = 0;
@@ -150,7 +156,7 @@ int CFontPage::AddChar(CFontChar *ch, int channel)
 				cy = heights[channel][n+currX];
 		}
 
-		if( cy + img->height + paddingUp + paddingDown <= pageImg->height - spacingV )
+		if( cy + img->height + paddingUp + paddingDown <= pageHeight - spacingV )
 		{
 			// Are we creating any holes?
 			for( int x = 0; x < img->width + paddingLeft + paddingRight; x++ )
@@ -203,6 +209,31 @@ cImage *CFontPage::GetPageImage()
 	return pageImg;
 }
 
+size_t CFontPage::ReleaseCharImages()
+{
+	size_t freed = 0;
+	for( unsigned int n = 0; n < chars.size(); n++ )
+	{
+		freed += chars[n]->GetImageMemory();
+		chars[n]->ReleaseImage();
+	}
+
+	return freed;
+}
+
+int CFontPage::RedrawCharImages(HFONT font, size_t &drawn)
+{
+	for( unsigned int n = 0; n < chars.size(); n++ )
+	{
+		size_t before = chars[n]->GetImageMemory();
+		if( chars[n]->RedrawImage(font, gen) < 0 )
+			return -1;
+		drawn += chars[n]->GetImageMemory() - before;
+	}
+
+	return 0;
+}
+
 void CFontPage::SetPadding(int left, int up, int right, int down)
 {
 	paddingLeft  = left;
@@ -213,44 +244,165 @@ void CFontPage::SetPadding(int left, int up, int right, int down)
 
 int CFontPage::GetNextIdealImageWidth()
 {
-	return pageImg->width - currX - paddingRight - paddingLeft - spacingH;
+	return pageWidth - currX - paddingRight - paddingLeft - spacingH;
 }
 
+// The page textures are composited one character row at a time by the
+// kernels below. Each kernel takes a row of the character image, which is
+// always A8R8G8B8, and writes it to the destination in its own layout.
+template<class KERNEL>
+static void CompositeImage(const cImage *img, BYTE *dst, int pitch, const KERNEL &kernel)
+{
+	for( int y = 0; y < img->height; y++ )
+		kernel(img->pixels + y*img->width, dst + y*pitch, img->width);
+}
+
+// Copies the row as is
+struct SCopyKernel
+{
+	void operator()(const PIXEL *src, BYTE *dst, int width) const
+	{
+		memcpy(dst, src, width*4);
+	}
+};
+
+// Copies the row while swapping the red and blue channels
+struct SSwapRedBlueKernel
+{
+	void operator()(const PIXEL *src, BYTE *dst, int width) const
+	{
+		DWORD *out = (DWORD*)dst;
+		int x = 0;
+#ifdef USE_SSE2
+		const __m128i ag = _mm_set1_epi32(0xFF00FF00);
+		const __m128i lo = _mm_set1_epi32(0x000000FF);
+		for( ; x + 4 <= width; x += 4 )
+		{
+			__m128i p = _mm_loadu_si128((const __m128i*)(src + x));
+			__m128i r = _mm_and_si128(_mm_srli_epi32(p, 16), lo);
+			__m128i b = _mm_slli_epi32(_mm_and_si128(p, lo), 16);
+			p = _mm_or_si128(_mm_and_si128(p, ag), _mm_or_si128(r, b));
+			_mm_storeu_si128((__m128i*)(out + x), p);
+		}
+#endif
+		for( ; x < width; x++ )
+		{
+			DWORD p = src[x];
+			out[x] = (p & 0xFF00FF00) | ((p >> 16) & 0xFF) | ((p & 0xFF) << 16);
+		}
+	}
+};
+
+// Copies only the alpha channel of the row
+struct SAlphaKernel
+{
+	void operator()(const PIXEL *src, BYTE *dst, int width) const
+	{
+		for( int x = 0; x < width; x++ )
+			dst[x] = BYTE(src[x] >> 24);
+	}
+};
+
+// Shows the outline by blending the row against a blue background. When
+// the outline is opaque nothing is added, so no test is needed per pixel.
+struct SOutlinePreviewKernel
+{
+	void operator()(const PIXEL *src, BYTE *dst, int width) const
+	{
+		DWORD *out = (DWORD*)dst;
+		int x = 0;
+#ifdef USE_SSE2
+		const __m128i full = _mm_set1_epi32(0xFF);
+		for( ; x + 4 <= width; x += 4 )
+		{
+			__m128i p = _mm_loadu_si128((const __m128i*)(src + x));
+			p = _mm_add_epi32(p, _mm_sub_epi32(full, _mm_srli_epi32(p, 24)));
+			_mm_storeu_si128((__m128i*)(out + x), p);
+		}
+#endif
+		for( ; x < width; x++ )
+			out[x] = src[x] + 255 - (src[x] >> 24);
+	}
+};
+
+// The channel encodings are resolved into lookup tables once per page, so
+// each pixel is encoded with a single table lookup. The first 256 entries are
+// indexed by the glyph value. For characters with outline the glyph value is
+// only used where the glyph is visible, and the remaining 256 entries are
+// indexed by the outline value for the rest of the pixels.
+template<bool OUTLINE>
+static inline unsigned int EncodingIndex(DWORD p)
+{
+	if( OUTLINE && BYTE(p) == 0 )
+		return 256 + (p >> 24);
+	return BYTE(p);
+}
+
+// Encodes all channels of the row into 32bit pixels
+template<bool OUTLINE>
+struct SEncodePixelKernel
+{
+	const DWORD *table;
+
+	void operator()(const PIXEL *src, BYTE *dst, int width) const
+	{
+		DWORD *out = (DWORD*)dst;
+		for( int x = 0; x < width; x++ )
+			out[x] = table[EncodingIndex<OUTLINE>(src[x])];
+	}
+};
+
+// Encodes a single channel of the row into bytes that are stride bytes apart.
+// This is used both for the 8bit output and for the characters that are
+// packed into one of the channels of a 32bit texture.
+template<bool OUTLINE>
+struct SEncodeByteKernel
+{
+	const BYTE *table;
+	int         stride;
+
+	void operator()(const PIXEL *src, BYTE *dst, int width) const
+	{
+		for( int x = 0; x < width; x++ )
+			dst[x*stride] = table[EncodingIndex<OUTLINE>(src[x])];
+	}
+};
+
 void CFontPage::GeneratePreviewTexture(int channel)
 {
+	if( pageImg == 0 )
+	{
+		pageImg = new (std::nothrow) cImage(pageWidth, pageHeight);
+		if( pageImg && pageImg->pixels == 0 )
+		{
+			delete pageImg;
+			pageImg = 0;
+		}
+		if( pageImg == 0 )
+			return;
+	}
+
 	pageImg->Clear(CLR_UNUSED);
 
+	int pitch = pageImg->width*4;
+
 	// Copy the font char images to the texture
+	cImage unpacked;
 	for( unsigned int n = 0; n < chars.size(); n++ )
 	{
 		if( chars[n]->m_chnl & (1<<channel) )
 		{
 			int cx = chars[n]->m_x + paddingLeft;
 			int cy = chars[n]->m_y + paddingUp;
-			cImage *img = chars[n]->m_charImg;
+			const cImage *img = chars[n]->GetImage(unpacked);
+			BYTE *dst = (BYTE*)(pageImg->pixels + cy*pageImg->width + cx);
 	
-			if( chars[n]->HasOutline() )
-			{
-				// Show the outline, by blending against blue background
-				for( int y = 0; y < img->height; y++ )
-				{
-					for( int x = 0; x < img->width; x++ )
-					{
-						DWORD p = img->pixels[y*img->width+x];
-						if( (p >> 24) < 0xFF )
-							p += 255 - (p>>24);
-						pageImg->pixels[(y+cy)*pageImg->width+(x+cx)] = p;
-					}
-				}
-			}
+			if( img == 0 )
+				;
+			else if( chars[n]->HasOutline() )
+				CompositeImage(img, dst, pitch, SOutlinePreviewKernel());
 			else
-			{
-				for( int y = 0; y < img->height; y++ )
-				{
-					for( int x = 0; x < img->width; x++ )
-						pageImg->pixels[(y+cy)*pageImg->width+(x+cx)] = img->pixels[y*img->width+x];
-				}
-			}
+				CompositeImage(img, dst, pitch, SCopyKernel());
 
 			// Draw the spacing borders
 			if( spacingH > 0 )
@@ -286,8 +438,47 @@ void CFontPage::GeneratePreviewTexture(int channel)
 	}
 }
 
-void CFontPage::GenerateOutputTexture()
+// Returns the shift of the channel within a 32bit pixel in the image layout
+static inline int ChannelShift(const acImage::Image &image, int chnl)
 {
+	// The channels are given as 0 = blue, 1 = green, 2 = red, 3 = alpha
+	if( image.format == acImage::PF_A8B8G8R8 && (chnl == 0 || chnl == 2) )
+		chnl ^= 2;
+	return chnl*8;
+}
+
+// The characters are composited directly into the image that will be passed
+// to the encoder, in the layout the encoder wants, i.e. PF_A8 for 8bit output
+// and PF_A8R8G8B8 or PF_A8B8G8R8 for 32bit output. Returns -1 if a compressed
+// character image couldn't be decompressed for lack of memory.
+int CFontPage::GenerateOutputTexture(acImage::Image &image)
+{
+	acUtility::CProfilePhase phase(gen->profiler, "compositing", "page", pageId);
+
+	// Resolve the encoding of each channel, with 0 = blue, 1 = green, 2 = red, 3 = alpha
+	int  encoding[4] = {blueChnl, greenChnl, redChnl, alphaChnl};
+	bool inverted[4] = {gen->IsBlueInverted(), gen->IsGreenInverted(), gen->IsRedInverted(), gen->IsAlphaInverted()};
+
+	// Build the lookup tables for characters without and with outline
+	DWORD pixelTable[2][512];
+	BYTE  alphaTable[2][512];
+	for( int outline = 0; outline < 2; outline++ )
+	{
+		for( int i = 0; i < 512; i++ )
+		{
+			DWORD color = i < 256 ? DWORD(i) : DWORD(i - 256) << 24;
+			DWORD p = 0;
+			for( int c = 0; c < 4; c++ )
+			{
+				DWORD t = CFontChar::EncodePixelValue(color, outline ? true : false, encoding[c]);
+				if( inverted[c] ) t = 255 - t;
+				p |= t << ChannelShift(image, c);
+			}
+			pixelTable[outline][i] = p;
+			alphaTable[outline][i] = BYTE(p >> 24);
+		}
+	}
+
 	// Clear the image
 	DWORD color = 0;
 	if( alphaChnl == e_one && !gen->IsAlphaInverted() || gen->IsAlphaInverted() )
@@ -302,85 +493,95 @@ void CFontPage::GenerateOutputTexture()
 	else
 	{
 		if( redChnl == e_one && !gen->IsRedInverted() || gen->IsRedInverted() )
-			color |= 0xFF << 16;
+			color |= 0xFF << ChannelShift(image, 2);
 		if( greenChnl == e_one && !gen->IsGreenInverted() || gen->IsGreenInverted() )
 			color |= 0xFF << 8;
 		if( blueChnl == e_one && !gen->IsBlueInverted() || gen->IsBlueInverted() )
-			color |= 0xFF;
+			color |= 0xFF << ChannelShift(image, 0);
+	}
+	if( image.format == acImage::PF_A8 )
+		memset(image.data, BYTE(color >> 24), image.width);
+	else
+	{
+		for( int x = 0; x < (int)image.width; x++ )
+			((DWORD*)image.data)[x] = color;
 	}
-	pageImg->Clear(color);
+	for( int y = 1; y < (int)image.height; y++ )
+		memcpy(image.data + y*image.pitch, image.data, image.pitch);
+
+	int bytesPerPixel = image.format == acImage::PF_A8 ? 1 : 4;
 	
-	// Copy the font char images to the texture
+	// Copy the font char images to the texture. The compressed 
+	// images are decompressed one at a time as they are needed.
+	cImage unpacked;
 	for( unsigned int n = 0; n < chars.size(); n++ )
 	{
 		int cx = chars[n]->m_x + paddingLeft;
 		int cy = chars[n]->m_y + paddingUp;
-		cImage *img = chars[n]->m_charImg;
+		const cImage *img = chars[n]->GetImage(unpacked);
+		if( img == 0 )
+			return -1;
+		BYTE *dst = image.data + cy*image.pitch + cx*bytesPerPixel;
+		bool outline = chars[n]->HasOutline();
 
 		if( !chars[n]->m_isChar )
 		{
 			// Colored images are copied as is
-			for( int y = 0; y < img->height; y++ )
+			if( image.format == acImage::PF_A8 )
+				CompositeImage(img, dst, image.pitch, SAlphaKernel());
+			else if( image.format == acImage::PF_A8B8G8R8 )
+				CompositeImage(img, dst, image.pitch, SSwapRedBlueKernel());
+			else
+				CompositeImage(img, dst, image.pitch, SCopyKernel());
+		}
+		else if( bitDepth == 32 && fourChnlPacked )
+		{
+			// When packing multiple characters we use the alpha channel 
+			// to determine the content, and only the character's channel 
+			// is written so the other characters sharing the pixels are kept
+			int chnl = chars[n]->m_chnl == 1 ? 0 : chars[n]->m_chnl == 2 ? 1 : chars[n]->m_chnl == 4 ? 2 : 3;
+			dst += ChannelShift(image, chnl)/8;
+
+			if( outline )
+			{
+				SEncodeByteKernel<true> kernel = {alphaTable[1], 4};
+				CompositeImage(img, dst, image.pitch, kernel);
+			}
+			else
 			{
-				for( int x = 0; x < img->width; x++ )
-					pageImg->pixels[(y+cy)*pageImg->width+(x+cx)] = img->pixels[y*img->width+x];
+				SEncodeByteKernel<false> kernel = {alphaTable[0], 4};
+				CompositeImage(img, dst, image.pitch, kernel);
+			}
+		}
+		else if( image.format == acImage::PF_A8 )
+		{
+			if( outline )
+			{
+				SEncodeByteKernel<true> kernel = {alphaTable[1], 1};
+				CompositeImage(img, dst, image.pitch, kernel);
+			}
+			else
+			{
+				SEncodeByteKernel<false> kernel = {alphaTable[0], 1};
+				CompositeImage(img, dst, image.pitch, kernel);
 			}
 		}
 		else
 		{
-			if( bitDepth == 32 && fourChnlPacked )
+			if( outline )
 			{
-				// When packing multiple characters we 
-				// use the alpha channel to determine the content
-				for( int y = 0; y < img->height; y++ )
-				{
-					for( int x = 0; x < img->width; x++ )
-					{
-						DWORD p = chars[n]->GetPixelValue(x, y, alphaChnl);
-						if( gen->IsAlphaInverted() ) p = 255 - p;
-						DWORD c = pageImg->pixels[(y+cy)*pageImg->width+(x+cx)];
-						if( chars[n]->m_chnl == 1 )
-						{
-							c &= 0xFFFFFF00;
-							c |= p;
-						}
-						else if( chars[n]->m_chnl == 2 )
-						{
-							c &= 0xFFFF00FF;
-							c |= p << 8;
-						}
-						else if( chars[n]->m_chnl == 4 )
-						{
-							c &= 0xFF00FFFF;
-							c |= p << 16;
-						}
-						else if( chars[n]->m_chnl == 8 )
-						{
-							c &= 0x00FFFFFF;
-							c |= p << 24;
-						}
-						pageImg->pixels[(y+cy)*pageImg->width+(x+cx)] = c;
-					}
-				}
+				SEncodePixelKernel<true> kernel = {pixelTable[1]};
+				CompositeImage(img, dst, image.pitch, kernel);
 			}
 			else
 			{
-				for( int y = 0; y < img->height; y++ )
-				{
-					for( int x = 0; x < img->width; x++ )
-					{
-						DWORD p = 0;
-						DWORD t;
-						t = (BYTE)chars[n]->GetPixelValue(x, y, blueChnl);  if( gen->IsBlueInverted() )  t = 255 - t; p |= t  << 0;
-						t = (BYTE)chars[n]->GetPixelValue(x, y, greenChnl); if( gen->IsGreenInverted() ) t = 255 - t; p |= t  << 8;
-						t = (BYTE)chars[n]->GetPixelValue(x, y, redChnl);   if( gen->IsRedInverted() )   t = 255 - t; p |= t  << 16;
-						t = (BYTE)chars[n]->GetPixelValue(x, y, alphaChnl); if( gen->IsAlphaInverted() ) t = 255 - t; p |= t  << 24;
-						pageImg->pixels[(y+cy)*pageImg->width+(x+cx)] = p;
-					}
-				}
+				SEncodePixelKernel<false> kernel = {pixelTable[0]};
+				CompositeImage(img, dst, image.pitch, kernel);
 			}
 		}
 	}
+
+	return 0;
 }
 
 // This global pointer will be used by the sorting algorithm
@@ -410,13 +611,17 @@ extern ofstream trace;
 
 void CFontPage::AddChars(CFontChar **chars, int maxChars)
 {
+	acUtility::CProfilePhase phase(gen->profiler, "packing", "page", pageId);
+
 #ifdef TRACE_GENERATE
 	trace << "Adding colored images\n";
 	trace.flush();
 #endif
 
 	// Add the colored images first
+	acUtility::CProfilePhase imagePhase(gen->profiler, "packing images", "page", pageId);
 	AddCharsToPage(chars, maxChars, true, 0);
+	imagePhase.End();
 
 	// Check if we should stop
 	if( gen->stopWorking ) return;
@@ -429,7 +634,7 @@ void CFontPage::AddChars(CFontChar **chars, int maxChars)
 	// Duplicate the height array for the other channels
 	for( int n = 1; n < 4; n++ )
 	{
-		heights[n] = new (std::nothrow) int[pageImg->width];
+		heights[n] = new (std::nothrow) int[pageWidth];
 		if( heights[n] == 0 )
 		{
 #ifdef TRACE_GENERATE
@@ -440,7 +645,7 @@ void CFontPage::AddChars(CFontChar **chars, int maxChars)
 			gen->outOfMemory = true;
 			return;
 		}
-		memcpy(heights[n], heights[0], pageImg->width*sizeof(int));
+		memcpy(heights[n], heights[0], pageWidth*sizeof(int));
 	}
 
 	// Remove the current holes
@@ -452,7 +657,12 @@ void CFontPage::AddChars(CFontChar **chars, int maxChars)
 #endif
 
 	// Then the black & white images
-	AddCharsToPage(chars, maxChars, false, 0);
+	acUtility::CProfilePhase channelPhase(gen->profiler, "packing channel", "page", pageId, "channel", 0);
+	if( gen->UseFrequencyOrder() )
+		AddCharsByFrequency(chars, maxChars, 0);
+	else
+		AddCharsToPage(chars, maxChars, false, 0);
+	channelPhase.End();
 
 	// Check if we should stop
 	if( gen->stopWorking ) return;
@@ -466,7 +676,12 @@ void CFontPage::AddChars(CFontChar **chars, int maxChars)
 	trace.flush();
 #endif
 
-			AddCharsToPage(chars, maxChars, false, n);
+			acUtility::CProfilePhase channelPhase(gen->profiler, "packing channel", "page", pageId, "channel", n);
+			if( gen->UseFrequencyOrder() )
+				AddCharsByFrequency(chars, maxChars, n);
+			else
+				AddCharsToPage(chars, maxChars, false, n);
+			channelPhase.End();
 
 			// Check if we should stop
 			if( gen->stopWorking ) return;
@@ -563,6 +778,7 @@ void CFontPage::AddCharsToPage(CFontChar **chars, int maxChars, bool colored, in
 
 				AddChar(x, y, chars[index[bestMatch]], channel);
 				chars[index[bestMatch]] = 0;
+				gen->profiler.AddCount("holes filled", 1);
 
 #ifdef TRACE_GENERATE
 				trace << "Character [" << index[bestMatch] << "] was used to fill hole\n";
@@ -682,17 +898,85 @@ void CFontPage::AddCharsToPage(CFontChar **chars, int maxChars, bool colored, in
 	}
 }
 
+// Orders the characters from the most to the least frequent
+struct SFrequencyOrder
+{
+	CFontChar    **chars;
+	const CFontGen *gen;
+
+	bool operator()(int a, int b) const
+	{
+		unsigned int fa = gen->GetCharFrequency(chars[a]->m_id);
+		unsigned int fb = gen->GetCharFrequency(chars[b]->m_id);
+		if( fa != fb )
+			return fa > fb;
+		return chars[a]->m_id < chars[b]->m_id;
+	}
+};
+
+// Adds the black & white images so the most frequent characters end up on the
+// first pages. The characters are added in bands, from the most frequent to 
+// the least, and the page is full as soon as a band doesn't fit completely. 
+// Within each band the characters are sorted by size as usual, and with each
+// band covering about an eighth of the page they are still packed densely.
+void CFontPage::AddCharsByFrequency(CFontChar **chars, int maxChars, int channel)
+{
+	vector<int> order;
+	for( int n = 0; n < maxChars; n++ )
+	{
+		if( chars[n] && chars[n]->m_isChar )
+			order.push_back(n);
+	}
+
+	SFrequencyOrder compare = {chars, gen};
+	std::sort(order.begin(), order.end(), compare);
+
+	double bandArea = double(pageWidth) * pageHeight / 8;
+	vector<CFontChar*> band;
+	size_t next = 0;
+	while( next < order.size() )
+	{
+		size_t first = next;
+		double area = 0;
+		band.clear();
+		while( next < order.size() && (band.empty() || area < bandArea) )
+		{
+			CFontChar *ch = chars[order[next++]];
+			area += double(ch->m_width + paddingLeft + paddingRight + spacingH) * (ch->m_height + paddingUp + paddingDown + spacingV);
+			band.push_back(ch);
+		}
+
+		AddCharsToPage(&band[0], (int)band.size(), false, channel);
+
+		// Check if we should stop
+		if( gen->stopWorking ) return;
+
+		// Remove the characters that were added from the list
+		bool allAdded = true;
+		for( size_t n = 0; n < band.size(); n++ )
+		{
+			if( band[n] == 0 )
+				chars[order[first+n]] = 0;
+			else
+				allAdded = false;
+		}
+
+		if( !allAdded )
+			break;
+	}
+}
+
 int CFontPage::DetermineStartX(CFontChar **chars, int *index, int numChars, int channel)
 {
 	int startX = 0;
 
 	// Determine if there is a large height difference anywhere, and if so start filling from that location
 	// This happens for example when importing images that are out of proportion to the rest of the glyphs
-	int thinnestChar = pageImg->width;
+	int thinnestChar = pageWidth;
 	for( int n = 0; n < numChars; n++ )
 		if( thinnestChar > (chars[index[n]]->m_width + paddingLeft + paddingRight + spacingH) )
 			thinnestChar = chars[index[n]]->m_width + paddingLeft + paddingRight + spacingH;
-	for( int n = 0; n < pageImg->width - 1 - thinnestChar; n++ )
+	for( int n = 0; n < pageWidth - 1 - thinnestChar; n++ )
 	{
 		// Compare against the largest glyph that we'll add (first in list)
 		if( heights[channel][n] - heights[channel][n+1] >= (chars[index[0]]->m_height + paddingUp + paddingDown + spacingV) )
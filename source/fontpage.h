@@ -30,6 +30,7 @@
 
 #include <vector>
 #include "ac_image.h"
+#include "acimg.h"
 
 class CFontChar;
 class CFontGen;
@@ -57,15 +58,25 @@ public:
 	void    AddChars(CFontChar **chars, int count);
 
 	void    GeneratePreviewTexture(int channel);
-	void    GenerateOutputTexture();
+	int     GenerateOutputTexture(acImage::Image &image);
 
 	cImage *GetPageImage();
 
+	// Frees the images of the characters on the page once it has been saved.
+	// The character metrics are kept for the font descriptor. Returns the
+	// number of bytes that were freed.
+	size_t  ReleaseCharImages();
+
+	// Draws the images of the characters that were only measured before the
+	// packing. The number of bytes drawn is added to drawn. Returns -1 if out of memory.
+	int     RedrawCharImages(HFONT font, size_t &drawn);
+
 protected:
 	void    AddChar(int x, int y, CFontChar *ch, int channel);
 	int     AddChar(CFontChar *ch, int channel);
 	void    SortList(CFontChar **ch, int *indices, int count);
 	void    AddCharsToPage(CFontChar **ch, int count, bool colored, int channel);
+	void    AddCharsByFrequency(CFontChar **ch, int count, int channel);
 	int     GetNextIdealImageWidth();
 	int     DetermineStartX(CFontChar **ch, int *indices, int count, int channel);
 
@@ -73,6 +84,8 @@ protected:
 
 	int     pageId;
 	cImage *pageImg;
+	int     pageWidth;
+	int     pageHeight;
 	int    *heights[4];
 	int     currX;
 	int     spacingH;
@@ -0,0 +1,202 @@
+/*
+   AngelCode Bitmap Font Generator
+   Copyright (c) 2004-2016 Andreas Jonsson
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any
+   damages arising from the use of this software.
+
+   Permission is granted to anyone to use this software for any
+   purpose, including commercial applications, and to alter it and
+   redistribute it freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you
+      must not claim that you wrote the original software. If you use
+      this software in a product, an acknowledgment in the product
+      documentation would be appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and
+      must not be misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+      distribution.
+
+   Andreas Jonsson
+   andreas@angelcode.com
+*/
+
+#include <assert.h>
+#include <stddef.h>
+#include "glyphmap.h"
+
+CGlyphMap::CGlyphMap()
+{
+	Clear();
+}
+
+void CGlyphMap::Clear()
+{
+	pageTable.assign((maxChar+1)/256, 0);
+	pages.assign(256, 0);
+	numMapped = 0;
+
+	glyphFirst.clear();
+	glyphChars.clear();
+}
+
+unsigned short *CGlyphMap::AllocPage(unsigned int page)
+{
+	if( pageTable[page] == 0 )
+	{
+		pageTable[page] = (unsigned short)(pages.size()/256);
+		pages.resize(pages.size() + 256, 0);
+	}
+
+	return &pages[(unsigned int)(pageTable[page])*256];
+}
+
+void CGlyphMap::Set(unsigned int ch, unsigned int glyph)
+{
+	// TrueType fonts cannot have more than 65535 glyphs
+	if( ch > maxChar || glyph > 0xFFFF )
+		return;
+
+	// The reverse index must be rebuilt after changes
+	glyphFirst.clear();
+	glyphChars.clear();
+
+	if( glyph == 0 )
+	{
+		// Don't allocate pages just to clear an entry
+		if( pageTable[ch>>8] == 0 )
+			return;
+	}
+
+	unsigned short *entry = AllocPage(ch>>8) + (ch&255);
+	if( *entry == 0 && glyph != 0 )
+		numMapped++;
+	else if( *entry != 0 && glyph == 0 )
+		numMapped--;
+	*entry = (unsigned short)glyph;
+}
+
+void CGlyphMap::SetRange(unsigned int firstCh, unsigned int lastCh, unsigned int firstGlyph)
+{
+	SetRange(firstCh, lastCh, firstGlyph, 1);
+}
+
+void CGlyphMap::FillRange(unsigned int firstCh, unsigned int lastCh, unsigned int glyph)
+{
+	SetRange(firstCh, lastCh, glyph, 0);
+}
+
+void CGlyphMap::SetRange(unsigned int firstCh, unsigned int lastCh, unsigned int firstGlyph, unsigned int step)
+{
+	if( lastCh > maxChar )
+		lastCh = maxChar;
+	if( firstCh > lastCh )
+		return;
+
+	// Fill one page at a time
+	unsigned int ch = firstCh;
+	while( ch <= lastCh )
+	{
+		unsigned int pageEnd = (ch | 255) < lastCh ? (ch | 255) : lastCh;
+		unsigned int glyph = firstGlyph + (ch - firstCh)*step;
+		if( glyph > 0xFFFF )
+			break;
+		if( glyph + (pageEnd - ch)*step > 0xFFFF )
+			pageEnd = ch + (0xFFFF - glyph);
+
+		unsigned short *page = AllocPage(ch>>8);
+		for( ; ch <= pageEnd; ch++, glyph += step )
+		{
+			unsigned short &entry = page[ch&255];
+			if( entry == 0 && glyph != 0 )
+				numMapped++;
+			else if( entry != 0 && glyph == 0 )
+				numMapped--;
+			entry = (unsigned short)glyph;
+		}
+
+		// Avoid wrapping around if the range ends at the last code point
+		if( pageEnd == maxChar )
+			break;
+	}
+
+	glyphFirst.clear();
+	glyphChars.clear();
+}
+
+int CGlyphMap::FindNext(unsigned int ch) const
+{
+	while( ch <= maxChar )
+	{
+		unsigned int page = pageTable[ch>>8];
+		if( page == 0 )
+		{
+			// Skip the whole empty page
+			ch = (ch | 255) + 1;
+			continue;
+		}
+
+		const unsigned short *entries = &pages[page*256];
+		for( unsigned int n = ch&255; n < 256; n++ )
+		{
+			if( entries[n] )
+				return int((ch & ~255u) | n);
+		}
+		ch = (ch | 255) + 1;
+	}
+
+	return -1;
+}
+
+void CGlyphMap::Finalize()
+{
+	// Determine the highest glyph id in use
+	unsigned int maxGlyph = 0;
+	for( size_t n = 256; n < pages.size(); n++ )
+		if( pages[n] > maxGlyph )
+			maxGlyph = pages[n];
+
+	// Count the code points for each glyph, then turn the counts into offsets
+	glyphFirst.assign(maxGlyph+2, 0);
+	for( size_t n = 256; n < pages.size(); n++ )
+		if( pages[n] )
+			glyphFirst[pages[n]+1]++;
+	for( unsigned int g = 1; g < glyphFirst.size(); g++ )
+		glyphFirst[g] += glyphFirst[g-1];
+
+	// Fill in the code points in increasing order
+	glyphChars.resize(glyphFirst.back());
+	std::vector<unsigned int> fill(glyphFirst.begin(), glyphFirst.end()-1);
+	for( unsigned int page = 0; page < pageTable.size(); page++ )
+	{
+		if( pageTable[page] == 0 )
+			continue;
+
+		const unsigned short *entries = &pages[(unsigned int)(pageTable[page])*256];
+		for( unsigned int n = 0; n < 256; n++ )
+		{
+			if( entries[n] )
+				glyphChars[fill[entries[n]]++] = page*256 + n;
+		}
+	}
+}
+
+unsigned int CGlyphMap::GetCharCount(unsigned int glyph) const
+{
+	if( glyph == 0 || glyph+1 >= glyphFirst.size() )
+		return 0;
+
+	return glyphFirst[glyph+1] - glyphFirst[glyph];
+}
+
+const unsigned int *CGlyphMap::GetChars(unsigned int glyph) const
+{
+	if( GetCharCount(glyph) == 0 )
+		return 0;
+
+	return &glyphChars[glyphFirst[glyph]];
+}
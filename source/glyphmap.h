@@ -0,0 +1,95 @@
+/*
+   AngelCode Bitmap Font Generator
+   Copyright (c) 2004-2016 Andreas Jonsson
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any
+   damages arising from the use of this software.
+
+   Permission is granted to anyone to use this software for any
+   purpose, including commercial applications, and to alter it and
+   redistribute it freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you
+      must not claim that you wrote the original software. If you use
+      this software in a product, an acknowledgment in the product
+      documentation would be appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and
+      must not be misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+      distribution.
+
+   Andreas Jonsson
+   andreas@angelcode.com
+*/
+
+#ifndef GLYPHMAP_H
+#define GLYPHMAP_H
+
+#include <vector>
+
+// Maps Unicode code points to glyph ids with a two-level page table, so
+// a lookup is always two array reads no matter how many characters the font
+// has. Code points are split into pages of 256 characters, and pages that
+// hold no glyphs all share the same empty page.
+//
+// Glyph id 0 is the missing glyph, so it is used to mark code points that
+// are not mapped. The map is filled in when the font is loaded, after which
+// Finalize() builds the reverse index from glyph ids to code points. Once
+// finalized the map is only read, so it can be shared by the worker threads.
+class CGlyphMap
+{
+public:
+	CGlyphMap();
+
+	void Clear();
+
+	// Map a single code point, or a range of code points to consecutive glyph ids
+	void Set(unsigned int ch, unsigned int glyph);
+	void SetRange(unsigned int firstCh, unsigned int lastCh, unsigned int firstGlyph);
+
+	// Map a range of code points to the same glyph id
+	void FillRange(unsigned int firstCh, unsigned int lastCh, unsigned int glyph);
+
+	// Build the reverse index from glyph ids to code points
+	void Finalize();
+
+	// Returns 0 if the code point isn't mapped
+	unsigned int GetGlyph(unsigned int ch) const
+	{
+		if( ch > maxChar ) return 0;
+		return pages[(unsigned int)(pageTable[ch>>8])*256 + (ch&255)];
+	}
+	bool Exists(unsigned int ch) const { return GetGlyph(ch) != 0; }
+
+	bool         IsEmpty() const { return numMapped == 0; }
+	unsigned int GetCount() const { return numMapped; }
+
+	// Returns the first mapped code point at or after ch, or -1 if there are none
+	int FindNext(unsigned int ch) const;
+
+	// Multiple code points may use the same glyph, e.g. space, 32, and hard space, 160.
+	// The code points are returned in increasing order. Only valid after Finalize().
+	unsigned int        GetNumGlyphs() const { return glyphFirst.empty() ? 0 : (unsigned int)glyphFirst.size()-1; }
+	unsigned int        GetCharCount(unsigned int glyph) const;
+	const unsigned int *GetChars(unsigned int glyph) const;
+
+	static const unsigned int maxChar = 0x10FFFF;
+
+protected:
+	unsigned short *AllocPage(unsigned int page);
+	void            SetRange(unsigned int firstCh, unsigned int lastCh, unsigned int firstGlyph, unsigned int step);
+
+	// Index into the pages for each block of 256 code points. Page 0 is the shared empty page
+	std::vector<unsigned short> pageTable;
+	std::vector<unsigned short> pages;
+	unsigned int                numMapped;
+
+	// Reverse index, stored as offsets into a single array of code points
+	std::vector<unsigned int>   glyphFirst;
+	std::vector<unsigned int>   glyphChars;
+};
+
+#endif
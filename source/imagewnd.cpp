@@ -54,6 +54,11 @@ cImageWnd::cImageWnd() : CWindow()
 
 void cImageWnd::CopyImage(cImage *img)
 {
+	// The page may have been streamed to disk, or there 
+	// may not have been memory enough for the preview
+	if( img == 0 )
+		return;
+
 	originalImage.Create(img->width, img->height);
 
 	memcpy(originalImage.pixels, img->pixels, img->width*img->height*4);
@@ -199,38 +199,23 @@ void CInspectFont::OnViewGSUB()
 
 	// Read GSUB table and add to list view
 	// ref: https://www.microsoft.com/typography/otspec/gsub.htm
-	HDC dc = GetDC(NULL);
-	HFONT font = fontGen->CreateFont(20);
-	HFONT oldFont = (HFONT)SelectObject(dc, font);
-
-	vector<BYTE> buffer;
-	DWORD GSUB = TAG('G', 'S', 'U', 'B');
-	DWORD size = GetFontData(dc, GSUB, 0, 0, 0);
-	if (size != GDI_ERROR)
-	{
-		buffer.resize(size);
-		size = GetFontData(dc, GSUB, 0, &buffer[0], size);
-		if (size == GDI_ERROR)
-		{
-			SelectObject(dc, oldFont);
-			DeleteObject(font);
-			return;
-		}
-	}
-
-	WORD majorVersion = GETUSHORT(&buffer[0]);
-	assert(majorVersion == 0x0001);
+	COpenTypeView gsub = fontGen->GetOpenTypeFont().GetTable(OT_TAG('G', 'S', 'U', 'B'));
+	if (gsub.IsEmpty())
+		return;
 
-	WORD minorVersion = GETUSHORT(&buffer[2]);
-	assert(minorVersion == 0 || minorVersion == 1);
+	WORD majorVersion = gsub.U16(0);
+	WORD minorVersion = gsub.U16(2);
+	if (majorVersion != 0x0001)
+		return;
 
-	WORD offsetScriptList = GETUSHORT(&buffer[4]);
-	WORD offsetFeatureList = GETUSHORT(&buffer[6]);
-	WORD offsetLookupList = GETUSHORT(&buffer[8]);
-	DWORD offsetFeatureVariations = minorVersion == 1 ? GETUINT(&buffer[10]) : 0;
+	WORD offsetScriptList = gsub.U16(4);
+	WORD offsetFeatureList = gsub.U16(6);
+	WORD offsetLookupList = gsub.U16(8);
+	DWORD offsetFeatureVariations = minorVersion == 1 ? gsub.U32(10) : 0;
 
 	// Determine how many different scripts are supported
-	WORD scriptCount = GETUSHORT(&buffer[offsetScriptList]);
+	COpenTypeView scriptList = gsub.Sub(offsetScriptList);
+	WORD scriptCount = scriptList.U16(0);
 
 	{
 		listView->InsertItem(listViewCount, "Script count");
@@ -247,7 +232,7 @@ void CInspectFont::OnViewGSUB()
 			if (n > 0)
 				s << ", ";
 
-			DWORD tag = GETUINT(&buffer[offsetScriptList + 2 + n * 6]);
+			DWORD tag = scriptList.U32(2 + n * 6);
 			char name[5] = { 0 };
 			name[3] = tag & 0xFF;
 			name[2] = (tag >> 8) & 0xFF;
@@ -256,15 +241,12 @@ void CInspectFont::OnViewGSUB()
 
 			s << name;
 
-			WORD offset = GETUSHORT(&buffer[offsetScriptList + 2 + n * 6 + 4]);
+			WORD offset = scriptList.U16(2 + n * 6 + 4);
 		}
 
 		listView->InsertItem(listViewCount, "Script tags");
 		listView->SetItemText(listViewCount++, 1, s.str());
 	}
-
-	SelectObject(dc, oldFont);
-	DeleteObject(font);
 }
 
 void CInspectFont::OnInitMenuPopup(HMENU menu, int pos, BOOL isWindowMenu)
@@ -275,21 +257,9 @@ void CInspectFont::OnInitMenuPopup(HMENU menu, int pos, BOOL isWindowMenu)
 	CheckMenuItem(menu, ID_VIEW_GSUB, MF_BYCOMMAND  | (view == 3 ? MF_CHECKED : MF_UNCHECKED));
 
 	// Check if KERN, GPOS, GSUB tables are available and disable those that are not
-	HDC dc = GetDC(NULL);
-	HFONT font = fontGen->CreateFont(20);
-	HFONT oldFont = (HFONT)SelectObject(dc, font);
-
-	DWORD KERN = TAG('k', 'e', 'r', 'n');
-	DWORD size = GetFontData(dc, KERN, 0, 0, 0);
-	EnableMenuItem(menu, ID_VIEW_KERN, MF_BYCOMMAND | (size != GDI_ERROR ? MF_ENABLED : MF_GRAYED));
-	DWORD GPOS = TAG('G', 'P', 'O', 'S');
-	size = GetFontData(dc, GPOS, 0, 0, 0);
-	EnableMenuItem(menu, ID_VIEW_GPOS, MF_BYCOMMAND | (size != GDI_ERROR ? MF_ENABLED : MF_GRAYED));
-	DWORD GSUB = TAG('G', 'S', 'U', 'B');
-	size = GetFontData(dc, GSUB, 0, 0, 0);
-	EnableMenuItem(menu, ID_VIEW_GSUB, MF_BYCOMMAND | (size != GDI_ERROR ? MF_ENABLED : MF_GRAYED));
-
-	SelectObject(dc, oldFont);
-	DeleteObject(font);
+	const COpenTypeFont &font = fontGen->GetOpenTypeFont();
+	EnableMenuItem(menu, ID_VIEW_KERN, MF_BYCOMMAND | (font.HasTable(OT_TAG('k', 'e', 'r', 'n')) ? MF_ENABLED : MF_GRAYED));
+	EnableMenuItem(menu, ID_VIEW_GPOS, MF_BYCOMMAND | (font.HasTable(OT_TAG('G', 'P', 'O', 'S')) ? MF_ENABLED : MF_GRAYED));
+	EnableMenuItem(menu, ID_VIEW_GSUB, MF_BYCOMMAND | (font.HasTable(OT_TAG('G', 'S', 'U', 'B')) ? MF_ENABLED : MF_GRAYED));
 }
 
@@ -26,15 +26,56 @@
 */
 
 #include <windows.h>
+#include <psapi.h>
 #include <crtdbg.h>
 #include <string>
 #include <iostream>
 
 #include "dynamic_funcs.h"
 #include "charwin.h"
+#include "buildcache.h"
+#include "benchmark.h"
+#include "regression.h"
 
 using namespace std;
 
+// Lists the files that were updated, so it is easy to see what an incremental build changed
+static void reportOutput(const vector<string> &changed, const vector<string> &unchanged)
+{
+	for( size_t n = 0; n < changed.size(); n++ )
+		cout << "Updated " << changed[n] << endl;
+	cout << changed.size() << " file(s) updated, " << unchanged.size() << " unchanged." << endl;
+}
+
+// Shows where the time was spent, and optionally writes the details to a trace file
+static void reportProfile(CFontGen *fontGen, const string &traceFile)
+{
+	if( !fontGen->GetProfiling() )
+		return;
+
+	vector<acUtility::CProfiler::SPhaseTotal> phases;
+	fontGen->GetProfiler().GetPhaseTotals(phases);
+	for( size_t n = 0; n < phases.size(); n++ )
+		cout << phases[n].name << ": " << phases[n].duration/1000.0 << " ms in " << phases[n].count << " call(s)" << endl;
+
+	vector<acUtility::CProfiler::SCounter> counters;
+	fontGen->GetProfiler().GetCounters(counters);
+	for( size_t n = 0; n < counters.size(); n++ )
+		cout << counters[n].name << ": " << counters[n].value << endl;
+
+	if( traceFile != "" && fontGen->GetProfiler().WriteChromeTrace(traceFile) < 0 )
+		cerr << "Failed to write the trace file." << endl;
+}
+
+// Shows the most memory the process has used, so a memory budget can be chosen
+static void reportPeakMemory()
+{
+	PROCESS_MEMORY_COUNTERS counters;
+	counters.cb = sizeof(counters);
+	if( GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) )
+		cout << "Peak memory: " << (unsigned long long)(counters.PeakWorkingSetSize/1024/1024) << " MB" << endl;
+}
+
 const char *getArgValue(const char *cmdLine, string &value)
 {
 	cmdLine += strspn(cmdLine, " \t");
@@ -55,11 +96,20 @@ const char *getArgValue(const char *cmdLine, string &value)
 	return cmdLine;
 }
 
-// Returns true if the GUI should be opened
-bool processCmdLine(const char *cmdLine, string &configFile)
+// Returns true if the GUI should be opened. The exit code is set 
+// when the work done on the command line failed
+bool processCmdLine(const char *cmdLine, string &configFile, int &exitCode)
 {
 	string outputFile;
-	string textFile;
+	vector<string> textFiles;
+	string cacheDir;
+	string benchmarkFile;
+	string traceFile;
+	string memoryBudget;
+	string suiteFile;
+	CRegression::EMode suiteMode = CRegression::MODE_EXACT;
+	bool   profile = false;
+	bool   streamPages = false;
 
 	configFile = CCharWin::GetDefaultConfig(); // Use the last configuration from the GUI as default
 
@@ -83,7 +133,42 @@ bool processCmdLine(const char *cmdLine, string &configFile)
 			else if( *cmdLine == 'c' )
 				cmdLine = getArgValue(++cmdLine, configFile);
 			else if( *cmdLine == 't' )
+			{
+				string textFile;
 				cmdLine = getArgValue(++cmdLine, textFile);
+				textFiles.push_back(textFile);
+			}
+			else if( *cmdLine == 'd' )
+				cmdLine = getArgValue(++cmdLine, cacheDir);
+			else if( *cmdLine == 'b' )
+				cmdLine = getArgValue(++cmdLine, benchmarkFile);
+			else if( *cmdLine == 'r' )
+			{
+				cmdLine = getArgValue(++cmdLine, traceFile);
+				profile = true;
+			}
+			else if( *cmdLine == 'v' || *cmdLine == 'w' || *cmdLine == 'u' )
+			{
+				// Compare the output with the baseline, or update the baseline
+				if( *cmdLine == 'w' )      suiteMode = CRegression::MODE_NO_WORSE;
+				else if( *cmdLine == 'u' ) suiteMode = CRegression::MODE_UPDATE;
+				else                       suiteMode = CRegression::MODE_EXACT;
+				cmdLine = getArgValue(++cmdLine, suiteFile);
+			}
+			else if( *cmdLine == 'm' )
+				cmdLine = getArgValue(++cmdLine, memoryBudget);
+			else if( *cmdLine == 'p' )
+			{
+				// Show the time spent in each phase of the generation
+				profile = true;
+				cmdLine++;
+			}
+			else if( *cmdLine == 's' )
+			{
+				// Save each page as soon as it is filled to keep the memory low
+				streamPages = true;
+				cmdLine++;
+			}
 			else
 			{
 				hasError = true;
@@ -106,28 +191,111 @@ bool processCmdLine(const char *cmdLine, string &configFile)
 	freopen("CONOUT$","w",stdout);
 	freopen("CONOUT$","w",stderr);
 
-	if( hasError || outputFile == "" )
+	if( hasError || (outputFile == "" && benchmarkFile == "" && suiteFile == "") )
 	{
 		cerr << "Incorrect arguments. See documentation for instructions." << endl;
 		return false;
 	}
 
+	if( suiteFile != "" )
+	{
+		// Each configuration in the suite is loaded by the regression test itself
+		cout << "Running regression tests." << endl;
+		CRegression regression;
+		if( regression.Run(suiteFile, suiteMode) != 0 )
+		{
+			// Fail the process so scripts and build jobs see the regression
+			cerr << "The regression tests failed." << endl;
+			exitCode = 1;
+		}
+
+		cout << "Finished." << endl;
+
+		return false;
+	}
+
 	CFontGen *fontGen = new CFontGen();
 
 	cout << "Loading config." << endl;
+	long long loadStart = fontGen->GetProfiler().GetTime();
 	fontGen->LoadConfiguration(configFile.c_str());
 
-	if( textFile != "" )
+	// The profiling can also be enabled by the configuration
+	if( profile )
+		fontGen->SetProfiling(true);
+	fontGen->GetProfiler().AddPhase("load configuration", loadStart);
+
+	// The memory budget on the command line overrides the one in the configuration
+	if( memoryBudget != "" )
+		fontGen->SetMemoryBudget(atoi(memoryBudget.c_str()));
+
+	if( textFiles.size() )
 	{
-		cout << "Selecting characters from file." << endl;
-		fontGen->SelectCharsFromFile(textFile.c_str());
+		cout << "Selecting characters from files." << endl;
+		if( fontGen->SelectCharsFromFiles(textFiles) < 0 )
+			cerr << "Failed to read some of the text files." << endl;
+	}
+
+	if( benchmarkFile != "" )
+	{
+		// The benchmarks use the font and characters of the configuration for the real workloads
+		cout << "Running benchmarks." << endl;
+		CBenchmark benchmark(fontGen);
+		if( benchmark.Run(benchmarkFile) < 0 )
+			cerr << "Failed to write the benchmark results." << endl;
+
+		delete fontGen;
+		cout << "Finished." << endl;
+
+		return false;
+	}
+
+	// Restore the files from the build cache if the same font has been built before
+	CBuildCache cache(cacheDir);
+	string buildKey;
+	if( cacheDir != "" && fontGen->GetBuildKey(outputFile.c_str(), buildKey) == 0 )
+	{
+		vector<string> changed, unchanged;
+		int r = cache.Restore(buildKey, outputFile, changed, unchanged);
+		if( r > 0 )
+		{
+			cout << "Restored font from build cache." << endl;
+			reportOutput(changed, unchanged);
+			reportProfile(fontGen, traceFile);
+
+			delete fontGen;
+			cout << "Finished." << endl;
+
+			return false;
+		}
+		else if( r < 0 )
+			cerr << "Failed to restore the font from the build cache." << endl;
+	}
+
+	if( streamPages )
+	{
+		cout << "Streaming pages to disk." << endl;
+		fontGen->SetStreamedOutput(outputFile.c_str());
 	}
 
 	cout << "Generating pages." << endl;
 	fontGen->GeneratePages(false);
 
 	cout << "Saving font." << endl;
-	fontGen->SaveFont(outputFile.c_str());
+	if( fontGen->SaveFont(outputFile.c_str()) < 0 )
+		cerr << "Failed to save the font." << endl;
+	else if( buildKey != "" )
+	{
+		// Add the complete build to the cache for the next time
+		vector<string> files = fontGen->GetChangedFiles();
+		files.insert(files.end(), fontGen->GetUnchangedFiles().begin(), fontGen->GetUnchangedFiles().end());
+		if( cache.Store(buildKey, files) < 0 )
+			cerr << "Failed to store the font in the build cache." << endl;
+	}
+
+	reportOutput(fontGen->GetChangedFiles(), fontGen->GetUnchangedFiles());
+	reportProfile(fontGen, traceFile);
+	reportPeakMemory();
 
 	delete fontGen;
 	cout << "Finished." << endl;
@@ -149,7 +317,8 @@ int WINAPI WinMain(HINSTANCE hInst,
 	Init();
 
 	string configFile;
-	bool openGui = processCmdLine(cmdLine, configFile);
+	int exitCode = 0;
+	bool openGui = processCmdLine(cmdLine, configFile, exitCode);
 
 	if( openGui )
 	{
@@ -161,5 +330,5 @@ int WINAPI WinMain(HINSTANCE hInst,
 
 	Uninit();
 
-	return 0;
+	return exitCode;
 }
@@ -0,0 +1,361 @@
+/*
+   AngelCode Bitmap Font Generator
+   Copyright (c) 2004-2016 Andreas Jonsson
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any
+   damages arising from the use of this software.
+
+   Permission is granted to anyone to use this software for any
+   purpose, including commercial applications, and to alter it and
+   redistribute it freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you
+      must not claim that you wrote the original software. If you use
+      this software in a product, an acknowledgment in the product
+      documentation would be appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and
+      must not be misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+      distribution.
+
+   Andreas Jonsson
+   andreas@angelcode.com
+*/
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include <string.h>
+#include "opentype.h"
+
+// ref: https://docs.microsoft.com/en-us/typography/opentype/spec/otff
+
+COpenTypeView COpenTypeView::Sub(unsigned int offset) const
+{
+	if( offset > size )
+	{
+		error = true;
+		COpenTypeView empty;
+		empty.error = true;
+		return empty;
+	}
+
+	return COpenTypeView(data + offset, size - offset);
+}
+
+COpenTypeView COpenTypeView::Sub(unsigned int offset, unsigned int length) const
+{
+	if( !Has(offset, length) )
+	{
+		error = true;
+		COpenTypeView empty;
+		empty.error = true;
+		return empty;
+	}
+
+	return COpenTypeView(data + offset, length);
+}
+
+COpenTypeFont::COpenTypeFont()
+{
+	mapping    = 0;
+	fileHandle = 0;
+	mappedSize = 0;
+	face       = 0;
+}
+
+COpenTypeFont::~COpenTypeFont()
+{
+	Close();
+}
+
+void COpenTypeFont::Close()
+{
+#ifdef _WIN32
+	if( file.GetData() && mapping )
+		UnmapViewOfFile(file.GetData());
+	if( mapping )
+		CloseHandle((HANDLE)mapping);
+	if( fileHandle )
+		CloseHandle((HANDLE)fileHandle);
+#else
+	if( mapping )
+		munmap(mapping, mappedSize);
+	if( fileHandle )
+		close((int)(size_t)fileHandle - 1);
+#endif
+	mapping    = 0;
+	fileHandle = 0;
+	mappedSize = 0;
+
+	ownedData.clear();
+	filename.clear();
+	file = COpenTypeView();
+
+	faceOffsets.clear();
+	face = 0;
+	tables.clear();
+	head = maxp = COpenTypeView();
+}
+
+bool COpenTypeFont::IsOpen() const
+{
+	return !tables.empty();
+}
+
+const std::string &COpenTypeFont::GetFileName() const
+{
+	return filename;
+}
+
+const COpenTypeView &COpenTypeFont::GetFileData() const
+{
+	return file;
+}
+
+int COpenTypeFont::Open(const std::string &filename, unsigned int face)
+{
+	// Don't map the same file again
+	if( filename != "" && filename == this->filename && file.GetData() )
+		return SelectFace(face);
+
+	Close();
+
+	if( MapFile(filename) < 0 )
+	{
+		Close();
+		return -1;
+	}
+	this->filename = filename;
+
+	if( ParseHeader() < 0 || SelectFace(face) < 0 )
+	{
+		Close();
+		return -1;
+	}
+
+	return 0;
+}
+
+int COpenTypeFont::Load(std::vector<unsigned char> &data, unsigned int face)
+{
+	Close();
+
+	if( data.empty() )
+		return -1;
+
+	ownedData.swap(data);
+	file = COpenTypeView(&ownedData[0], (unsigned int)ownedData.size());
+
+	if( ParseHeader() < 0 || SelectFace(face) < 0 )
+	{
+		Close();
+		return -1;
+	}
+
+	return 0;
+}
+
+int COpenTypeFont::MapFile(const std::string &filename)
+{
+#ifdef _WIN32
+	// The file name is in UTF8
+	WCHAR buf[MAX_PATH];
+	if( MultiByteToWideChar(CP_UTF8, 0, filename.c_str(), -1, buf, MAX_PATH) == 0 )
+		return -1;
+
+	HANDLE f = CreateFileW(buf, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if( f == INVALID_HANDLE_VALUE )
+		return -1;
+	fileHandle = f;
+
+	LARGE_INTEGER size;
+	if( !GetFileSizeEx(f, &size) || size.QuadPart == 0 || size.QuadPart > 0x7FFFFFFF )
+		return -1;
+
+	HANDLE m = CreateFileMapping(f, 0, PAGE_READONLY, 0, 0, 0);
+	if( m == 0 )
+		return -1;
+	mapping = m;
+
+	void *view = MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0);
+	if( view == 0 )
+		return -1;
+
+	mappedSize = (size_t)size.QuadPart;
+	file = COpenTypeView((const unsigned char*)view, (unsigned int)mappedSize);
+#else
+	int f = open(filename.c_str(), O_RDONLY);
+	if( f < 0 )
+		return -1;
+	// Store the descriptor offset by one so 0 means no file
+	fileHandle = (void*)(size_t)(f + 1);
+
+	struct stat st;
+	if( fstat(f, &st) < 0 || st.st_size == 0 || st.st_size > 0x7FFFFFFF )
+		return -1;
+
+	void *view = mmap(0, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, f, 0);
+	if( view == MAP_FAILED )
+		return -1;
+
+	mapping    = view;
+	mappedSize = (size_t)st.st_size;
+	file = COpenTypeView((const unsigned char*)view, (unsigned int)mappedSize);
+#endif
+
+	return 0;
+}
+
+int COpenTypeFont::ParseHeader()
+{
+	faceOffsets.clear();
+
+	unsigned int tag = file.U32(0);
+	if( tag == OT_TAG('t','t','c','f') )
+	{
+		// A collection has a list of offsets to the fonts in it
+		unsigned int numFonts = file.U32(8);
+		if( numFonts == 0 || !file.Has(12, numFonts*4) )
+			return -1;
+
+		faceOffsets.reserve(numFonts);
+		for( unsigned int n = 0; n < numFonts; n++ )
+			faceOffsets.push_back(file.U32(12 + n*4));
+	}
+	else if( tag == 0x00010000 || tag == OT_TAG('O','T','T','O') || tag == OT_TAG('t','r','u','e') )
+		faceOffsets.push_back(0);
+	else
+		return -1;
+
+	return file.HasError() ? -1 : 0;
+}
+
+COpenTypeView COpenTypeFont::GetDirectory(unsigned int face) const
+{
+	if( face >= faceOffsets.size() )
+		return COpenTypeView();
+
+	// The offset table is followed by the table records
+	COpenTypeView dir = file.Sub(faceOffsets[face]);
+	unsigned int numTables = dir.U16(4);
+	return dir.Sub(0, 12 + numTables*16);
+}
+
+int COpenTypeFont::SelectFace(unsigned int face)
+{
+	if( face >= faceOffsets.size() )
+		return -1;
+
+	if( face == this->face && !tables.empty() )
+		return 0;
+
+	return ParseFace(face);
+}
+
+int COpenTypeFont::ParseFace(unsigned int face)
+{
+	tables.clear();
+	head = maxp = COpenTypeView();
+
+	COpenTypeView dir = GetDirectory(face);
+	if( dir.IsEmpty() || dir.HasError() )
+		return -1;
+
+	this->face = face;
+
+	unsigned int numTables = dir.U16(4);
+	tables.reserve(numTables);
+	for( unsigned int n = 0; n < numTables; n++ )
+	{
+		STableRecord rec;
+		rec.tag    = dir.U32(12 + n*16);
+		rec.offset = dir.U32(12 + n*16 + 8);
+		rec.length = dir.U32(12 + n*16 + 12);
+
+		// Skip tables that are not within the file. The offsets
+		// are always from the start of the file, even in collections
+		if( !file.Has(rec.offset, rec.length) )
+			continue;
+
+		tables.push_back(rec);
+	}
+
+	if( tables.empty() )
+		return -1;
+
+	head = GetTable(OT_TAG('h','e','a','d'));
+	maxp = GetTable(OT_TAG('m','a','x','p'));
+
+	return 0;
+}
+
+unsigned int COpenTypeFont::GetNumFaces() const
+{
+	return (unsigned int)faceOffsets.size();
+}
+
+unsigned int COpenTypeFont::GetFace() const
+{
+	return face;
+}
+
+int COpenTypeFont::FindFace(const unsigned char *directory, unsigned int size) const
+{
+	for( unsigned int n = 0; n < faceOffsets.size(); n++ )
+	{
+		COpenTypeView dir = GetDirectory(n);
+		if( dir.GetSize() == size && memcmp(dir.GetData(), directory, size) == 0 )
+			return int(n);
+	}
+
+	return -1;
+}
+
+COpenTypeView COpenTypeFont::GetTable(unsigned int tag) const
+{
+	for( size_t n = 0; n < tables.size(); n++ )
+	{
+		if( tables[n].tag == tag )
+			return file.Sub(tables[n].offset, tables[n].length);
+	}
+
+	return COpenTypeView();
+}
+
+bool COpenTypeFont::HasTable(unsigned int tag) const
+{
+	for( size_t n = 0; n < tables.size(); n++ )
+	{
+		if( tables[n].tag == tag )
+			return true;
+	}
+
+	return false;
+}
+
+unsigned int COpenTypeFont::GetNumGlyphs() const
+{
+	return maxp.U16(4);
+}
+
+int COpenTypeFont::GetFontBox(short &xMin, short &yMin, short &xMax, short &yMax) const
+{
+	if( !head.Has(36, 8) )
+		return -1;
+
+	xMin = head.S16(36);
+	yMin = head.S16(38);
+	xMax = head.S16(40);
+	yMax = head.S16(42);
+
+	return 0;
+}
@@ -0,0 +1,152 @@
+/*
+   AngelCode Bitmap Font Generator
+   Copyright (c) 2004-2016 Andreas Jonsson
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any
+   damages arising from the use of this software.
+
+   Permission is granted to anyone to use this software for any
+   purpose, including commercial applications, and to alter it and
+   redistribute it freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you
+      must not claim that you wrote the original software. If you use
+      this software in a product, an acknowledgment in the product
+      documentation would be appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and
+      must not be misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+      distribution.
+
+   Andreas Jonsson
+   andreas@angelcode.com
+*/
+
+#ifndef OPENTYPE_H
+#define OPENTYPE_H
+
+#include <string>
+#include <vector>
+
+// Tags are given in the order they are written, e.g. OT_TAG('c','m','a','p')
+#define OT_TAG(a,b,c,d) ((unsigned int)(((a)<<24) | ((b)<<16) | ((c)<<8) | (d)))
+
+// A read only view of a part of the font data. The values are read in big
+// endian order directly from the font data without copying it. Reading
+// outside the view returns 0 and sets the error flag, so a malformed font can
+// at most produce wrong values, but never cause reads outside the data.
+class COpenTypeView
+{
+public:
+	COpenTypeView() : data(0), size(0), error(false) {}
+	COpenTypeView(const unsigned char *data, unsigned int size) : data(data), size(size), error(false) {}
+
+	const unsigned char *GetData() const { return data; }
+	unsigned int         GetSize() const { return size; }
+	bool                 IsEmpty() const { return size == 0; }
+
+	// Returns true if any read has been attempted outside the view
+	bool HasError() const { return error; }
+
+	// Returns true if the range is within the view
+	bool Has(unsigned int offset, unsigned int length) const { return offset <= size && size - offset >= length; }
+
+	unsigned char  U8(unsigned int offset) const  { if( !Has(offset, 1) ) return Fail(); return data[offset]; }
+	unsigned short U16(unsigned int offset) const { if( !Has(offset, 2) ) return Fail(); return (unsigned short)((data[offset]<<8) | data[offset+1]); }
+	short          S16(unsigned int offset) const { return (short)U16(offset); }
+	unsigned int   U32(unsigned int offset) const { if( !Has(offset, 4) ) return Fail(); return ((unsigned int)data[offset]<<24) | ((unsigned int)data[offset+1]<<16) | ((unsigned int)data[offset+2]<<8) | data[offset+3]; }
+	int            S32(unsigned int offset) const { return (int)U32(offset); }
+
+	// Returns a view of the data from the offset to the end, or of the given length.
+	// If the range is not within this view the returned view is empty with the error flag set
+	COpenTypeView Sub(unsigned int offset) const;
+	COpenTypeView Sub(unsigned int offset, unsigned int length) const;
+
+protected:
+	unsigned char Fail() const { error = true; return 0; }
+
+	const unsigned char *data;
+	unsigned int         size;
+	mutable bool         error;
+};
+
+// Gives access to the tables of an OpenType or TrueType font, or one of the
+// fonts in a TrueType collection (.ttc). The font file is memory mapped so the
+// tables can be parsed directly from the file without loading them first.
+class COpenTypeFont
+{
+public:
+	COpenTypeFont();
+	~COpenTypeFont();
+
+	// Map the font file. Opening the file that is already open only selects the face
+	int  Open(const std::string &filename, unsigned int face = 0);
+
+	// Use font data that has already been loaded into memory. The data is moved into the object
+	int  Load(std::vector<unsigned char> &data, unsigned int face = 0);
+
+	void Close();
+	bool IsOpen() const;
+
+	const std::string &GetFileName() const;
+
+	// The complete font data, e.g. for identifying the font by its content
+	const COpenTypeView &GetFileData() const;
+
+	// Collections hold more than one face, ordinary font files only one
+	unsigned int GetNumFaces() const;
+	unsigned int GetFace() const;
+	int          SelectFace(unsigned int face);
+
+	// Returns the face whose offset table and table directory equals the given
+	// data, e.g. as returned by GetFontData(dc, 0, 0, ...), or -1 if none match
+	int          FindFace(const unsigned char *directory, unsigned int size) const;
+
+	// Returns an empty view if the table doesn't exist in the selected face
+	COpenTypeView GetTable(unsigned int tag) const;
+	bool          HasTable(unsigned int tag) const;
+
+	// Values from the common tables
+	unsigned int  GetNumGlyphs() const;
+	int           GetFontBox(short &xMin, short &yMin, short &xMax, short &yMax) const;
+
+protected:
+	struct STableRecord
+	{
+		unsigned int tag;
+		unsigned int offset;
+		unsigned int length;
+	};
+
+	int  MapFile(const std::string &filename);
+	int  ParseHeader();
+	int  ParseFace(unsigned int face);
+
+	COpenTypeView GetDirectory(unsigned int face) const;
+
+	// The complete font file
+	COpenTypeView              file;
+	std::string                filename;
+	std::vector<unsigned char> ownedData;
+	void                      *mapping;
+	void                      *fileHandle;
+	size_t                     mappedSize;
+
+	// Offsets of the faces in the file
+	std::vector<unsigned int>  faceOffsets;
+	unsigned int               face;
+
+	// The tables of the selected face, and the most commonly used ones
+	std::vector<STableRecord>  tables;
+	COpenTypeView              head;
+	COpenTypeView              maxp;
+
+private:
+	COpenTypeFont(const COpenTypeFont &);
+	COpenTypeFont &operator=(const COpenTypeFont &);
+};
+
+#endif
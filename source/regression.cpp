@@ -0,0 +1,388 @@
+/*
+   AngelCode Bitmap Font Generator
+   Copyright (c) 2004-2016 Andreas Jonsson
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any
+   damages arising from the use of this software.
+
+   Permission is granted to anyone to use this software for any
+   purpose, including commercial applications, and to alter it and
+   redistribute it freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you
+      must not claim that you wrote the original software. If you use
+      this software in a product, an acknowledgment in the product
+      documentation would be appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and
+      must not be misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+      distribution.
+
+   Andreas Jonsson
+   andreas@angelcode.com
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <iostream>
+#include "regression.h"
+#include "fontdesc.h"
+#include "acutil_file.h"
+#include "acutil_path.h"
+#include "acutil_parallel.h"
+#include "ac_string_util.h"
+
+using namespace std;
+
+// Removes the white space and line breaks around the text
+static string Trim(const char *line)
+{
+	string str = line;
+	size_t start = str.find_first_not_of(" \t\r\n");
+	if( start == string::npos )
+		return "";
+	size_t end = str.find_last_not_of(" \t\r\n");
+	return str.substr(start, end - start + 1);
+}
+
+// Returns the file name without the directory
+static string GetFileName(const string &path)
+{
+	size_t pos = path.find_last_of("/\\");
+	return pos == string::npos ? path : path.substr(pos + 1);
+}
+
+// Reads the descriptor back and verifies that it matches the generated pages
+static int CheckDescriptor(const string &filename, const vector<SPageStats> &pages)
+{
+	CFontDesc desc;
+	if( desc.Load(filename) < 0 )
+		return -1;
+
+	if( desc.common.pages != (int)pages.size() || desc.chars.empty() )
+		return -1;
+
+	for( size_t n = 0; n < desc.chars.size(); n++ )
+	{
+		const CFontDesc::SChar &ch = desc.chars[n];
+		if( ch.page >= pages.size() || ch.x + ch.width > desc.common.scaleW || ch.y + ch.height > desc.common.scaleH )
+			return -1;
+	}
+
+	return 0;
+}
+
+int CRegression::Run(const string &suiteFile, EMode mode)
+{
+	vector<string> configs;
+	if( ReadSuite(suiteFile, configs) < 0 )
+	{
+		cerr << "Failed to read the suite file." << endl;
+		return -1;
+	}
+
+	string base = suiteFile;
+	size_t ext = base.find_last_of('.');
+	if( ext != string::npos && ext > base.find_last_of("/\\") + 1 )
+		base = base.substr(0, ext);
+	string baselineFile = base + ".baseline";
+
+	vector<SResult> baseline;
+	if( mode != MODE_UPDATE && ReadBaseline(baselineFile, baseline) < 0 )
+	{
+		cerr << "Failed to read the baseline " << baselineFile << "." << endl;
+		return -1;
+	}
+
+	// The fonts are written next to the suite file with the same name each 
+	// time, so the file names in the descriptors don't differ between runs
+	string outputFile = acUtility::GetFullPath(suiteFile, "regression.fnt");
+
+	// An odd number of threads is included so the work isn't split evenly
+	unsigned int originalThreads = acUtility::GetMaxThreads();
+	vector<unsigned int> threadCounts;
+	threadCounts.push_back(1);
+	threadCounts.push_back(2);
+	threadCounts.push_back(3);
+	if( originalThreads > 3 )
+		threadCounts.push_back(originalThreads);
+
+	int numFailed = 0;
+	vector<SResult> results;
+	for( size_t c = 0; c < configs.size(); c++ )
+	{
+		cout << "Testing " << configs[c] << "." << endl;
+
+		SResult result;
+		for( size_t t = 0; t < threadCounts.size(); t++ )
+		{
+			acUtility::SetMaxThreads(threadCounts[t]);
+
+			SResult run;
+			run.config = configs[c];
+			if( GenerateFont(acUtility::GetFullPath(suiteFile, configs[c]), outputFile, run) < 0 )
+			{
+				cerr << "  Failed to generate the font with " << threadCounts[t] << " thread(s)." << endl;
+				result = run;
+				result.failed = true;
+				break;
+			}
+
+			if( t == 0 )
+				result = run;
+			else if( !IsSameOutput(run, result) )
+			{
+				cerr << "  The output with " << threadCounts[t] << " threads differs from the output with " << threadCounts[0] << " thread." << endl;
+				result.failed = true;
+			}
+		}
+
+		if( !result.failed && mode != MODE_UPDATE )
+		{
+			size_t b = 0;
+			for( ; b < baseline.size(); b++ )
+				if( baseline[b].config == configs[c] )
+					break;
+
+			if( b == baseline.size() )
+			{
+				cerr << "  There is no baseline for the configuration." << endl;
+				result.failed = true;
+			}
+			else if( !CompareWithBaseline(result, baseline[b], mode) )
+				result.failed = true;
+		}
+
+		long long total = 0;
+		for( size_t p = 0; p < result.pages.size(); p++ )
+			total += result.pages[p].totalArea;
+		if( total > 0 )
+			cout << "  " << result.pages.size() << " page(s), " << (total - GetWastedArea(result))*100.0/total << "% occupancy, " << GetWastedArea(result) << " pixels wasted." << endl;
+
+		if( result.failed )
+			numFailed++;
+		results.push_back(result);
+	}
+
+	acUtility::SetMaxThreads(originalThreads);
+
+	// A baseline is never recorded from output that failed, e.g. because it
+	// depends on the number of threads, as later runs would then compare to it
+	if( mode == MODE_UPDATE && numFailed > 0 )
+		cerr << "The baseline " << baselineFile << " was not updated as some configurations failed." << endl;
+	else if( mode == MODE_UPDATE )
+	{
+		if( WriteBaseline(baselineFile, results) < 0 )
+		{
+			cerr << "Failed to write the baseline " << baselineFile << "." << endl;
+			return -1;
+		}
+		cout << "Updated the baseline " << baselineFile << "." << endl;
+	}
+
+	cout << configs.size() - numFailed << " of " << configs.size() << " configuration(s) passed." << endl;
+
+	return numFailed;
+}
+
+// Empty lines and lines starting with # are ignored
+int CRegression::ReadSuite(const string &suiteFile, vector<string> &configs)
+{
+	FILE *f = 0;
+	if( fopen_s(&f, suiteFile.c_str(), "r") != 0 || f == 0 )
+		return -1;
+
+	char line[1024];
+	while( fgets(line, sizeof(line), f) )
+	{
+		string config = Trim(line);
+		if( config != "" && config[0] != '#' )
+			configs.push_back(config);
+	}
+
+	fclose(f);
+
+	return 0;
+}
+
+// The baseline has a config line for each configuration, followed by
+// a line for each page and a line for each of the files written
+int CRegression::ReadBaseline(const string &baselineFile, vector<SResult> &baseline)
+{
+	FILE *f = 0;
+	if( fopen_s(&f, baselineFile.c_str(), "r") != 0 || f == 0 )
+		return -1;
+
+	int r = 0;
+	char line[1024];
+	while( fgets(line, sizeof(line), f) && r >= 0 )
+	{
+		string str = Trim(line);
+		if( str == "" || str[0] == '#' )
+			continue;
+
+		if( str.compare(0, 7, "config=") == 0 )
+		{
+			baseline.push_back(SResult());
+			baseline.back().config = str.substr(7);
+			continue;
+		}
+
+		// The pages and files belong to the last configuration
+		if( baseline.empty() )
+		{
+			r = -1;
+			break;
+		}
+
+		SPageStats page;
+		SFile      file;
+		char       name[1024];
+		if( sscanf(str.c_str(), "page used=%lld total=%lld", &page.usedArea, &page.totalArea) == 2 )
+			baseline.back().pages.push_back(page);
+		else if( sscanf(str.c_str(), "file hash=%llx name=%1023[^\n]", &file.hash, name) == 2 )
+		{
+			file.name = name;
+			baseline.back().files.push_back(file);
+		}
+		else
+			r = -1;
+	}
+
+	fclose(f);
+
+	return r;
+}
+
+int CRegression::WriteBaseline(const string &baselineFile, const vector<SResult> &results)
+{
+	FILE *f = 0;
+	if( fopen_s(&f, baselineFile.c_str(), "w") != 0 || f == 0 )
+		return -1;
+
+	fprintf(f, "# AngelCode Bitmap Font Generator regression baseline\n");
+	fprintf(f, "# version %s\n", BMFONT_VERSION);
+
+	for( size_t n = 0; n < results.size(); n++ )
+	{
+		// A configuration that failed has no baseline, so it fails until fixed
+		const SResult &r = results[n];
+		if( r.failed )
+			continue;
+
+		fprintf(f, "\nconfig=%s\n", r.config.c_str());
+		for( size_t p = 0; p < r.pages.size(); p++ )
+			fprintf(f, "page used=%lld total=%lld\n", r.pages[p].usedArea, r.pages[p].totalArea);
+		for( size_t p = 0; p < r.files.size(); p++ )
+			fprintf(f, "file hash=%016llx name=%s\n", r.files[p].hash, r.files[p].name.c_str());
+	}
+
+	bool ok = ferror(f) == 0;
+	fclose(f);
+
+	return ok ? 0 : -1;
+}
+
+// Generates and saves the font, then hashes and removes the files
+int CRegression::GenerateFont(const string &configFile, const string &outputFile, SResult &result)
+{
+	CFontGen *fontGen = new CFontGen();
+
+	int r = fontGen->LoadConfiguration(configFile.c_str());
+	if( r >= 0 )
+		r = fontGen->GeneratePages(false);
+	if( r >= 0 )
+		r = fontGen->GetPageStats(result.pages);
+	if( r >= 0 )
+		r = fontGen->SaveFont(outputFile.c_str());
+
+	// The descriptor is listed first and the pages in order. The C++ header
+	// can't be read back, so it is only covered by the hash.
+	vector<string> files = fontGen->GetChangedFiles();
+	files.insert(files.end(), fontGen->GetUnchangedFiles().begin(), fontGen->GetUnchangedFiles().end());
+	if( r >= 0 && (files.empty() || (fontGen->GetFontDescFormat() != 4 && CheckDescriptor(files[0], result.pages) < 0)) )
+	{
+		cerr << "  The descriptor couldn't be read back." << endl;
+		r = -1;
+	}
+	for( size_t n = 0; n < files.size(); n++ )
+	{
+		SFile file;
+		file.name = GetFileName(files[n]);
+		if( r >= 0 && acUtility::HashFile(files[n], file.hash) < 0 )
+			r = -1;
+		result.files.push_back(file);
+		remove(files[n].c_str());
+	}
+
+	delete fontGen;
+
+	return r < 0 ? -1 : 0;
+}
+
+bool CRegression::CompareWithBaseline(const SResult &result, const SResult &baseline, EMode mode)
+{
+	if( mode == MODE_EXACT )
+	{
+		if( IsSameOutput(result, baseline) )
+			return true;
+
+		cerr << "  The output differs from the baseline." << endl;
+		for( size_t n = 0; n < result.files.size(); n++ )
+		{
+			size_t b = 0;
+			for( ; b < baseline.files.size(); b++ )
+				if( baseline.files[b].name == result.files[n].name )
+					break;
+			if( b == baseline.files.size() || baseline.files[b].hash != result.files[n].hash )
+				cerr << "  " << result.files[n].name << " has changed." << endl;
+		}
+		if( result.pages.size() != baseline.pages.size() )
+			cerr << "  The font has " << result.pages.size() << " page(s) instead of " << baseline.pages.size() << "." << endl;
+
+		return false;
+	}
+
+	// The output may change, as long as the packing is as good as before
+	bool ok = true;
+	if( result.pages.size() > baseline.pages.size() )
+	{
+		cerr << "  The font has " << result.pages.size() << " page(s) instead of " << baseline.pages.size() << "." << endl;
+		ok = false;
+	}
+	if( GetWastedArea(result) > GetWastedArea(baseline) )
+	{
+		cerr << "  The font wastes " << GetWastedArea(result) << " pixels instead of " << GetWastedArea(baseline) << "." << endl;
+		ok = false;
+	}
+
+	return ok;
+}
+
+bool CRegression::IsSameOutput(const SResult &a, const SResult &b)
+{
+	if( a.pages.size() != b.pages.size() || a.files.size() != b.files.size() )
+		return false;
+
+	for( size_t n = 0; n < a.pages.size(); n++ )
+		if( a.pages[n].usedArea != b.pages[n].usedArea || a.pages[n].totalArea != b.pages[n].totalArea )
+			return false;
+
+	for( size_t n = 0; n < a.files.size(); n++ )
+		if( a.files[n].name != b.files[n].name || a.files[n].hash != b.files[n].hash )
+			return false;
+
+	return true;
+}
+
+long long CRegression::GetWastedArea(const SResult &result)
+{
+	long long wasted = 0;
+	for( size_t n = 0; n < result.pages.size(); n++ )
+		wasted += result.pages[n].totalArea - result.pages[n].usedArea;
+
+	return wasted;
+}
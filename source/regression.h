@@ -0,0 +1,81 @@
+/*
+   AngelCode Bitmap Font Generator
+   Copyright (c) 2004-2016 Andreas Jonsson
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any
+   damages arising from the use of this software.
+
+   Permission is granted to anyone to use this software for any
+   purpose, including commercial applications, and to alter it and
+   redistribute it freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you
+      must not claim that you wrote the original software. If you use
+      this software in a product, an acknowledgment in the product
+      documentation would be appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and
+      must not be misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+      distribution.
+
+   Andreas Jonsson
+   andreas@angelcode.com
+*/
+
+#ifndef REGRESSION_H
+#define REGRESSION_H
+
+#include <string>
+#include <vector>
+#include "fontgen.h"
+
+// Generates the fonts of a fixed set of configurations and compares the 
+// output with a stored baseline, so changes to the packing or rasterization
+// can't change the output without being noticed. Each font is also generated
+// with different numbers of threads, which must all give the same output.
+class CRegression
+{
+public:
+	enum EMode
+	{
+		MODE_EXACT,    // The files must be identical to the baseline
+		MODE_NO_WORSE, // The files may change, but not use more pages or waste more area
+		MODE_UPDATE    // The baseline is replaced with the new output, unless a configuration failed
+	};
+
+	// The suite file lists the configuration files, one per line. The baseline
+	// is kept next to it with the extension .baseline. Returns the number of
+	// configurations that failed, or -1 if the files couldn't be read or written
+	int Run(const std::string &suiteFile, EMode mode);
+
+protected:
+	struct SFile
+	{
+		std::string        name;
+		unsigned long long hash;
+	};
+
+	struct SResult
+	{
+		SResult() {failed = false;}
+
+		std::string             config;
+		std::vector<SPageStats> pages;
+		std::vector<SFile>      files;
+		bool                    failed;
+	};
+
+	int  ReadSuite(const std::string &suiteFile, std::vector<std::string> &configs);
+	int  ReadBaseline(const std::string &baselineFile, std::vector<SResult> &baseline);
+	int  WriteBaseline(const std::string &baselineFile, const std::vector<SResult> &results);
+	int  GenerateFont(const std::string &configFile, const std::string &outputFile, SResult &result);
+	bool CompareWithBaseline(const SResult &result, const SResult &baseline, EMode mode);
+
+	static bool IsSameOutput(const SResult &a, const SResult &b);
+	static long long GetWastedArea(const SResult &result);
+};
+
+#endif
@@ -95,6 +95,9 @@
 #define IDC_ENABLEAA                            1050
 #define IDC_PRESETS                             1051
 #define IDC_FIXEDHEIGHT                         1052
+#define IDC_KERNCLASSES                         1053
+#define IDC_DESC_RUNTIME                        1054
+#define IDC_DESC_HEADER                         1055
 #define IDC_VIEW_SCALE_1_8                      40002
 #define IDC_VIEW_SCALE_1_2                      40003
 #define IDC_VIEW_SCALE_1_4                      40004
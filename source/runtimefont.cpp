@@ -0,0 +1,287 @@
+/*
+   AngelCode Bitmap Font Generator
+   Copyright (c) 2004-2016 Andreas Jonsson
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any
+   damages arising from the use of this software.
+
+   Permission is granted to anyone to use this software for any
+   purpose, including commercial applications, and to alter it and
+   redistribute it freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you
+      must not claim that you wrote the original software. If you use
+      this software in a product, an acknowledgment in the product
+      documentation would be appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and
+      must not be misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+      distribution.
+
+   Andreas Jonsson
+   andreas@angelcode.com
+*/
+
+#include <algorithm>
+#include "runtimefont.h"
+
+using namespace std;
+
+CRuntimeFontWriter::CRuntimeFontWriter()
+{
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "BMFR", 4);
+	header.version = RUNTIMEFONT_VERSION;
+}
+
+void CRuntimeFontWriter::SetCommon(int fontSize, int lineHeight, int base, int scaleW, int scaleH, bool packed, int alphaChnl, int redChnl, int greenChnl, int blueChnl)
+{
+	header.fontSize   = fontSize;
+	header.lineHeight = lineHeight;
+	header.base       = base;
+	header.scaleW     = scaleW;
+	header.scaleH     = scaleH;
+	header.packed     = packed ? 1 : 0;
+	header.alphaChnl  = (unsigned char)alphaChnl;
+	header.redChnl    = (unsigned char)redChnl;
+	header.greenChnl  = (unsigned char)greenChnl;
+	header.blueChnl   = (unsigned char)blueChnl;
+}
+
+void CRuntimeFontWriter::SetFaceName(const string &name)
+{
+	faceName = name;
+}
+
+void CRuntimeFontWriter::AddPage(const string &file)
+{
+	pageFiles.push_back(file);
+}
+
+void CRuntimeFontWriter::AddGlyph(const SRuntimeFontGlyph &glyph)
+{
+	glyphs.push_back(glyph);
+}
+
+void CRuntimeFontWriter::AddKerning(unsigned int first, unsigned int second, short amount)
+{
+	SKerning k;
+	k.first  = first;
+	k.second = second;
+	k.amount = amount;
+	kernings.push_back(k);
+}
+
+static bool GlyphLess(const SRuntimeFontGlyph &a, const SRuntimeFontGlyph &b) { return a.id < b.id; }
+static bool GlyphEqual(const SRuntimeFontGlyph &a, const SRuntimeFontGlyph &b) { return a.id == b.id; }
+
+// Builds a minimal perfect hash of the code points with hash and displace. 
+// The code points are first hashed into buckets of about four, and then the
+// largest buckets are placed first, each by searching for a seed that hashes
+// all its code points to free slots. The buckets with a single code point 
+// are given the first free slot directly. order receives the glyph for each slot.
+int CRuntimeFontWriter::BuildIndex(vector<unsigned int> &buckets, vector<unsigned int> &order)
+{
+	unsigned int numGlyphs  = (unsigned int)glyphs.size();
+	unsigned int numBuckets = numGlyphs/4 + 1;
+
+	// Group the glyphs by bucket
+	vector<unsigned int> bucketOf(numGlyphs);
+	vector<unsigned int> start(numBuckets + 1, 0);
+	for( unsigned int n = 0; n < numGlyphs; n++ )
+	{
+		bucketOf[n] = CRuntimeFontView::Hash(glyphs[n].id) % numBuckets;
+		start[bucketOf[n] + 1]++;
+	}
+	for( unsigned int b = 0; b < numBuckets; b++ )
+		start[b + 1] += start[b];
+	vector<unsigned int> members(numGlyphs);
+	vector<unsigned int> fill(start.begin(), start.end() - 1);
+	for( unsigned int n = 0; n < numGlyphs; n++ )
+		members[fill[bucketOf[n]]++] = n;
+
+	// Place the largest buckets first while most slots are free
+	vector<unsigned int> bucketOrder(numBuckets);
+	for( unsigned int b = 0; b < numBuckets; b++ )
+		bucketOrder[b] = b;
+	stable_sort(bucketOrder.begin(), bucketOrder.end(), [&](unsigned int a, unsigned int b) { return start[a+1] - start[a] > start[b+1] - start[b]; });
+
+	buckets.assign(numBuckets, 0);
+	order.assign(numGlyphs, 0);
+	vector<bool> taken(numGlyphs, false);
+	vector<unsigned int> slots;
+	unsigned int nextFree = 0;
+	for( unsigned int i = 0; i < numBuckets; i++ )
+	{
+		unsigned int b = bucketOrder[i];
+		unsigned int size = start[b+1] - start[b];
+		if( size == 0 )
+			break;
+
+		if( size == 1 )
+		{
+			while( taken[nextFree] ) nextFree++;
+			taken[nextFree] = true;
+			order[nextFree] = members[start[b]];
+			buckets[b] = 0x80000000u | nextFree;
+			continue;
+		}
+
+		unsigned int d;
+		for( d = 1; d < 0x1000000; d++ )
+		{
+			slots.clear();
+			unsigned int n;
+			for( n = start[b]; n < start[b+1]; n++ )
+			{
+				unsigned int slot = CRuntimeFontView::Hash(glyphs[members[n]].id + d*0x9E3779B9u) % numGlyphs;
+				if( taken[slot] || find(slots.begin(), slots.end(), slot) != slots.end() )
+					break;
+				slots.push_back(slot);
+			}
+			if( n == start[b+1] )
+				break;
+		}
+
+		// A seed is always found in practice, as the large buckets are placed first
+		if( d == 0x1000000 )
+			return -1;
+
+		buckets[b] = d;
+		for( unsigned int n = 0; n < size; n++ )
+		{
+			taken[slots[n]] = true;
+			order[slots[n]] = members[start[b] + n];
+		}
+	}
+
+	return 0;
+}
+
+static unsigned int Align4(size_t size)
+{
+	return unsigned((size + 3) & ~size_t(3));
+}
+
+template<class T>
+static void PutArray(vector<unsigned char> &buf, unsigned int offset, const vector<T> &values)
+{
+	if( values.size() )
+		memcpy(&buf[offset], &values[0], values.size()*sizeof(T));
+}
+
+int CRuntimeFontWriter::Write(FILE *f)
+{
+	// Each code point can only have one glyph
+	stable_sort(glyphs.begin(), glyphs.end(), GlyphLess);
+	glyphs.erase(unique(glyphs.begin(), glyphs.end(), GlyphEqual), glyphs.end());
+
+	vector<unsigned int> buckets, order;
+	if( BuildIndex(buckets, order) < 0 )
+		return -1;
+
+	unsigned int numGlyphs = (unsigned int)glyphs.size();
+	vector<unsigned int>   codepoints(numGlyphs);
+	vector<unsigned short> x(numGlyphs), y(numGlyphs), width(numGlyphs), height(numGlyphs);
+	vector<short>          xoffset(numGlyphs), yoffset(numGlyphs), xadvance(numGlyphs);
+	vector<unsigned char>  page(numGlyphs), chnl(numGlyphs);
+	for( unsigned int n = 0; n < numGlyphs; n++ )
+	{
+		const SRuntimeFontGlyph &g = glyphs[order[n]];
+		codepoints[n] = g.id;
+		x[n]          = g.x;
+		y[n]          = g.y;
+		width[n]      = g.width;
+		height[n]     = g.height;
+		xoffset[n]    = g.xoffset;
+		yoffset[n]    = g.yoffset;
+		xadvance[n]   = g.xadvance;
+		page[n]       = g.page;
+		chnl[n]       = g.chnl;
+	}
+
+	// Group the kerning pairs by the slot of the first glyph, with the 
+	// second code points in order. Pairs for missing glyphs are dropped.
+	vector<unsigned int> slotOf(numGlyphs);
+	for( unsigned int n = 0; n < numGlyphs; n++ )
+		slotOf[order[n]] = n;
+	vector<pair<unsigned int, unsigned int> > keys;
+	vector<short> amounts;
+	for( size_t n = 0; n < kernings.size(); n++ )
+	{
+		SRuntimeFontGlyph g;
+		g.id = kernings[n].first;
+		vector<SRuntimeFontGlyph>::const_iterator it = lower_bound(glyphs.begin(), glyphs.end(), g, GlyphLess);
+		if( it == glyphs.end() || it->id != g.id )
+			continue;
+		keys.push_back(make_pair(slotOf[it - glyphs.begin()], kernings[n].second));
+		amounts.push_back(kernings[n].amount);
+	}
+	vector<unsigned int> kernOrder(keys.size());
+	for( unsigned int n = 0; n < kernOrder.size(); n++ )
+		kernOrder[n] = n;
+	stable_sort(kernOrder.begin(), kernOrder.end(), [&](unsigned int a, unsigned int b) { return keys[a] < keys[b]; });
+
+	vector<unsigned int> kernStart(numGlyphs + 1, 0);
+	vector<unsigned int> kernSecond;
+	vector<short>        kernAmount;
+	for( size_t n = 0; n < kernOrder.size(); n++ )
+	{
+		// Keep only the first of duplicate pairs
+		const pair<unsigned int, unsigned int> &k = keys[kernOrder[n]];
+		if( n && k == keys[kernOrder[n-1]] )
+			continue;
+		kernStart[k.first + 1]++;
+		kernSecond.push_back(k.second);
+		kernAmount.push_back(amounts[kernOrder[n]]);
+	}
+	for( unsigned int n = 0; n < numGlyphs; n++ )
+		kernStart[n + 1] += kernStart[n];
+
+	string names = faceName + '\0';
+	for( size_t n = 0; n < pageFiles.size(); n++ )
+		names += pageFiles[n] + '\0';
+
+	header.numPages    = (unsigned int)pageFiles.size();
+	header.numGlyphs   = numGlyphs;
+	header.numBuckets  = (unsigned int)buckets.size();
+	header.numKernings = (unsigned int)kernSecond.size();
+
+	// Lay out the arrays one after the other
+	const size_t sizes[RTF_NUM_ARRAYS] = 
+	{
+		buckets.size()*4, numGlyphs*4, numGlyphs*2, numGlyphs*2, numGlyphs*2, numGlyphs*2, 
+		numGlyphs*2, numGlyphs*2, numGlyphs*2, numGlyphs, numGlyphs, 
+		kernStart.size()*4, kernSecond.size()*4, kernAmount.size()*2, names.length()
+	};
+	unsigned int offset = Align4(sizeof(header));
+	for( int n = 0; n < RTF_NUM_ARRAYS; n++ )
+	{
+		header.arrays[n] = offset;
+		offset = Align4(offset + sizes[n]);
+	}
+	header.fileSize = offset;
+
+	vector<unsigned char> buf(offset, 0);
+	memcpy(&buf[0], &header, sizeof(header));
+	PutArray(buf, header.arrays[RTF_BUCKETS], buckets);
+	PutArray(buf, header.arrays[RTF_CODEPOINTS], codepoints);
+	PutArray(buf, header.arrays[RTF_X], x);
+	PutArray(buf, header.arrays[RTF_Y], y);
+	PutArray(buf, header.arrays[RTF_WIDTH], width);
+	PutArray(buf, header.arrays[RTF_HEIGHT], height);
+	PutArray(buf, header.arrays[RTF_XOFFSET], xoffset);
+	PutArray(buf, header.arrays[RTF_YOFFSET], yoffset);
+	PutArray(buf, header.arrays[RTF_XADVANCE], xadvance);
+	PutArray(buf, header.arrays[RTF_PAGE], page);
+	PutArray(buf, header.arrays[RTF_CHNL], chnl);
+	PutArray(buf, header.arrays[RTF_KERNING_START], kernStart);
+	PutArray(buf, header.arrays[RTF_KERNING_SECOND], kernSecond);
+	PutArray(buf, header.arrays[RTF_KERNING_AMOUNT], kernAmount);
+	memcpy(&buf[header.arrays[RTF_NAMES]], names.c_str(), names.length());
+
+	return fwrite(&buf[0], buf.size(), 1, f) == 1 ? 0 : -1;
+}
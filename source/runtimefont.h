@@ -0,0 +1,246 @@
+/*
+   AngelCode Bitmap Font Generator
+   Copyright (c) 2004-2016 Andreas Jonsson
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any
+   damages arising from the use of this software.
+
+   Permission is granted to anyone to use this software for any
+   purpose, including commercial applications, and to alter it and
+   redistribute it freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you
+      must not claim that you wrote the original software. If you use
+      this software in a product, an acknowledgment in the product
+      documentation would be appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and
+      must not be misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+      distribution.
+
+   Andreas Jonsson
+   andreas@angelcode.com
+*/
+
+#ifndef RUNTIMEFONT_H
+#define RUNTIMEFONT_H
+
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+// The runtime font format is made to be memory mapped and used as is. The 
+// glyphs are found with a minimal perfect hash of the code points, the glyph
+// metrics are stored as one array per member, and the kerning pairs are 
+// grouped by the first glyph in the order of the glyphs. All the arrays are
+// aligned to 4 bytes from the start of the file, and all values are little 
+// endian. CRuntimeFontView is defined in full in this header, so the header
+// can be copied to the engine that uses the fonts.
+
+const unsigned int RUNTIMEFONT_VERSION = 1;
+
+enum ERuntimeFontArray
+{
+	RTF_BUCKETS,         // unsigned int[numBuckets], see FindGlyph
+	RTF_CODEPOINTS,      // unsigned int[numGlyphs], 0xFFFFFFFF for the invalid char glyph
+	RTF_X,               // unsigned short[numGlyphs]
+	RTF_Y,               // unsigned short[numGlyphs]
+	RTF_WIDTH,           // unsigned short[numGlyphs]
+	RTF_HEIGHT,          // unsigned short[numGlyphs]
+	RTF_XOFFSET,         // short[numGlyphs]
+	RTF_YOFFSET,         // short[numGlyphs]
+	RTF_XADVANCE,        // short[numGlyphs]
+	RTF_PAGE,            // unsigned char[numGlyphs]
+	RTF_CHNL,            // unsigned char[numGlyphs]
+	RTF_KERNING_START,   // unsigned int[numGlyphs+1], the first pair of each glyph
+	RTF_KERNING_SECOND,  // unsigned int[numKernings], sorted for each glyph
+	RTF_KERNING_AMOUNT,  // short[numKernings]
+	RTF_NAMES,           // The face name followed by the page file names, each null terminated
+	RTF_NUM_ARRAYS
+};
+
+struct SRuntimeFontHeader
+{
+	char          magic[4];   // "BMFR"
+	unsigned int  version;
+	unsigned int  fileSize;
+	int           fontSize;
+	int           lineHeight;
+	int           base;
+	int           scaleW;
+	int           scaleH;
+	unsigned int  numPages;
+	unsigned char packed;
+	unsigned char alphaChnl;
+	unsigned char redChnl;
+	unsigned char greenChnl;
+	unsigned char blueChnl;
+	unsigned char reserved[3];
+	unsigned int  numGlyphs;
+	unsigned int  numBuckets;
+	unsigned int  numKernings;
+	unsigned int  arrays[RTF_NUM_ARRAYS]; // The offsets from the start of the file
+};
+
+// Gives access to a runtime font in memory without copying or allocating
+class CRuntimeFontView
+{
+public:
+	CRuntimeFontView() { data = 0; header = 0; }
+
+	// Verifies that the arrays are within the data, and that the kerning ranges and names can
+	// be read without going outside it. Returns -1 if the data isn't a valid runtime font.
+	int Attach(const void *buffer, size_t size)
+	{
+		data   = 0;
+		header = 0;
+
+		const SRuntimeFontHeader *h = (const SRuntimeFontHeader*)buffer;
+		if( size < sizeof(SRuntimeFontHeader) || memcmp(h->magic, "BMFR", 4) != 0 || h->version != RUNTIMEFONT_VERSION || h->fileSize > size )
+			return -1;
+
+		static const unsigned char elemSize[RTF_NUM_ARRAYS] = {4, 4, 2, 2, 2, 2, 2, 2, 2, 1, 1, 4, 4, 2, 0};
+		for( int n = 0; n < RTF_NUM_ARRAYS; n++ )
+		{
+			unsigned long long count = n == RTF_BUCKETS ? h->numBuckets : 
+			                           n == RTF_KERNING_START ? h->numGlyphs + 1ull : 
+			                           n >= RTF_KERNING_SECOND ? h->numKernings : h->numGlyphs;
+			if( (h->arrays[n] & 3) || h->arrays[n] + count*elemSize[n] > h->fileSize )
+				return -1;
+		}
+		if( h->numBuckets == 0 )
+			return -1;
+
+		// The kerning pairs of each glyph must be within the kerning arrays
+		const unsigned int *start = (const unsigned int*)((const unsigned char*)buffer + h->arrays[RTF_KERNING_START]);
+		for( unsigned int n = 0; n < h->numGlyphs; n++ )
+			if( start[n] > start[n+1] )
+				return -1;
+		if( start[h->numGlyphs] > h->numKernings )
+			return -1;
+
+		// The face name and each of the page file names must be terminated within the file
+		const char *names = (const char*)buffer + h->arrays[RTF_NAMES];
+		size_t namesSize = h->fileSize - h->arrays[RTF_NAMES];
+		unsigned long long numNames = 0;
+		for( size_t n = 0; n < namesSize && numNames < h->numPages + 1ull; n++ )
+			if( names[n] == 0 )
+				numNames++;
+		if( numNames < h->numPages + 1ull )
+			return -1;
+
+		data   = (const unsigned char*)buffer;
+		header = h;
+		return 0;
+	}
+
+	const SRuntimeFontHeader *GetHeader() const { return header; }
+
+	template<class T> const T *GetArray(ERuntimeFontArray array) const { return (const T*)(data + header->arrays[array]); }
+
+	static unsigned int Hash(unsigned int x)
+	{
+		x ^= x >> 16; x *= 0x7feb352du;
+		x ^= x >> 15; x *= 0x846ca68bu;
+		x ^= x >> 16;
+		return x;
+	}
+
+	// Returns the index of the glyph, or -1 if the font doesn't have it. The
+	// bucket of the code point holds either the index of the glyph directly,
+	// when the high bit is set, or the seed for the second hash.
+	int FindGlyph(unsigned int codepoint) const
+	{
+		if( header->numGlyphs == 0 ) return -1;
+
+		unsigned int d = GetArray<unsigned int>(RTF_BUCKETS)[Hash(codepoint) % header->numBuckets];
+		unsigned int glyph = (d & 0x80000000u) ? (d & 0x7FFFFFFFu) : Hash(codepoint + d*0x9E3779B9u) % header->numGlyphs;
+		if( glyph >= header->numGlyphs || GetArray<unsigned int>(RTF_CODEPOINTS)[glyph] != codepoint )
+			return -1;
+
+		return int(glyph);
+	}
+
+	// Returns the kerning between the glyph and the following code point
+	int GetKerning(int firstGlyph, unsigned int second) const
+	{
+		const unsigned int *start = GetArray<unsigned int>(RTF_KERNING_START);
+		const unsigned int *seconds = GetArray<unsigned int>(RTF_KERNING_SECOND);
+		unsigned int lo = start[firstGlyph], hi = start[firstGlyph+1];
+		while( lo < hi )
+		{
+			unsigned int mid = (lo + hi) / 2;
+			if( seconds[mid] < second )      lo = mid + 1;
+			else if( seconds[mid] > second ) hi = mid;
+			else return GetArray<short>(RTF_KERNING_AMOUNT)[mid];
+		}
+		return 0;
+	}
+
+	// The names are null terminated after each other, with the face name first
+	const char *GetFaceName() const { return (const char*)data + header->arrays[RTF_NAMES]; }
+	const char *GetPageFile(unsigned int page) const
+	{
+		const char *name = GetFaceName();
+		for( unsigned int n = 0; n <= page; n++ )
+			name += strlen(name) + 1;
+		return name;
+	}
+
+protected:
+	const unsigned char      *data;
+	const SRuntimeFontHeader *header;
+};
+
+struct SRuntimeFontGlyph
+{
+	unsigned int   id;
+	unsigned short x;
+	unsigned short y;
+	unsigned short width;
+	unsigned short height;
+	short          xoffset;
+	short          yoffset;
+	short          xadvance;
+	unsigned char  page;
+	unsigned char  chnl;
+};
+
+// Collects the glyphs and kerning pairs and writes them in the runtime format
+class CRuntimeFontWriter
+{
+public:
+	CRuntimeFontWriter();
+
+	void SetCommon(int fontSize, int lineHeight, int base, int scaleW, int scaleH, bool packed, int alphaChnl, int redChnl, int greenChnl, int blueChnl);
+	void SetFaceName(const std::string &name);
+	void AddPage(const std::string &file);
+	void AddGlyph(const SRuntimeFontGlyph &glyph);
+	void AddKerning(unsigned int first, unsigned int second, short amount);
+
+	// Returns 0 on success and -1 on error
+	int  Write(FILE *f);
+
+protected:
+	struct SKerning
+	{
+		unsigned int first;
+		unsigned int second;
+		short        amount;
+	};
+
+	int  BuildIndex(std::vector<unsigned int> &buckets, std::vector<unsigned int> &order);
+
+	SRuntimeFontHeader             header;
+	std::string                    faceName;
+	std::vector<std::string>       pageFiles;
+	std::vector<SRuntimeFontGlyph> glyphs;
+	std::vector<SKerning>          kernings;
+};
+
+#endif
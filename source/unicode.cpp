@@ -30,12 +30,16 @@
 #include <assert.h>
 #include <map>
 #include <sstream>
+#include <algorithm>
+#include <unordered_map>
 using std::map;
+using std::unordered_map;
 
 #include "dynamic_funcs.h"
 #include "ac_string_util.h"
 #include "acutil_unicode.h"
 #include "fontgen.h"
+#include "acutil_parallel.h"
 
 #include "unicode.h"
 
@@ -524,9 +528,9 @@ int GetCharSet(const char *charSetName)
 	return set;
 }
 
-int EnumUnicodeGlyphs(HDC dc, map<unsigned int, unsigned int> &unicodeToGlyphMap)
+int EnumUnicodeGlyphs(HDC dc, CGlyphMap &unicodeToGlyphMap)
 {
-	unicodeToGlyphMap.clear();
+	unicodeToGlyphMap.Clear();
 
 	// This function is only called as fallback in case EnumTrueTypeCMAP didn't
 	// work. so we can assume that the font doesn't have 32bit Unicode support
@@ -543,7 +547,7 @@ int EnumUnicodeGlyphs(HDC dc, map<unsigned int, unsigned int> &unicodeToGlyphMap
 		WORD idx; 
 		int r = fGetGlyphIndicesW(dc, buf, 1, &idx, GGI_MARK_NONEXISTING_GLYPHS);
 		if (r != GDI_ERROR && idx != 0xFFFF && idx != 0)
-			unicodeToGlyphMap[ch] = idx;
+			unicodeToGlyphMap.Set(ch, idx);
 	}
 
 	return 0;
@@ -646,124 +650,220 @@ int GetGlyphABCWidths(HDC dc, SCRIPT_CACHE *sc, UINT glyph, ABC *abc)
 //            http://partners.adobe.com/public/developer/opentype/index_table_formats2.html
 //
 
-UINT GetClassFromClassDef(BYTE *classDef, WORD glyphId)
+// The glyphs and characters that kerning pairs should be extracted for. Multiple
+// characters may use the same glyph, e.g. space, 32, and hard space, 160, so the
+// characters for a glyph are found through the reverse index of the font's glyph map.
+// The kerning tables are only searched for the glyphs that are used, so the pairs
+// for the rest of the font are never expanded.
+struct SKerningGlyphs
 {
-	// Go through the class def to determine in which class the glyph belongs
-	WORD classFormat = GETUSHORT(classDef);
-	if( classFormat == 1 )
+	SKerningGlyphs(const vector<UINT> &chars, const CFontGen *gen);
+
+	bool IsUsed(UINT glyphId) const { return glyphId < usedGlyphs.GetSize() && usedGlyphs[glyphId]; }
+
+	const CGlyphMap &glyphMap;
+	CCharBitset      usedChars;
+	CCharBitset      usedGlyphs;
+	vector<WORD>     usedGlyphList;
+};
+
+SKerningGlyphs::SKerningGlyphs(const vector<UINT> &chars, const CFontGen *gen) : glyphMap(gen->GetGlyphMap())
+{
+	// TODO: support non unicode as well
+	usedChars.Resize(CGlyphMap::maxChar+1);
+	usedGlyphs.Resize(glyphMap.GetNumGlyphs());
+	for( UINT n = 0; n < chars.size(); n++ )
 	{
-		WORD startGlyph = GETUSHORT(classDef+2);
-		WORD glyphCount = GETUSHORT(classDef+4);
+		UINT glyphId = glyphMap.GetGlyph(chars[n]);
+		if( glyphId == 0 )
+			continue;
 
-		if( startGlyph <= glyphId && glyphId - startGlyph < glyphCount )
-			return GETUSHORT(classDef+6+2*(glyphId - startGlyph));
+		usedChars.Set(chars[n]);
+		usedGlyphs.Set(glyphId);
 	}
-	else if( classFormat == 2 )
+
+	for( int g = usedGlyphs.FindNext(0); g >= 0; g = usedGlyphs.FindNext(g+1) )
+		usedGlyphList.push_back(WORD(g));
+}
+
+// The kerning between two glyphs in design units, keyed by the pair of glyph ids
+typedef unordered_map<DWORD, int> TGlyphPairs;
+
+inline DWORD GlyphPairKey(UINT glyphId1, UINT glyphId2)
+{
+	return (DWORD(glyphId1) << 16) | glyphId2;
+}
+
+// Converts the glyph pairs to pairs of characters in the selected font size
+void ExpandKerningPairs(const TGlyphPairs &glyphPairs, float scaleFactor, const SKerningGlyphs &glyphs, vector<SKerningPair> &pairs)
+{
+	for( TGlyphPairs::const_iterator it = glyphPairs.begin(); it != glyphPairs.end(); ++it )
 	{
-		WORD rangeCount = GETUSHORT(classDef+2);
-		for( UINT n = 0; n < rangeCount; n++ )
+		if( it->second == 0 )
+			continue;
+
+		// Convert from design units to the selected font size
+		SKerningPair pair;
+		float kern = it->second*scaleFactor;
+		if( kern < 0 )
+			pair.amount = int(kern-0.5f);
+		else
+			pair.amount = int(kern+0.5f);
+
+		// Skip 0 kernings
+		if( pair.amount == 0 )
+			continue;
+
+		UINT glyphId1 = it->first >> 16;
+		UINT glyphId2 = it->first & 0xFFFF;
+		const UINT *chars1 = glyphs.glyphMap.GetChars(glyphId1);
+		const UINT *chars2 = glyphs.glyphMap.GetChars(glyphId2);
+		UINT count1 = glyphs.glyphMap.GetCharCount(glyphId1);
+		UINT count2 = glyphs.glyphMap.GetCharCount(glyphId2);
+
+		for( UINT a = 0; a < count1; a++ )
 		{
-			WORD start = GETUSHORT(classDef+4+6*n);
-			WORD end   = GETUSHORT(classDef+6+6*n);
-			if( start <= glyphId && end >= glyphId )
-				return GETUSHORT(classDef+8+6*n);
+			if( chars1[a] == 0 || !glyphs.usedChars[chars1[a]] )
+				continue;
+
+			for( UINT b = 0; b < count2; b++ )
+			{
+				if( chars2[b] == 0 || !glyphs.usedChars[chars2[b]] )
+					continue;
+
+				// Add the kerning pair to the list
+				pair.first  = chars1[a];
+				pair.second = chars2[b];
+				pairs.push_back(pair);
+			}
 		}
 	}
-
-	return 0;
 }
 
-vector<UINT> GetGlyphsFromClassDef(BYTE *classDef, UINT classId)
+// Returns the used glyphs in each class of the class def. Glyphs that 
+// are not listed in the class def belong to class 0
+void GetUsedGlyphClasses(const COpenTypeView &classDef, const SKerningGlyphs &glyphs, UINT classCount, vector<vector<WORD> > &members)
 {
-	// Find the class, and return all the glyphs that are part of it
-	vector<UINT> glyphs;
+	members.clear();
+	members.resize(classCount);
+	if( classCount == 0 )
+		return;
+
+	CCharBitset assigned(glyphs.usedGlyphs.GetSize());
 
-	WORD classFormat = GETUSHORT(classDef);
+	WORD classFormat = classDef.U16(0);
 	if( classFormat == 1 )
 	{
-		WORD startGlyph = GETUSHORT(classDef+2);
-		WORD glyphCount = GETUSHORT(classDef+4);
-
-		for( UINT n = 0; n < glyphCount; n++ )
+		WORD startGlyph = classDef.U16(2);
+		WORD glyphCount = classDef.U16(4);
+		if( classDef.Has(6, glyphCount*2) )
 		{
-			if( GETUSHORT(classDef+6+2*n) == classId )
-				glyphs.push_back(startGlyph + n);
+			for( UINT n = 0; n < glyphCount; n++ )
+			{
+				UINT glyphId = startGlyph + n;
+				UINT classId = classDef.U16(6+2*n);
+				if( glyphs.IsUsed(glyphId) && classId < classCount )
+				{
+					members[classId].push_back(WORD(glyphId));
+					assigned.Set(glyphId);
+				}
+			}
 		}
 	}
 	else if( classFormat == 2 )
 	{
-		WORD rangeCount = GETUSHORT(classDef+2);
-		for( UINT n = 0; n < rangeCount; n++ )
+		WORD rangeCount = classDef.U16(2);
+		if( classDef.Has(4, rangeCount*6) )
 		{
-			WORD start = GETUSHORT(classDef+4+6*n);
-			WORD end   = GETUSHORT(classDef+6+6*n);
-			if( GETUSHORT(classDef+8+6*n) == classId )
+			for( UINT n = 0; n < rangeCount; n++ )
 			{
-				for( UINT g = start; g <= end; g++ )
-					glyphs.push_back(g);
+				WORD start   = classDef.U16(4+6*n);
+				WORD end     = classDef.U16(6+6*n);
+				UINT classId = classDef.U16(8+6*n);
+				if( classId >= classCount )
+					continue;
+
+				// Only visit the used glyphs in the range
+				int g = start < glyphs.usedGlyphs.GetSize() ? glyphs.usedGlyphs.FindNext(start) : -1;
+				for( ; g >= 0 && g <= end; g = glyphs.usedGlyphs.FindNext(g+1) )
+				{
+					if( !assigned[g] )
+					{
+						members[classId].push_back(WORD(g));
+						assigned.Set(g);
+					}
+				}
 			}
 		}
 	}
 
-	return glyphs;
+	for( size_t n = 0; n < glyphs.usedGlyphList.size(); n++ )
+	{
+		if( !assigned[glyphs.usedGlyphList[n]] )
+			members[0].push_back(glyphs.usedGlyphList[n]);
+	}
 }
 
-float DetermineDesignUnitToFontUnitFactor(HDC dc)
+// Returns the glyphs in the coverage table in the order of their coverage index
+void GetGlyphsFromCoverage(const COpenTypeView &coverage, vector<WORD> &glyphs)
 {
-	OUTLINETEXTMETRIC tm;
-	GetOutlineTextMetrics(dc, sizeof(tm), &tm);
+	glyphs.clear();
 
-	DWORD head = TAG('h','e','a','d');
-	UINT size = GetFontData(dc, head, 0, 0, 0);
-	if( size != GDI_ERROR )
+	WORD coverageFormat = coverage.U16(0);
+	if( coverageFormat == 1 )
 	{
-		vector<BYTE> buffer;
-		buffer.resize(size);
-		GetFontData(dc, head, 0, &buffer[0], size);
-
-		SHORT xMin = GETUSHORT(&buffer[36]);
-		SHORT yMin = GETUSHORT(&buffer[38]);
-		SHORT xMax = GETUSHORT(&buffer[40]);
-		SHORT yMax = GETUSHORT(&buffer[42]);
+		WORD glyphCount = coverage.U16(2);
+		if( !coverage.Has(4, glyphCount*2) )
+			return;
 
-		float factor = float(tm.otmrcFontBox.top-tm.otmrcFontBox.bottom)/float(yMax-yMin);
-		return factor;
+		glyphs.reserve(glyphCount);
+		for( UINT g = 0; g < glyphCount; g++ )
+			glyphs.push_back(coverage.U16(4+2*g));
 	}
+	else if( coverageFormat == 2 )
+	{
+		WORD rangeCount = coverage.U16(2);
+		if( !coverage.Has(4, rangeCount*6) )
+			return;
 
-	return 1;
+		// Determine the number of glyphs first to avoid reallocations
+		UINT glyphCount = 0;
+		for( UINT n = 0; n < rangeCount; n++ )
+		{
+			WORD start = coverage.U16(4+n*6);
+			WORD end   = coverage.U16(6+n*6);
+			WORD startCoverageIndex = coverage.U16(8+n*6);
+			if( start <= end && UINT(startCoverageIndex + end - start + 1) > glyphCount )
+				glyphCount = startCoverageIndex + end - start + 1;
+		}
+		glyphs.resize(glyphCount, 0xFFFF);
+
+		// Expand the ranges into the glyph array
+		for( UINT n = 0; n < rangeCount; n++ )
+		{
+			WORD start = coverage.U16(4+n*6);
+			WORD end   = coverage.U16(6+n*6);
+			WORD startCoverageIndex = coverage.U16(8+n*6);
+
+			for( UINT g = start; g <= end; g++ )
+				glyphs[startCoverageIndex + g - start] = WORD(g);
+		}
+	}
 }
 
-void AddKerningPairToList(HDC dc, UINT glyphId1, UINT glyphId2, int kerning, vector<KERNINGPAIR> &pairs, float scaleFactor, map<UINT,vector<UINT>> &glyphIdToChar)
+float DetermineDesignUnitToFontUnitFactor(HDC dc, const COpenTypeFont &font)
 {
-	assert(kerning != 0);
+	OUTLINETEXTMETRIC tm;
+	GetOutlineTextMetrics(dc, sizeof(tm), &tm);
 
-	for( UINT a = 0; a < glyphIdToChar[glyphId1].size(); a++ )
+	SHORT xMin, yMin, xMax, yMax;
+	if( font.GetFontBox(xMin, yMin, xMax, yMax) >= 0 && yMax > yMin )
 	{
-		for( UINT b = 0; b < glyphIdToChar[glyphId2].size(); b++ )
-		{
-			// Add the kerning pair to the list
-			KERNINGPAIR pair;
-			pair.wFirst      = glyphIdToChar[glyphId1][a];
-			pair.wSecond     = glyphIdToChar[glyphId2][b];
-			if( pair.wFirst == 0 || pair.wSecond == 0 )
-				return;
-
-			// Convert from design units to the selected font size
-			float kern = kerning*scaleFactor;
-			if( kern < 0 )
-				pair.iKernAmount = int(kern-0.5f);
-			else
-				pair.iKernAmount = int(kern+0.5f);
-
-			// Skip 0 kernings
-			if( pair.iKernAmount == 0 )
-				return;
-
-			if( pairs.capacity() == pairs.size() && pairs.size() > 1 )
-				pairs.reserve(pairs.size() * 2);
-			pairs.push_back(pair);
-		}
+		float factor = float(tm.otmrcFontBox.top-tm.otmrcFontBox.bottom)/float(yMax-yMin);
+		return factor;
 	}
+
+	return 1;
 }
 
 UINT GetSizeOfValueType(WORD valueType)
@@ -789,272 +889,190 @@ UINT GetSizeOfValueType(WORD valueType)
 	return size;
 }
 
-short GetXAdvance(BYTE *value, WORD valueType)
+short GetXAdvance(const COpenTypeView &table, UINT valueOffset, WORD valueType)
 {
 	if( !(valueType & 4) ) 
 		return 0;
 
-	UINT offset = 0;
+	UINT offset = valueOffset;
 	if( valueType & 1 ) offset += 2;
 	if( valueType & 2 ) offset += 2;
 
-	return GETSHORT(value+offset);
+	return table.S16(offset);
 }
 
-void ProcessPairAdjustmentFormat1(HDC dc, BYTE *subTable, vector<KERNINGPAIR> &pairs, map<UINT,vector<UINT>> &glyphIdToChar, float scaleFactor)
+// Within a lookup only the first subtable that covers a pair of glyphs is applied, so the
+// pairs are only added if they are not already in the list. The glyphs that have been 
+// completely covered by a previous subtable are marked as closed.
+
+void ProcessPairAdjustmentFormat1(const COpenTypeView &subTable, const SKerningGlyphs &glyphs, const CCharBitset &closed, TGlyphPairs &lookupPairs)
 {
 	// Defines kerning between two individual glyphs
 
-	WORD coverageOffset = GETUSHORT(subTable+2);
-	WORD valueFormat1   = GETUSHORT(subTable+4);
-	assert( valueFormat1 == 4 ); // TODO: Must support others
-	WORD valueFormat2   = GETUSHORT(subTable+6);
-	assert( valueFormat2 == 0 ); // TODO: Must support others
-	WORD pairSetCount   = GETUSHORT(subTable+8);
+	WORD coverageOffset = subTable.U16(2);
+	WORD valueFormat1   = subTable.U16(4);
+	WORD valueFormat2   = subTable.U16(6);
+	WORD pairSetCount   = subTable.U16(8);
 
 	UINT valuePairSize = GetSizeOfValueType(valueFormat1) + GetSizeOfValueType(valueFormat2);
 
 	// The first glyph id in the pair is found in the coverage table
 	// The second glyph id in the pair is found in the PairSet records
-	
-	BYTE *coverage = subTable + coverageOffset;
-	WORD coverageFormat = GETUSHORT(coverage);
-	if( coverageFormat == 1 )
+	vector<WORD> glyph1;
+	GetGlyphsFromCoverage(subTable.Sub(coverageOffset), glyph1);
+
+	for( UINT g = 0; g < glyph1.size() && g < pairSetCount; g++ )
 	{
-		WORD glyphCount = GETUSHORT(coverage+2);
-		assert(glyphCount == pairSetCount);
-		for( DWORD g = 0; g < glyphCount; g++ )
-		{
-			WORD glyphId1 = GETUSHORT(coverage+4+2*g);
-			if( glyphIdToChar[glyphId1].size() == 0 )
-				continue;
+		WORD glyphId1 = glyph1[g];
+		if( !glyphs.IsUsed(glyphId1) || closed[glyphId1] )
+			continue;
 
-			// For each of the glyph ids we need to search the 
-			// PairSets for the matching kerning pairs
-			WORD pairSetOffset = GETUSHORT(subTable+10+g*2);
-			BYTE *pairSet = subTable + pairSetOffset;
-			WORD pairValueCount = GETUSHORT(pairSet);
-			for( UINT p = 0; p < pairValueCount; p++ )
-			{
-				BYTE *pairValue = pairSet + 2 + p*(2+valuePairSize);
+		// For each of the glyph ids we need to search the 
+		// PairSets for the matching kerning pairs
+		COpenTypeView pairSet = subTable.Sub(subTable.U16(10+g*2));
+		WORD pairValueCount = pairSet.U16(0);
+		if( !pairSet.Has(2, pairValueCount*(2+valuePairSize)) )
+			continue;
 
-				WORD glyphId2 = GETUSHORT(pairValue);
-				short xAdv1 = GetXAdvance(pairValue+2, valueFormat1);
+		for( UINT p = 0; p < pairValueCount; p++ )
+		{
+			UINT pairValue = 2 + p*(2+valuePairSize);
 
-				if( xAdv1 != 0 )
-				{
-					AddKerningPairToList(dc, glyphId1, glyphId2, xAdv1, pairs, scaleFactor, glyphIdToChar);
-				}
-			}
-		}
-	}
-	else
-	{
-		WORD rangeCount = GETUSHORT(coverage+2);
+			WORD glyphId2 = pairSet.U16(pairValue);
+			if( !glyphs.IsUsed(glyphId2) )
+				continue;
 
-		// TODO: Implement this
-		assert( false );
+			// Pairs without adjustment are also stored, since they 
+			// still stop later subtables from applying to the pair
+			short xAdv1 = GetXAdvance(pairSet, pairValue+2, valueFormat1);
+			lookupPairs.insert(TGlyphPairs::value_type(GlyphPairKey(glyphId1, glyphId2), xAdv1));
+		}
 	}
 }
 
-void ProcessPairAdjustmentFormat2(HDC dc, BYTE *subTable, vector<KERNINGPAIR> &pairs, map<UINT,vector<UINT>> &glyphIdToChar, float scaleFactor)
+void ProcessPairAdjustmentFormat2(const COpenTypeView &subTable, const SKerningGlyphs &glyphs, CCharBitset &closed, TGlyphPairs &lookupPairs)
 {
 	// Defines kerning between two classes of glyphs
 
-	WORD coverageOffset  = GETUSHORT(subTable+2);
-	WORD valueFormat1    = GETUSHORT(subTable+4);
-	assert( valueFormat1 == 4 ); // TODO: must support others
-	WORD valueFormat2    = GETUSHORT(subTable+6);
-	assert( valueFormat2 == 0 ); // TODO: must support others
-	WORD classDefOffset1 = GETUSHORT(subTable+8);
-	WORD classDefOffset2 = GETUSHORT(subTable+10);
-	WORD classCount1     = GETUSHORT(subTable+12);
-	WORD classCount2     = GETUSHORT(subTable+14);
+	WORD coverageOffset  = subTable.U16(2);
+	WORD valueFormat1    = subTable.U16(4);
+	WORD valueFormat2    = subTable.U16(6);
+	WORD classDefOffset1 = subTable.U16(8);
+	WORD classDefOffset2 = subTable.U16(10);
+	WORD classCount1     = subTable.U16(12);
+	WORD classCount2     = subTable.U16(14);
 
-	WORD valuePairSize = GetSizeOfValueType(valueFormat1) + GetSizeOfValueType(valueFormat2);
-
-	// The first glyph id in the pair is found in the coverage table
-	// The second glyph id is determined from the class definitions
+	UINT valuePairSize = GetSizeOfValueType(valueFormat1) + GetSizeOfValueType(valueFormat2);
 
-	vector<WORD> glyph1;
+	// The class records must be within the subtable
+	if( !subTable.Has(16, classCount1*classCount2*valuePairSize) )
+		return;
 
-	BYTE *coverage = subTable + coverageOffset;
-	WORD coverageFormat = GETUSHORT(coverage);
-	if( coverageFormat == 1 )
+	// The first glyph id in the pair is found in the coverage table
+	vector<WORD> coverage;
+	GetGlyphsFromCoverage(subTable.Sub(coverageOffset), coverage);
+	CCharBitset covered(glyphs.usedGlyphs.GetSize());
+	for( UINT g = 0; g < coverage.size(); g++ )
 	{
-		WORD glyphCount = GETUSHORT(coverage+2);
-		glyph1.reserve(glyphCount);
-
-		for( DWORD g = 0; g < glyphCount; g++ )
-		{
-			WORD glyphId = GETUSHORT(coverage+4+2*g);
-			if( glyphIdToChar[glyphId].size() )
-				glyph1.push_back(glyphId);
-		}
+		if( glyphs.IsUsed(coverage[g]) && !closed[coverage[g]] )
+			covered.Set(coverage[g]);
 	}
-	else
-	{
-		WORD rangeCount = SWAP16(*(WORD*)(coverage+2));
-
-		// Expand the ranges into the glyph1 array
-		for( UINT n = 0; n < rangeCount; n++ )
-		{
-			WORD start = GETUSHORT(coverage+4+n*6);
-			WORD end   = GETUSHORT(coverage+6+n*6);
-			WORD startCoverageIndex = GETUSHORT(coverage+8+n*6);
 
-			// TODO: Reserve space for all the glyph ids to reduce number of individual allocations
+	// Only the used glyphs are placed in the classes, so the classes
+	// with many glyphs are not expanded for glyphs that will not be exported
+	vector<vector<WORD> > class1, class2;
+	GetUsedGlyphClasses(subTable.Sub(classDefOffset1), glyphs, classCount1, class1);
+	GetUsedGlyphClasses(subTable.Sub(classDefOffset2), glyphs, classCount2, class2);
 
-			for( UINT g = start; g <= end; g++ )
-			{
-				if( glyphIdToChar[g].size() )
-					glyph1.push_back(g);
-			}
-		}
-	}
-
-	for( UINT g = 0; g < glyph1.size(); g++ )
+	for( UINT c1 = 0; c1 < classCount1; c1++ )
 	{
-		// What class is this glyph?
-		// Need a function for obtaining the class from a ClassDef
-		UINT c1 = GetClassFromClassDef(subTable + classDefOffset1, glyph1[g]);
+		UINT c1List = 16 + c1*classCount2*valuePairSize;
 
-		assert( c1 < classCount1 );
-	
-		if( c1 < classCount1 )
+		for( UINT g = 0; g < class1[c1].size(); g++ )
 		{
-			BYTE *c1List = subTable + 16 + c1*classCount2*valuePairSize;
+			WORD glyphId1 = class1[c1][g];
+			if( !covered[glyphId1] )
+				continue;
 
 			// For each of the classes 
 			for( UINT c2 = 0; c2 < classCount2; c2++ )
 			{
-				// Enumerate the glyphs that are part of the classes
-				vector<UINT> glyph2 = GetGlyphsFromClassDef(subTable + classDefOffset2, c2);
-
-				BYTE *valuePair = c1List + valuePairSize*c2;
+				short xAdv1 = GetXAdvance(subTable, c1List + valuePairSize*c2, valueFormat1);
+				if( xAdv1 == 0 )
+					continue;
 
-				short xAdv1 = GetXAdvance(valuePair, valueFormat1);
-				if( xAdv1 != 0 )
-				{
-					// Add a kerning pair for each combination of glyphs in each of the classes
-					for( UINT n = 0; n < glyph2.size(); n++ )
-					{
-						AddKerningPairToList(dc, glyph1[g], glyph2[n], xAdv1, pairs, scaleFactor, glyphIdToChar);
-					}
-				}
+				// Add a kerning pair for each combination of glyphs in each of the classes
+				for( UINT n = 0; n < class2[c2].size(); n++ )
+					lookupPairs.insert(TGlyphPairs::value_type(GlyphPairKey(glyphId1, class2[c2][n]), xAdv1));
 			}
 		}
 	}
+
+	// The subtable applies to all pairs that start with a covered glyph
+	closed.Or(covered);
 }
 
-void ProcessKernFeature(HDC dc, BYTE *featureRecord, BYTE *featureList, BYTE *lookupList, vector<KERNINGPAIR> &pairs, map<UINT,vector<UINT>> &glyphIdToChar, float scaleFactor)
+void ProcessKernLookup(const COpenTypeView &lookup, const SKerningGlyphs &glyphs, TGlyphPairs &lookupPairs)
 {
-	WORD offset = GETUSHORT(featureRecord+4);
+	WORD lookupType = lookup.U16(0);
+	WORD subTableCount = lookup.U16(4);
 
-	BYTE *feature = featureList + offset;
-	WORD featureParams = GETUSHORT(feature);
-	WORD lookupCount = GETUSHORT(feature+2);
-	WORD allLookupCount = GETUSHORT(lookupList);
-	
-	for( DWORD i = 0; i < lookupCount; i++ )
+	CCharBitset closed(glyphs.usedGlyphs.GetSize());
+
+	for( UINT s = 0; s < subTableCount; s++ )
 	{
-		WORD lookupIndex = GETUSHORT(feature+4+i*2);
+		COpenTypeView subTable = lookup.Sub(lookup.U16(6 + s*2));
 
-		// Determine the features that apply (look for kerning pairs)
+		WORD realLookupType = lookupType;
 
-		// Find the adjustments in the lookup table
-		if( lookupIndex < allLookupCount )
+		if( lookupType == 9 ) // extension positioning
 		{
-			WORD lookupOffset = GETUSHORT(lookupList + 2 + lookupIndex*2);
-
-			BYTE *lookup = lookupList + lookupOffset;
-
-			WORD lookupType = GETUSHORT(lookup);
-			WORD lookupFlag = GETUSHORT(lookup+2);
-			WORD subTableCount = GETUSHORT(lookup+4);
-
-			for( UINT s = 0; s < subTableCount; s++ )
-			{
-				WORD offset = GETUSHORT(lookup + 6 + s*2);
-				BYTE *subTable = lookup + offset;
-
-				WORD realLookupType = lookupType;
-
-				if( lookupType == 9 ) // extension positioning
-				{
-					WORD posFormat = GETUSHORT(subTable);
-					assert( posFormat == 1 ); // reserved
-					WORD extensionLookupType = GETUSHORT(subTable+2);
-					DWORD extensionOffset = GETUINT(subTable+4);
+			WORD posFormat = subTable.U16(0);
+			if( posFormat != 1 ) // reserved
+				continue;
+			WORD extensionLookupType = subTable.U16(2);
+			DWORD extensionOffset = subTable.U32(4);
 
-					realLookupType = extensionLookupType;
-					subTable = subTable + extensionOffset;
-				}
+			realLookupType = extensionLookupType;
+			subTable = subTable.Sub(extensionOffset);
+		}
 
-				if( realLookupType == 2 ) // pair adjustment
-				{
-					WORD posFormat    = GETUSHORT(subTable);
-					if( posFormat == 1 )
-						ProcessPairAdjustmentFormat1(dc, subTable, pairs, glyphIdToChar, scaleFactor);
-					else if( posFormat == 2 )
-						ProcessPairAdjustmentFormat2(dc, subTable, pairs, glyphIdToChar, scaleFactor);
-					else
-						assert(false);
-				}
-			}
+		if( realLookupType == 2 ) // pair adjustment
+		{
+			WORD posFormat = subTable.U16(0);
+			if( posFormat == 1 )
+				ProcessPairAdjustmentFormat1(subTable, glyphs, closed, lookupPairs);
+			else if( posFormat == 2 )
+				ProcessPairAdjustmentFormat2(subTable, glyphs, closed, lookupPairs);
 		}
 	}
 }
 
-void GetKerningPairsFromGPOS(HDC dc, vector<KERNINGPAIR> &pairs, vector<UINT> &chars, const CFontGen *gen)
+void GetKerningPairsFromGPOS(HDC dc, vector<SKerningPair> &pairs, const vector<UINT> &chars, const CFontGen *gen)
 {
-	// Determine the factor for scaling down the values from the design units to the font size
-	float scaleFactor = DetermineDesignUnitToFontUnitFactor(dc);
-
-	// TODO: support non unicode as well
-	// Build a glyphId to char map. Multiple characters may use  
-	// the same glyph, e.g. space, 32, and hard space, 160.
-	map<UINT,vector<UINT>> glyphIdToChar;
-	for( UINT n = 0; n < chars.size(); n++ )
-	{
-		int glyphId = gen->GetUnicodeGlyph(chars[n]);
-		if( glyphId >= 0 )
-			glyphIdToChar[glyphId].push_back(chars[n]);
-	}
-
-	// Load the GPOS table from the TrueType font file
-	vector<BYTE> buffer;
-	DWORD GPOS = TAG('G','P','O','S');
-	DWORD size = GetFontData(dc, GPOS, 0, 0, 0);
-	if( size != GDI_ERROR )
-	{
-		buffer.resize(size);
-		size = GetFontData(dc, GPOS, 0, &buffer[0], size);
-	}
-	if( size == GDI_ERROR || size == 0 )
+	// The GPOS table is read directly from the font file
+	const COpenTypeFont &font = gen->GetOpenTypeFont();
+	COpenTypeView gpos = font.GetTable(OT_TAG('G','P','O','S'));
+	if( gpos.IsEmpty() )
 		return;
 
 	// Get the GPOS header info
-	DWORD version          = GETUINT(&buffer[0]);
-	assert( version == 0x00010000 );
-	WORD scriptListOffset  = GETUSHORT(&buffer[4]);
-	WORD featureListOffset = GETUSHORT(&buffer[6]);
-	WORD lookupListOffset  = GETUSHORT(&buffer[8]);
+	DWORD version = gpos.U32(0);
+	if( (version >> 16) != 1 )
+		return;
 
-	BYTE *scriptList  = &buffer[0] + scriptListOffset;
-	BYTE *featureList = &buffer[0] + featureListOffset;
-	BYTE *lookupList  = &buffer[0] + lookupListOffset;
+	COpenTypeView scriptList  = gpos.Sub(gpos.U16(4));
+	COpenTypeView featureList = gpos.Sub(gpos.U16(6));
+	COpenTypeView lookupList  = gpos.Sub(gpos.U16(8));
 
 	// Locate the default script in the script list table
-	WORD scriptCount = GETUSHORT(scriptList);
+	WORD scriptCount = scriptList.U16(0);
 	WORD offset = 0;
 	for( UINT c = 0; c < scriptCount; c++ )
 	{
-		BYTE *scriptRecord = scriptList + 2 + c*6;
-		DWORD tag = *(DWORD*)scriptRecord;
-		if( tag == TAG('D','F','L','T') )
+		if( scriptList.U32(2 + c*6) == OT_TAG('D','F','L','T') )
 		{
-			offset = GETUSHORT(scriptRecord+4);
+			offset = scriptList.U16(2 + c*6 + 4);
 			break;
 		}
 	}
@@ -1063,36 +1081,69 @@ void GetKerningPairsFromGPOS(HDC dc, vector<KERNINGPAIR> &pairs, vector<UINT> &c
 		return;
 
 	// Use the default language
-	BYTE *script = scriptList + offset;
-	WORD defaultLangSysOffset = GETUSHORT(script);
-	WORD langSysCount = GETUSHORT(script+2);
+	COpenTypeView script = scriptList.Sub(offset);
+	WORD defaultLangSysOffset = script.U16(0);
 	if( defaultLangSysOffset == 0 )
 		return;
 
-	BYTE *langSys = script + defaultLangSysOffset;
-		
-	WORD lookupOrder = GETUSHORT(langSys);
-	assert( lookupOrder == 0 ); // reserved for future use
-	WORD reqFeatureIndex = GETUSHORT(langSys+2); // Can be 0xFFFF if not used
-	WORD featureCount    = GETUSHORT(langSys+4);
+	COpenTypeView langSys = script.Sub(defaultLangSysOffset);
+	WORD featureCount = langSys.U16(4);
 
-	// Find all kerning pairs from all the features that apply
-	WORD allFeatureCount = GETUSHORT(featureList);
+	// Find the lookups of all the kerning features that apply
+	vector<WORD> lookups;
+	WORD allFeatureCount = featureList.U16(0);
+	WORD allLookupCount = lookupList.U16(0);
 	for( UINT c = 0; c < featureCount; c++ )
 	{
-		WORD featureIndex = GETUSHORT(langSys+6+c*2);
+		WORD featureIndex = langSys.U16(6+c*2);
+		if( featureIndex >= allFeatureCount )
+			continue;
+
+		UINT featureRecord = 2 + 6*featureIndex;
+		if( featureList.U32(featureRecord) != OT_TAG('k','e','r','n') )
+			continue;
 
-		if( featureIndex < allFeatureCount )
+		COpenTypeView feature = featureList.Sub(featureList.U16(featureRecord+4));
+		WORD lookupCount = feature.U16(2);
+		for( UINT i = 0; i < lookupCount; i++ )
 		{
-			BYTE *featureRecord = featureList + 2 + 6*featureIndex;
+			WORD lookupIndex = feature.U16(4+i*2);
+			if( lookupIndex < allLookupCount && std::find(lookups.begin(), lookups.end(), lookupIndex) == lookups.end() )
+				lookups.push_back(lookupIndex);
+		}
+	}
 
-			DWORD tag = *(DWORD*)(featureRecord);
-			if( tag == TAG('k','e','r','n') )
-			{
-				ProcessKernFeature(dc, featureRecord, featureList, lookupList, pairs, glyphIdToChar, scaleFactor);
-			}
+	if( lookups.empty() )
+		return;
+
+	// Determine which glyphs are used by the selected characters
+	SKerningGlyphs glyphs(chars, gen);
+
+	// The lookups are independent of each other so they are processed in parallel
+	vector<TGlyphPairs> lookupPairs(lookups.size());
+	acUtility::ParallelFor(UINT(lookups.size()), [&](UINT n)
+	{
+		COpenTypeView lookup = lookupList.Sub(lookupList.U16(2 + lookups[n]*2));
+		ProcessKernLookup(lookup, glyphs, lookupPairs[n]);
+	});
+
+	// The adjustments from each lookup are accumulated
+	TGlyphPairs glyphPairs;
+	for( size_t n = 0; n < lookupPairs.size(); n++ )
+	{
+		if( glyphPairs.empty() )
+			glyphPairs.swap(lookupPairs[n]);
+		else
+		{
+			for( TGlyphPairs::const_iterator it = lookupPairs[n].begin(); it != lookupPairs[n].end(); ++it )
+				glyphPairs[it->first] += it->second;
 		}
+		lookupPairs[n].clear();
 	}
+
+	// Determine the factor for scaling down the values from the design units to the font size
+	float scaleFactor = DetermineDesignUnitToFontUnitFactor(dc, font);
+	ExpandKerningPairs(glyphPairs, scaleFactor, glyphs, pairs);
 }
 
 //=================================================================================
@@ -1104,46 +1155,33 @@ void GetKerningPairsFromGPOS(HDC dc, vector<KERNINGPAIR> &pairs, vector<UINT> &c
 //
 
 
-void GetKerningPairsFromKERN(HDC dc, vector<KERNINGPAIR> &pairs, vector<UINT> &chars, const CFontGen *gen)
+void GetKerningPairsFromKERN(HDC dc, vector<SKerningPair> &pairs, const vector<UINT> &chars, const CFontGen *gen)
 {
-	// Determine the factor for scaling down the values from the design units to the font size
-	float scaleFactor = DetermineDesignUnitToFontUnitFactor(dc);
+	// The KERN table is read directly from the font file
+	const COpenTypeFont &font = gen->GetOpenTypeFont();
+	COpenTypeView kern = font.GetTable(OT_TAG('k','e','r','n'));
+	if( kern.IsEmpty() )
+		return;
 
-	// TODO: support non unicode as well
-	// Build a glyphId to char map. Multiple characters may use  
-	// the same glyph, e.g. space, 32, and hard space, 160.
-	map<UINT,vector<UINT>> glyphIdToChar;
-	for( UINT n = 0; n < chars.size(); n++ )
-	{
-		int glyphId = gen->GetUnicodeGlyph(chars[n]);
-		if( glyphId >= 0 )
-			glyphIdToChar[glyphId].push_back(chars[n]);
-	}
+	// Determine which glyphs are used by the selected characters
+	SKerningGlyphs glyphs(chars, gen);
 
-	// Load the KERN table from the TrueType font file
-	vector<BYTE> buffer;
-	DWORD KERN = TAG('k','e','r','n');
-	DWORD size = GetFontData(dc, KERN, 0, 0, 0);
-	if( size != GDI_ERROR )
-	{
-		buffer.resize(size);
-		size = GetFontData(dc, KERN, 0, &buffer[0], size);
-	}
-	if( size == GDI_ERROR || size == 0 )
+	// Get the KERN header info
+	WORD version = kern.U16(0);
+	if( version != 0x0000 )
 		return;
+	WORD nTables = kern.U16(2);
 
-	// Get the KERN header info
-	WORD version = GETUSHORT(&buffer[0]);
-	assert( version == 0x0000 );
-	WORD nTables = GETUSHORT(&buffer[2]);
+	TGlyphPairs glyphPairs;
 
 	UINT pos = 4;
 	for( unsigned int n = 0; n < nTables; n++ )
 	{
-		WORD version  = GETUSHORT(&buffer[pos+0]);
-		assert( version == 0x0000 );
-		WORD length   = GETUSHORT(&buffer[pos+2]);
-		WORD coverage = GETUSHORT(&buffer[pos+4]);
+		COpenTypeView table = kern.Sub(pos);
+		WORD length   = table.U16(2);
+		WORD coverage = table.U16(4);
+		if( length < 6 || table.HasError() )
+			break;
 
 		// We currently only support horizontal text, and don't care about vertical adjustments 
 		if( (coverage & 1) == 1 && (coverage & 4) == 0 )
@@ -1151,23 +1189,36 @@ void GetKerningPairsFromKERN(HDC dc, vector<KERNINGPAIR> &pairs, vector<UINT> &c
 			// Check if this table holds kerning values
 			if( (coverage & 2) == 0 )
 			{
+				// The values are added to the previous tables, unless the override bit is set
+				bool override = (coverage & 8) ? true : false;
+
 				BYTE format = (coverage>>8);
 				if( format == 0 )
 				{
-					WORD nPairs        = GETUSHORT(&buffer[pos+6]);
-					WORD searchRange   = GETUSHORT(&buffer[pos+8]);
-					WORD entrySelector = GETUSHORT(&buffer[pos+10]);
-					WORD rangeShift    = GETUSHORT(&buffer[pos+12]);
+					// The subtable header must be complete for the pairs to follow it
+					if( table.GetSize() < 14 )
+						break;
+					UINT nPairs = table.U16(6);
+
+					// Some fonts have more pairs than fit in the 16bit length 
+					// of the subtable, so the pairs are limited by the table size
+					if( !table.Has(14, nPairs*6) )
+						nPairs = (table.GetSize() - 14)/6;
 
 					// Read each pair
-					for( int c = 0; c < nPairs; c++ )
+					for( UINT c = 0; c < nPairs; c++ )
 					{
-						WORD  left  = GETUSHORT(&buffer[pos+14+c*6]);
-						WORD  right = GETUSHORT(&buffer[pos+16+c*6]);
-						short value = GETSHORT(&buffer[pos+18+c*6]);
+						WORD  left  = table.U16(14+c*6);
+						WORD  right = table.U16(16+c*6);
+						short value = table.S16(18+c*6);
 
-						if( value )
-							AddKerningPairToList(dc, left, right, value, pairs, scaleFactor, glyphIdToChar);
+						if( !glyphs.IsUsed(left) || !glyphs.IsUsed(right) )
+							continue;
+
+						if( override )
+							glyphPairs[GlyphPairKey(left, right)] = value;
+						else if( value )
+							glyphPairs[GlyphPairKey(left, right)] += value;
 					}
 				}
 				else if( format == 2 )
@@ -1175,13 +1226,9 @@ void GetKerningPairsFromKERN(HDC dc, vector<KERNINGPAIR> &pairs, vector<UINT> &c
 					// TODO: This format is not properly supported by Windows according to 
 					//       above references, so I'll only implement it when I find a need
 					//       for it.
-					assert( false );
-				}
-				else
-				{
-					// These other formats are undefined
-					assert( false );
 				}
+
+				// The other formats are undefined
 			}
 			else
 			{
@@ -1191,6 +1238,10 @@ void GetKerningPairsFromKERN(HDC dc, vector<KERNINGPAIR> &pairs, vector<UINT> &c
 
 		pos += length;
 	}
+
+	// Determine the factor for scaling down the values from the design units to the font size
+	float scaleFactor = DetermineDesignUnitToFontUnitFactor(dc, font);
+	ExpandKerningPairs(glyphPairs, scaleFactor, glyphs, pairs);
 }
 
 //=================================================================================
@@ -1198,148 +1249,226 @@ void GetKerningPairsFromKERN(HDC dc, vector<KERNINGPAIR> &pairs, vector<UINT> &c
 // ref: http://www.microsoft.com/typography/otspec/otff.htm
 // ref: https://www.microsoft.com/typography/otspec/cmap.htm
 
-int EnumTrueTypeCMAP(HDC dc, map<unsigned int, unsigned int> &unicodeToGlyphMap)
+// Each of the cmap subtable formats that map Unicode characters are parsed
+// straight into the glyph map. Ranges of characters are inserted as whole
+// ranges so fonts with large character sets can be loaded quickly
+
+void EnumCMAPFormat0(const COpenTypeView &subTable, CGlyphMap &unicodeToGlyphMap)
 {
-	// Remove old mappings
-	unicodeToGlyphMap.clear();
+	// Byte encoding table, with a glyph id for each of the first 256 characters
+	if( !subTable.Has(6, 256) )
+		return;
 
-	// Load the CMAP table from the TrueType font file
-	vector<BYTE> buffer;
-	DWORD CMAP = TAG('c', 'm', 'a', 'p');
-	DWORD size = GetFontData(dc, CMAP, 0, 0, 0);
-	if (size != GDI_ERROR)
+	for( unsigned int ch = 0; ch < 256; ch++ )
 	{
-		buffer.resize(size);
-		size = GetFontData(dc, CMAP, 0, &buffer[0], size);
+		BYTE glyphId = subTable.U8(6 + ch);
+		if( glyphId != 0 )
+			unicodeToGlyphMap.Set(ch, glyphId);
 	}
-	if (size == GDI_ERROR || size == 0)
+}
+
+void EnumCMAPFormat4(const COpenTypeView &subTable, CGlyphMap &unicodeToGlyphMap)
+{
+	// Segment mapping to delta values
+	// This is the standard format used by Microsoft
+	// This format is for example used in the 'Arial' true type font
+
+	// This format supports all Unicode characters below 0xFFFF.
+	// The range U+D800 - U+DFFF is reserved for surrogates and cannot have any characters
+	WORD segCountX2 = subTable.U16(6);
+	WORD segCount = segCountX2 / 2;
+
+	UINT endCount      = 14;
+	UINT startCount    = 16 + segCountX2;
+	UINT idDelta       = 16 + segCountX2 * 2;
+	UINT idRangeOffset = 16 + segCountX2 * 3;
+	if( !subTable.Has(idRangeOffset, segCountX2) )
+		return;
+
+	// Iterate over each segment to identify the characters to glyph id mappings
+	for( unsigned int s = 0; s < segCount; s++ )
+	{
+		WORD start = subTable.U16(startCount + s*2);
+		WORD end   = subTable.U16(endCount + s*2);
+
+		// We've reached the end
+		if( start == 0xFFFF && end == 0xFFFF )
+			break;
+		if( start > end )
+			continue;
+
+		WORD rangeOffset = subTable.U16(idRangeOffset + s*2);
+		WORD delta       = subTable.U16(idDelta + s*2);
+		if( rangeOffset == 0 )
+		{
+			// The glyph ids are consecutive unless they wrap around at 0xFFFF
+			UINT firstGlyph = WORD(start + delta);
+			if( firstGlyph != 0 && firstGlyph + (end - start) <= 0xFFFF )
+			{
+				unicodeToGlyphMap.SetRange(start, end, firstGlyph);
+				continue;
+			}
+
+			for( unsigned int ch = start; ch <= end; ch++ )
+			{
+				WORD glyphId = WORD(ch + delta);
+				if( glyphId != 0 )
+					unicodeToGlyphMap.Set(ch, glyphId);
+			}
+		}
+		else
+		{
+			// The glyph index array is addressed relative to the range offset itself
+			UINT glyphIdArray = idRangeOffset + s*2 + rangeOffset;
+			if( !subTable.Has(glyphIdArray, (end - start + 1)*2) )
+				continue;
+
+			for( unsigned int ch = start; ch <= end; ch++ )
+			{
+				WORD glyphId = subTable.U16(glyphIdArray + (ch - start)*2);
+				if( glyphId != 0 )
+				{
+					glyphId += delta;
+					unicodeToGlyphMap.Set(ch, glyphId);
+				}
+			}
+		}
+	}
+}
+
+void EnumCMAPFormat6(const COpenTypeView &subTable, CGlyphMap &unicodeToGlyphMap)
+{
+	// Trimmed table mapping, with a glyph id for each character in a single range
+	WORD firstCode  = subTable.U16(6);
+	WORD entryCount = subTable.U16(8);
+	if( !subTable.Has(10, entryCount*2) )
+		return;
+
+	for( unsigned int n = 0; n < entryCount; n++ )
+	{
+		WORD glyphId = subTable.U16(10 + n*2);
+		if( glyphId != 0 )
+			unicodeToGlyphMap.Set(firstCode + n, glyphId);
+	}
+}
+
+void EnumCMAPFormat10(const COpenTypeView &subTable, CGlyphMap &unicodeToGlyphMap)
+{
+	// Trimmed array, like format 6 but with 32bit character codes
+	DWORD startCharCode = subTable.U32(12);
+	DWORD numChars      = subTable.U32(16);
+	if( numChars > 0x110000 || !subTable.Has(20, numChars*2) )
+		return;
+
+	for( unsigned int n = 0; n < numChars; n++ )
+	{
+		WORD glyphId = subTable.U16(20 + n*2);
+		if( glyphId != 0 )
+			unicodeToGlyphMap.Set(startCharCode + n, glyphId);
+	}
+}
+
+void EnumCMAPFormat12And13(const COpenTypeView &subTable, WORD format, CGlyphMap &unicodeToGlyphMap)
+{
+	// Segmented coverage (12) and many-to-one range mappings (13)
+	// Format 12 is the standard format used by Microsoft for characters above 0xFFFF
+	// This format is for example used in the 'Cambria Math' and 'DejaVu Sans' true type fonts
+	// Format 13 is mostly used by last resort fonts, where all characters in a range use the same glyph
+	DWORD nGroups = subTable.U32(12);
+	if( nGroups > 0x110000 || !subTable.Has(16, nGroups*12) )
+		return;
+
+	// Iterate over each group to identify the characters to glyph id mappings
+	for( unsigned int s = 0; s < nGroups; s++ )
+	{
+		DWORD start   = subTable.U32(16 + s*12 + 0);
+		DWORD end     = subTable.U32(16 + s*12 + 4);
+		DWORD glyphId = subTable.U32(16 + s*12 + 8);
+
+		if( format == 12 )
+			unicodeToGlyphMap.SetRange(start, end, glyphId);
+		else if( glyphId != 0 )
+			unicodeToGlyphMap.FillRange(start, end, glyphId);
+	}
+}
+
+int EnumTrueTypeCMAP(const COpenTypeFont &font, CGlyphMap &unicodeToGlyphMap)
+{
+	// Remove old mappings
+	unicodeToGlyphMap.Clear();
+
+	// The CMAP table is read directly from the font file
+	COpenTypeView cmap = font.GetTable(OT_TAG('c','m','a','p'));
+	if( cmap.IsEmpty() )
 		return -1;
 
 	// Get the CMAP header info
-	WORD version = GETUSHORT(&buffer[0]);
-	assert(version == 0x0000);
-	WORD nTables = GETUSHORT(&buffer[2]);
+	WORD version = cmap.U16(0);
+	if( version != 0x0000 )
+		return -1;
+	WORD nTables = cmap.U16(2);
 
-	UINT pos = 4;
-	for (unsigned int n = 0; n < nTables; n++)
+	// Determine which of the subtables map Unicode characters. The tables that
+	// only cover the base plane are parsed before the tables with the complete 
+	// character set, so the latter take precedence if they are not equal
+	vector<DWORD> offsets[2];
+	for( unsigned int n = 0; n < nTables; n++ )
 	{
-		// Look for the Windows platform CMAP subtable
-		WORD platformID = GETUSHORT(&buffer[pos + 0]);
-		WORD encodingID = GETUSHORT(&buffer[pos + 2]);
-		ULONG offset = GETUINT(&buffer[pos + 4]);
-		pos += 8;
+		WORD platformID = cmap.U16(4 + n*8 + 0);
+		WORD encodingID = cmap.U16(4 + n*8 + 2);
+		DWORD offset    = cmap.U32(4 + n*8 + 4);
 
+		// platformID 0 is for Unicode
 		// platformID 1 is for Mac OS
 		// platformID 3 is for Windows
-		if (platformID == 3)
+		int priority = -1;
+		if( platformID == 0 )
+		{
+			// 0-3 for Unicode base plane
+			// 4 and 6 for the full Unicode character set
+			// 5 is for variation sequences, which can't be exported as 
+			// each character is a single code point in the font descriptor
+			if( encodingID <= 3 )
+				priority = 0;
+			else if( encodingID == 4 || encodingID == 6 )
+				priority = 1;
+		}
+		else if( platformID == 3 )
 		{
-			// For now this code only supports the following encodings:
 			// 1 for Unicode UCS-2 (16bit)
 			// 10 for Unicode UCS-4 (32bit)
-			if (encodingID == 1 || encodingID == 10)
-			{
-				// Jump to the start of the subtable
-				WORD format = GETUSHORT(&buffer[offset]);
-
-				if (format == 0) // byte encoding table
-					assert(false);
-				else if (format == 2) // high-byte mapping through table
-					assert(false);
-				else if (format == 4) // segment mapping to delta values
-				{
-					// This is the standard format used by Microsoft
-					// This format is for example used in the 'Arial' true type font
-
-					// This format supports all Unicode characters below 0xFFFF.
-					// The range U+D800 - U+DFFF is reserved for surrogates and cannot have any characters
-					WORD length = GETUSHORT(&buffer[offset + 2]);
-					WORD language = GETUSHORT(&buffer[offset + 4]);
-					assert(language == 0);
-					WORD segCountX2 = GETUSHORT(&buffer[offset + 6]);
-					WORD searchRange = GETUSHORT(&buffer[offset + 8]);
-					WORD entrySelector = GETUSHORT(&buffer[offset + 10]);
-					WORD rangeShift = GETUSHORT(&buffer[offset + 12]);
-
-					WORD segCount = segCountX2 / 2;
-					WORD *endCount = (WORD*)&buffer[offset + 14];
-					WORD *startCount = (WORD*)&buffer[offset + 16 + segCountX2];
-					SHORT *idDelta = (SHORT*)&buffer[offset + 16 + segCountX2 * 2];
-					WORD *idRangeOffset = (WORD*)&buffer[offset + 16 + segCountX2 * 3];
-					// glyphIdArray is used indirectly so we don't need to take its address
-					//WORD *glyphIdArray = (WORD*)&buffer[offset + 16 + segCountX2 * 4];
-					
-					// Iterate over each segment to identify the characters to glyph id mappings
-					for (unsigned int s = 0; s < segCount; s++)
-					{
-						WORD start = SWAP16(startCount[s]);
-						WORD end = SWAP16(endCount[s]);
-
-						if (start == 0xFFFF && end == 0xFFFF)
-						{
-							// We've reached the end
-							assert(s == segCount - 1);
-							break;
-						}
-
-						WORD rangeOffset = SWAP16(idRangeOffset[s]);
-						SHORT delta = SWAP16(idDelta[s]);
-						for (unsigned int ch = start; ch <= end; ch++)
-						{
-							WORD glyphId = 0;
-							if (idRangeOffset[s] != 0)
-							{
-								glyphId = SWAP16(*(&idRangeOffset[s] + rangeOffset / 2 + (ch - start)));
-								if (glyphId != 0)
-									glyphId += delta;
-							}
-							else
-							{
-								glyphId = ch + delta;
-							}
-							if (glyphId != 0)
-								unicodeToGlyphMap[ch] = glyphId;
-						}
-					}
-				}
-				else if (format == 6) // trimmed table mapping
-					assert(false);
-				else if (format == 8) // mixed 16-bit and 32-bit coverage
-					assert(false);
-				else if (format == 10) // trimmed array
-					assert(false);
-				else if (format == 12) // segmented coverage
-				{
-					// This is the standard format used by Microsoft
-					// This format is for example used in the 'Cambria Math' and 'DejaVu Sans' true type fonts
-
-					ULONG length = GETUINT(&buffer[offset + 4]);
-					ULONG language = GETUINT(&buffer[offset + 8]);
-					assert(language == 0);
-					ULONG nGroups = GETUINT(&buffer[offset + 12]);
-					
-					// Iterate over each group to identify the characters to glyph id mappings
-					offset += 16;
-					for (unsigned int s = 0; s < nGroups; s++)
-					{
-						ULONG start = GETUINT(&buffer[offset + 0]);
-						ULONG end = GETUINT(&buffer[offset + 4]);
-						ULONG startGlyphId = GETUINT(&buffer[offset + 8]);
+			if( encodingID == 1 )
+				priority = 0;
+			else if( encodingID == 10 )
+				priority = 1;
+		}
 
-						for (unsigned int ch = start; ch <= end; ch++)
-						{
-							ULONG glyphId = ch - start + startGlyphId;
-							unicodeToGlyphMap[ch] = glyphId;
-						}
+		// The same subtable is often referred to from more than one platform
+		if( priority >= 0 && 
+			std::find(offsets[0].begin(), offsets[0].end(), offset) == offsets[0].end() &&
+			std::find(offsets[1].begin(), offsets[1].end(), offset) == offsets[1].end() )
+			offsets[priority].push_back(offset);
+	}
 
-						offset += 12;
-					}
-				}
-				else if (format == 13) // many-to-one range mappings
-					assert(false);
-				else if (format == 14) // unicode variation sequences
-					assert(false);
-				else
-					assert(false);
+	for( int priority = 0; priority < 2; priority++ )
+	{
+		for( size_t n = 0; n < offsets[priority].size(); n++ )
+		{
+			// Jump to the start of the subtable
+			COpenTypeView subTable = cmap.Sub(offsets[priority][n]);
+			WORD format = subTable.U16(0);
+
+			// Format 2 is for multi-byte encodings, and format 8 for 
+			// UTF16 encoded strings, neither of which are used in Unicode
+			// subtables in practice so they are ignored
+			switch( format )
+			{
+			case 0:  EnumCMAPFormat0(subTable, unicodeToGlyphMap); break;
+			case 4:  EnumCMAPFormat4(subTable, unicodeToGlyphMap); break;
+			case 6:  EnumCMAPFormat6(subTable, unicodeToGlyphMap); break;
+			case 10: EnumCMAPFormat10(subTable, unicodeToGlyphMap); break;
+			case 12: 
+			case 13: EnumCMAPFormat12And13(subTable, format, unicodeToGlyphMap); break;
 			}
 		}
 	}
@@ -1438,3 +1567,69 @@ std::string GetFontFileName(const std::string &faceName, bool bold, bool italic)
 	return out;
 }
 
+// Map the font file of the font that is selected in the DC. The file is located
+// either from the explicitly given font file or the registry, and is verified to
+// hold the same font as the DC. If the file cannot be found the font data is 
+// copied from GDI instead, which still only has to be done once per font.
+int OpenSelectedFont(HDC dc, const std::string &fontFile, const std::string &faceName, bool bold, bool italic, COpenTypeFont &font)
+{
+	// Get the offset table and table directory of the selected font. For 
+	// collections this is the directory of the selected font in the collection
+	BYTE header[12];
+	if( GetFontData(dc, 0, 0, header, 12) != 12 )
+	{
+		// Not a TrueType or OpenType font
+		font.Close();
+		return -1;
+	}
+
+	vector<BYTE> directory(12 + 16*GETUSHORT(&header[4]));
+	if( GetFontData(dc, 0, 0, &directory[0], DWORD(directory.size())) != directory.size() )
+	{
+		font.Close();
+		return -1;
+	}
+
+	// Is it the same font that is already open?
+	int face = -1;
+	if( font.IsOpen() )
+		face = font.FindFace(&directory[0], UINT(directory.size()));
+
+	if( face < 0 && fontFile != "" && font.Open(fontFile) >= 0 )
+		face = font.FindFace(&directory[0], UINT(directory.size()));
+
+	if( face < 0 )
+	{
+		string file = GetFontFileName(faceName, bold, italic);
+		if( file != "" && font.Open(file) >= 0 )
+			face = font.FindFace(&directory[0], UINT(directory.size()));
+	}
+
+	if( face < 0 )
+	{
+		// Copy the complete font file from GDI. For collections the whole
+		// collection must be loaded as the table offsets are from the start of it
+		DWORD table = TAG('t','t','c','f');
+		DWORD size = GetFontData(dc, table, 0, 0, 0);
+		if( size == GDI_ERROR )
+		{
+			table = 0;
+			size = GetFontData(dc, table, 0, 0, 0);
+		}
+
+		vector<BYTE> data;
+		if( size != GDI_ERROR && size > 0 )
+		{
+			data.resize(size);
+			if( GetFontData(dc, table, 0, &data[0], size) != size )
+				data.clear();
+		}
+
+		if( font.Load(data) >= 0 )
+			face = font.FindFace(&directory[0], UINT(directory.size()));
+		if( face < 0 )
+			face = 0;
+	}
+
+	return font.SelectFace(face);
+}
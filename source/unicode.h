@@ -32,9 +32,12 @@
 #include <vector>
 #include <map>
 #include <Usp10.h>
+#include "glyphmap.h"
+#include "opentype.h"
 using std::string;
 using std::vector;
 class CFontGen;
+struct SKerningPair;
 
 // Interesting links
 //
@@ -62,10 +65,10 @@ int GetSubsetFromChar(unsigned int chr);
 
 int GetGlyphABCWidths(HDC dc, SCRIPT_CACHE *sc, UINT glyph, ABC *abc);
 
-void GetKerningPairsFromGPOS(HDC dc, vector<KERNINGPAIR> &pairs, vector<UINT> &chars, const CFontGen *gen);
-void GetKerningPairsFromKERN(HDC dc, vector<KERNINGPAIR> &pairs, vector<UINT> &chars, const CFontGen *gen);
-int EnumTrueTypeCMAP(HDC dc, std::map<unsigned int, unsigned int> &unicodeToGlyph);
-int EnumUnicodeGlyphs(HDC dc, std::map<unsigned int, unsigned int> &unicodeToGlyph);
+void GetKerningPairsFromGPOS(HDC dc, vector<SKerningPair> &pairs, const vector<UINT> &chars, const CFontGen *gen);
+void GetKerningPairsFromKERN(HDC dc, vector<SKerningPair> &pairs, const vector<UINT> &chars, const CFontGen *gen);
+int EnumTrueTypeCMAP(const COpenTypeFont &font, CGlyphMap &unicodeToGlyph);
+int EnumUnicodeGlyphs(HDC dc, CGlyphMap &unicodeToGlyph);
 
 #define TAG(a,b,c,d) ((a) | ((b) << 8) | ((c) << 16) | ((d) << 24))
 #define SWAP32(x) ((((x)&0xFF)<<24)|(((x)&0xFF00)<<8)|(((x)&0xFF0000)>>8)|((x>>24)&0xFF))
@@ -77,6 +80,7 @@ int EnumUnicodeGlyphs(HDC dc, std::map<unsigned int, unsigned int> &unicodeToGly
 #define GETINT(x)    int(SWAP32(*(DWORD*)(x)))
 
 std::string GetFontFileName(const std::string &faceName, bool bold, bool italic);
+int OpenSelectedFont(HDC dc, const std::string &fontFile, const std::string &faceName, bool bold, bool italic, COpenTypeFont &font);
 void ConvertWCharToUtf8(const WCHAR *buf, std::string &utf8);
 void ConvertUtf8ToWChar(const std::string &utf8, WCHAR *buf, size_t bufSize);
 